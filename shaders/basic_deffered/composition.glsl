@@ -1,5 +1,8 @@
 #include <shared.inl>
 #include <common/core.glsl>
+#include <common/clustering.glsl>
+#include <common/shadows.glsl>
+#include <common/g_buffer.glsl>
 
 DAXA_USE_PUSH_CONSTANT(CompositionPush)
 
@@ -7,6 +10,8 @@ DAXA_USE_PUSH_CONSTANT(CompositionPush)
 #define OBJECT deref(daxa_push_constant.object_buffer)
 #define CAMERA deref(daxa_push_constant.camera_buffer)
 #define MATERIAL deref(daxa_push_constant.material_info_buffer)
+#define LIGHTS deref(daxa_push_constant.lights_buffer)
+#define CLUSTERS deref(daxa_push_constant.clusters_buffer)
 
 #if defined(DRAW_VERT)
 
@@ -24,23 +29,49 @@ layout(location = 0) in f32vec2 in_uv;
 layout(location = 0) out f32vec4 out_color;
 
 void main() {
+    i32vec2 coord = i32vec2(gl_FragCoord.xy);
+    f32 depth = fetch_texture(daxa_push_constant.depth, coord).r;
+    f32vec3 view_position = reconstruct_view_position(CAMERA.inverse_projection_matrix, in_uv, depth);
+    f32vec3 position = (CAMERA.inverse_view_matrix * f32vec4(view_position, 1.0)).xyz;
+
     #if defined(SETTINGS_VISUALIZE_ATTACHMENT_NONE)
-    f32vec3 color = sample_texture(daxa_push_constant.albedo, in_uv).rgb;
-    f32vec3 position = sample_texture(daxa_push_constant.position, in_uv).rgb;
-    f32vec3 normal = normalize(sample_texture(daxa_push_constant.normal, in_uv).rgb);
+    f32vec3 color = fetch_texture(daxa_push_constant.albedo, coord).rgb;
+
+    // the depth buffer is cleared to 1, nothing to light there
+    if(depth >= 1.0) {
+        out_color = vec4(color, 1.0);
+        return;
+    }
+
+    f32vec3 normal = decode_normal(fetch_texture(daxa_push_constant.normal, coord).rg);
     f32vec3 camera_position = CAMERA.position;
+    f32 view_depth = -view_position.z;
 
-    for(uint i = 0; i < deref(daxa_push_constant.lights_buffer).num_directional_lights; i++) {
-        color += calculate_directional_light(deref(daxa_push_constant.lights_buffer).directional_lights[i], color, normal, position, camera_position);
+    // only the first directional light casts shadows
+    f32 shadow = calculate_shadow(CAMERA.shadow_info, position, normal, view_depth);
+    for(uint i = 0; i < LIGHTS.num_directional_lights; i++) {
+        f32 visibility = i == 0 ? shadow : 1.0;
+        color += visibility * calculate_directional_light(deref(LIGHTS.directional_lights[i]), color, normal, position, camera_position);
     }
 
-    for(uint i = 0; i < deref(daxa_push_constant.lights_buffer).num_point_lights; i++) {
-        color += calculate_point_light(deref(daxa_push_constant.lights_buffer).point_lights[i], color, normal, position, camera_position);
+    // local lights are added afterwards by rasterizing their volumes
+    #if !defined(SETTINGS_COMPOSITION_LIGHT_VOLUMES)
+    u32 cluster_index = get_cluster_index(in_uv, view_depth, CAMERA.near_plane, CAMERA.far_plane);
+    u32 point_light_count = CLUSTERS.clusters[cluster_index].point_light_count;
+    u32 spot_light_count = CLUSTERS.clusters[cluster_index].spot_light_count;
+
+    for(uint i = 0; i < point_light_count; i++) {
+        u32 light_index = CLUSTERS.clusters[cluster_index].light_indices[i];
+        f32 visibility = calculate_point_shadow(CAMERA.shadow_atlas_info, light_index, deref(LIGHTS.point_lights[light_index]).position, position, normal);
+        color += visibility * calculate_point_light(deref(LIGHTS.point_lights[light_index]), color, normal, position, camera_position);
     }
 
-    for(uint i = 0; i < deref(daxa_push_constant.lights_buffer).num_spot_lights; i++) {
-        color += calculate_spot_light(deref(daxa_push_constant.lights_buffer).spot_lights[i], color, normal, position, camera_position);
+    for(uint i = point_light_count; i < point_light_count + spot_light_count; i++) {
+        u32 light_index = CLUSTERS.clusters[cluster_index].light_indices[i];
+        f32 visibility = calculate_spot_shadow(CAMERA.shadow_atlas_info, light_index, deref(LIGHTS.spot_lights[light_index]).position, position, normal);
+        color += visibility * calculate_spot_light(deref(LIGHTS.spot_lights[light_index]), color, normal, position, camera_position);
     }
+    #endif
 
     /*#if !defined(SETTINGS_AMBIENT_OCCLUSION_NONE)
     color *= sample_texture(daxa_push_constant.ssao, in_uv).rrr;
@@ -49,13 +80,13 @@ void main() {
     out_color = vec4(color, 1.0);
 
     #elif defined(SETTINGS_VISUALIZE_ATTACHMENT_ALBEDO)
-    out_color = vec4(sample_texture(daxa_push_constant.albedo, in_uv).rgb, 1.0);
+    out_color = vec4(fetch_texture(daxa_push_constant.albedo, coord).rgb, 1.0);
     #elif defined(SETTINGS_VISUALIZE_ATTACHMENT_NORMAL)
-    out_color = vec4(sample_texture(daxa_push_constant.normal, in_uv).rgb * 0.5 + 0.5, 1.0);
+    out_color = vec4(decode_normal(fetch_texture(daxa_push_constant.normal, coord).rg) * 0.5 + 0.5, 1.0);
     #elif defined(SETTINGS_VISUALIZE_ATTACHMENT_POSITION)
-    out_color = vec4(sample_texture(daxa_push_constant.position, in_uv).rgb, 1.0);
+    out_color = vec4(position, 1.0);
     #elif defined(SETTINGS_VISUALIZE_ATTACHMENT_DEPTH)
-    out_color = vec4(sample_texture(daxa_push_constant.normal, in_uv).www, 1.0);
+    out_color = vec4(f32vec3(-view_position.z / CAMERA.far_plane), 1.0);
     #elif defined(SETTINGS_VISUALIZE_ATTACHMENT_AO)
     out_color = vec4(sample_texture(daxa_push_constant.ssao, in_uv).rrr, 1.0);
     #endif
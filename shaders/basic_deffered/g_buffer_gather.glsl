@@ -1,48 +1,54 @@
 #include <shared.inl>
 #include <common/core.glsl>
+#include <common/g_buffer.glsl>
 
 DAXA_USE_PUSH_CONSTANT(DrawPush)
 
+#if defined(SETTINGS_GPU_DRIVEN)
+// first_instance of the indirect command is the instance index, the fragment stage gets it passed down
+#define INSTANCE deref(daxa_push_constant.instance_buffer[gl_InstanceIndex])
+#define VERTEX deref(INSTANCE.vertex_buffer[gl_VertexIndex])
+#define OBJECT deref(INSTANCE.object_buffer)
+#define MATERIAL deref(deref(daxa_push_constant.instance_buffer[v_instance_index]).material_info_buffer)
+#else
 #define VERTEX deref(daxa_push_constant.face_buffer[gl_VertexIndex])
 #define OBJECT deref(daxa_push_constant.object_buffer)
-#define CAMERA deref(daxa_push_constant.camera_buffer)
 #define MATERIAL deref(daxa_push_constant.material_info_buffer)
-
-f32 linear_depth(f32 depth) {
-	f32 z = depth * 2.0f - 1.0f; 
-	return (2.0f * CAMERA.near_plane * CAMERA.far_plane) / (CAMERA.far_plane + CAMERA.near_plane - z * (CAMERA.far_plane - CAMERA.near_plane));	
-}
+#endif
+#define CAMERA deref(daxa_push_constant.camera_buffer)
 
 
 #if defined(DRAW_VERT)
 layout(location = 0) out f32vec2 v_uv;
 layout(location = 1) out f32vec3 v_position;
-#if defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-layout(location = 2) out f32mat3x3 v_tbn;
-#else
 layout(location = 2) out f32vec3 v_normal;
+// w is the bittangent sign, only written when normal mapping uses the vertex tangents
+layout(location = 3) out f32vec4 v_tangent;
+#if defined(SETTINGS_GPU_DRIVEN)
+layout(location = 5) flat out u32 v_instance_index;
 #endif
+// has to match the depth pre-pass bit for bit
+invariant gl_Position;
 
 void main() {
+#if defined(SETTINGS_GPU_DRIVEN)
+    v_instance_index = u32(gl_InstanceIndex);
+#endif
     f32vec3 position = (OBJECT.model_matrix * f32vec4(VERTEX.position.xyz, 1)).xyz;
     gl_Position = CAMERA.projection_matrix * CAMERA.view_matrix * f32vec4(position.xyz, 1);
 
     v_uv = VERTEX.uv.xy;
 
-#if defined(SETTINGS_NORMAL_MAPPING_NONE)
     v_normal = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz);
-#elif defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-    f32vec3 normal = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz);
-    f32vec3 tangent = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.tangent.xyz);
+    v_tangent = f32vec4(0.0);
+    if(NORMAL_MAPPING_MODE == NORMAL_MAPPING_MODE_USING_TANGENTS) {
+        f32vec3 tangent = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.tangent.xyz);
 
-#if defined(SETTINGS_NORMAL_MAPPING_REORTHOGONALIZE_TBN_VECTORS)
-    tangent = normalize(tangent - dot(tangent, normal) * normal);
-#endif
-    f32vec3 bittangent = normalize(cross(normal, tangent) * VERTEX.tangent.w);
-    v_tbn = f32mat3x3(tangent, bittangent, normal);
-#else
-    v_normal = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz);
-#endif
+        if(REORTHOGONALIZE_TBN) {
+            tangent = normalize(tangent - dot(tangent, v_normal) * v_normal);
+        }
+        v_tangent = f32vec4(tangent, VERTEX.tangent.w);
+    }
 
     v_position = position.xyz;
 
@@ -57,15 +63,14 @@ void main() {
 
 layout(location = 0) in f32vec2 v_uv;
 layout(location = 1) in f32vec3 v_position;
-#if defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-layout(location = 2) in f32mat3x3 v_tbn;
-#else
 layout(location = 2) in f32vec3 v_normal;
+layout(location = 3) in f32vec4 v_tangent;
+#if defined(SETTINGS_GPU_DRIVEN)
+layout(location = 5) flat in u32 v_instance_index;
 #endif
 
 layout(location = 0) out f32vec4 out_albedo;
-layout(location = 1) out f32vec4 out_normal;
-layout(location = 2) out f32vec4 out_position;
+layout(location = 1) out f32vec2 out_normal;
 
 const f32 PI = 3.14159265359;
 
@@ -77,11 +82,7 @@ vec3 getNormalFromMap(TextureId normal_map) {
     vec2 st1 = dFdx(v_uv);
     vec2 st2 = dFdy(v_uv);
 
-#if defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-    vec3 N   = normalize(v_tbn[2]);
-#else
     vec3 N   = normalize(v_normal);
-#endif
     vec3 T  = normalize(Q1*st2.t - Q2*st1.t);
     vec3 B  = -normalize(cross(N, T));
     mat3 TBN = mat3(T, B, N);
@@ -89,23 +90,34 @@ vec3 getNormalFromMap(TextureId normal_map) {
     return normalize(TBN * tangentNormal);
 }
 
-void main() {
-    out_albedo = f32vec4(sample_texture(MATERIAL.albedo, v_uv).rgb, 1.0);
-    
-#if defined(SETTINGS_NORMAL_MAPPING_NONE)
-    f32vec3 normal = normalize(v_normal);
-#elif defined(SETTINGS_NORMAL_MAPPING_CALCULATING_TBN_VECTORS)
-    f32vec3 normal = getNormalFromMap(MATERIAL.normal_map);
-#elif defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-    f32vec3 normal = normalize(v_tbn * normalize(sample_texture(MATERIAL.normal_map, v_uv).rgb * 2.0 - 1.0));
-#else
+f32vec3 getNormalFromTangents(TextureId normal_map) {
     f32vec3 normal = normalize(v_normal);
-#endif
+    f32vec3 tangent = normalize(v_tangent.xyz);
+    f32vec3 bittangent = normalize(cross(normal, tangent) * v_tangent.w);
+    f32mat3x3 tbn = f32mat3x3(tangent, bittangent, normal);
+    return normalize(tbn * normalize(sample_texture(normal_map, v_uv).rgb * 2.0 - 1.0));
+}
 
-    //f32vec3 normal = normalize(v_normal) * 0.5 + 0.5;
-    out_normal = f32vec4(normal, linear_depth(gl_FragCoord.z));
+void main() {
+    if(material_alpha_tested() && material_alpha(MATERIAL, v_uv) < MATERIAL.alpha_cutoff) {
+        discard;
+    }
 
-    out_position = f32vec4(v_position, 1.0);
+    // a material without the texture samples white
+    f32vec3 albedo = material_has_feature(MATERIAL, MATERIAL_FEATURE_ALBEDO) ? sample_texture(MATERIAL.albedo, v_uv).rgb : f32vec3(1.0, 1.0, 1.0);
+    out_albedo = f32vec4(albedo, 1.0);
+    
+    // a specialization constant, the branches not taken are folded away when the pipeline is created
+    f32vec3 normal = normalize(v_normal);
+    if(material_has_feature(MATERIAL, MATERIAL_FEATURE_NORMAL_MAP)) {
+        if(NORMAL_MAPPING_MODE == NORMAL_MAPPING_MODE_CALCULATING_TBN_VECTORS) {
+            normal = getNormalFromMap(MATERIAL.normal_map);
+        } else if(NORMAL_MAPPING_MODE == NORMAL_MAPPING_MODE_USING_TANGENTS) {
+            normal = getNormalFromTangents(MATERIAL.normal_map);
+        }
+    }
+
+    out_normal = encode_normal(normal);
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <shared.inl>
+#include <common/core.glsl>
+#include <common/shadows.glsl>
+#include <common/g_buffer.glsl>
+
+DAXA_USE_PUSH_CONSTANT(LightVolumePush)
+
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+#define LIGHTS deref(daxa_push_constant.lights_buffer)
+
+#define LIGHT_VOLUME_PI 3.14159265359
+
+#if defined(DRAW_VERT)
+
+layout(location = 0) flat out u32 out_light_index;
+
+// unit uv sphere, triangles are counter clockwise seen from the outside
+f32vec3 sphere_vertex(u32 vertex_index) {
+    const u32 segment_offsets[6] = u32[](0, 1, 0, 1, 1, 0);
+    const u32 ring_offsets[6] = u32[](0, 0, 1, 0, 1, 1);
+
+    u32 quad = vertex_index / 6;
+    u32 corner = vertex_index % 6;
+    f32 segment = f32(quad % LIGHT_VOLUME_SEGMENTS + segment_offsets[corner]);
+    f32 ring = f32(quad / LIGHT_VOLUME_SEGMENTS + ring_offsets[corner]);
+
+    f32 theta = ring / f32(LIGHT_VOLUME_RINGS) * LIGHT_VOLUME_PI;
+    f32 phi = segment / f32(LIGHT_VOLUME_SEGMENTS) * 2.0 * LIGHT_VOLUME_PI;
+
+    // push the facets out so the polygonal proxy fully contains the real sphere
+    f32 scale = 1.0 / (cos(LIGHT_VOLUME_PI / f32(LIGHT_VOLUME_SEGMENTS)) * cos(LIGHT_VOLUME_PI / f32(2 * LIGHT_VOLUME_RINGS)));
+    return f32vec3(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi)) * scale;
+}
+
+// cone with its apex in the origin opening towards +z, unit height and the given base radius
+f32vec3 cone_vertex(u32 vertex_index, f32 radius) {
+    u32 segment = vertex_index / 6;
+    u32 corner = vertex_index % 6;
+
+    f32 scaled_radius = radius / cos(LIGHT_VOLUME_PI / f32(LIGHT_VOLUME_SEGMENTS));
+    f32 phi_0 = f32(segment) / f32(LIGHT_VOLUME_SEGMENTS) * 2.0 * LIGHT_VOLUME_PI;
+    f32 phi_1 = f32(segment + 1) / f32(LIGHT_VOLUME_SEGMENTS) * 2.0 * LIGHT_VOLUME_PI;
+    f32vec3 base_0 = f32vec3(cos(phi_0) * scaled_radius, sin(phi_0) * scaled_radius, 1.0);
+    f32vec3 base_1 = f32vec3(cos(phi_1) * scaled_radius, sin(phi_1) * scaled_radius, 1.0);
+
+    // side triangle followed by the matching slice of the base cap
+    switch(corner) {
+        case 0: return f32vec3(0.0);
+        case 1: return base_1;
+        case 2: return base_0;
+        case 3: return f32vec3(0.0, 0.0, 1.0);
+        case 4: return base_0;
+        default: return base_1;
+    }
+}
+
+void main() {
+    out_light_index = u32(gl_InstanceIndex);
+
+    f32vec3 world_position;
+    if(daxa_push_constant.light_type == LIGHT_VOLUME_POINT) {
+        PointLight light = deref(LIGHTS.point_lights[gl_InstanceIndex]);
+        world_position = light.position + sphere_vertex(u32(gl_VertexIndex)) * light.range;
+    } else {
+        SpotLight light = deref(LIGHTS.spot_lights[gl_InstanceIndex]);
+
+        // outer angles close to 90 degrees would need an unbounded base
+        f32 cos_angle = max(light.outer_cut_off, 0.05);
+        f32 radius = sqrt(1.0 - cos_angle * cos_angle) / cos_angle;
+
+        f32vec3 forward = normalize(light.direction);
+        f32vec3 up = abs(forward.y) > 0.99 ? f32vec3(1.0, 0.0, 0.0) : f32vec3(0.0, 1.0, 0.0);
+        f32vec3 right = normalize(cross(up, forward));
+        up = cross(forward, right);
+
+        f32vec3 local = cone_vertex(u32(gl_VertexIndex), radius) * light.range;
+        world_position = light.position + right * local.x + up * local.y + forward * local.z;
+    }
+
+    gl_Position = CAMERA.projection_matrix * CAMERA.view_matrix * f32vec4(world_position, 1.0);
+}
+
+#elif defined(DRAW_FRAG)
+
+layout(location = 0) flat in u32 in_light_index;
+layout(location = 0) out f32vec4 out_color;
+
+void main() {
+    i32vec2 coord = i32vec2(gl_FragCoord.xy);
+    f32 depth = fetch_texture(daxa_push_constant.depth, coord).r;
+
+    // background pixels are behind every volume, nothing to light there
+    if(depth >= 1.0) {
+        discard;
+    }
+
+    f32vec3 albedo = fetch_texture(daxa_push_constant.albedo, coord).rgb;
+    f32vec3 normal = decode_normal(fetch_texture(daxa_push_constant.normal, coord).rg);
+    f32vec2 uv = gl_FragCoord.xy / f32vec2(texture_size(daxa_push_constant.depth, 0));
+    f32vec3 position = reconstruct_world_position(CAMERA.inverse_projection_matrix, CAMERA.inverse_view_matrix, uv, depth);
+
+    f32vec3 color;
+    if(daxa_push_constant.light_type == LIGHT_VOLUME_POINT) {
+        f32 visibility = calculate_point_shadow(CAMERA.shadow_atlas_info, in_light_index, deref(LIGHTS.point_lights[in_light_index]).position, position, normal);
+        color = visibility * calculate_point_light(deref(LIGHTS.point_lights[in_light_index]), albedo, normal, position, CAMERA.position);
+    } else {
+        f32 visibility = calculate_spot_shadow(CAMERA.shadow_atlas_info, in_light_index, deref(LIGHTS.spot_lights[in_light_index]).position, position, normal);
+        color = visibility * calculate_spot_light(deref(LIGHTS.spot_lights[in_light_index]), albedo, normal, position, CAMERA.position);
+    }
+
+    out_color = f32vec4(color, 0.0);
+}
+
+#endif
@@ -1,5 +1,6 @@
 #include <shared.inl>
 #include <common/core.glsl>
+#include <common/g_buffer.glsl>
 
 DAXA_USE_PUSH_CONSTANT(SSAOGenerationPush)
 
@@ -22,12 +23,12 @@ layout (location = 0) out f32 out_ssao;
 
 void main() {
   
-        vec3 fragPos = (f32vec4(sample_texture(daxa_push_constant.position, in_uv).rgb, 0.0)).xyz;
-	    vec3 normal = normalize(sample_texture(daxa_push_constant.normal, in_uv).rgb) * 2.0 - 1.0;
-    
+	// everything happens in view space, the kernel is projected with the projection matrix alone
+	vec3 fragPos = reconstruct_view_position(CAMERA.inverse_projection_matrix, in_uv, fetch_texture(daxa_push_constant.depth, ivec2(gl_FragCoord.xy)).r);
+	vec3 normal = normalize(mat3(CAMERA.view_matrix) * decode_normal(fetch_texture(daxa_push_constant.normal, ivec2(gl_FragCoord.xy)).rg));
 
 	// Get a random vector using a noise lookup
-	ivec2 texDim = texture_size(daxa_push_constant.position, 0); 
+	ivec2 texDim = texture_size(daxa_push_constant.depth, 0); 
 	ivec2 noiseDim = texture_size(daxa_push_constant.ssao_noise, 0);
 	const vec2 noiseUV = vec2(float(texDim.x)/float(noiseDim.x), float(texDim.y)/(noiseDim.y)) * in_uv;  
 	vec3 randomVec = sample_texture(daxa_push_constant.ssao_noise, noiseUV).xyz * 2.0 - 1.0;
@@ -52,7 +53,7 @@ void main() {
 		offset.xyz /= offset.w; 
 		offset.xyz = offset.xyz * 0.5f + 0.5f; 
 		
-		float sampleDepth = -sample_texture(daxa_push_constant.normal, offset.xy).w; 
+		float sampleDepth = reconstruct_view_position(CAMERA.inverse_projection_matrix, offset.xy, fetch_texture(daxa_push_constant.depth, clamp(ivec2(offset.xy * vec2(texDim)), ivec2(0), texDim - 1)).r).z; 
 
 		float rangeCheck = smoothstep(0.0f, 1.0f, SSAO_RADIUS / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z + bias ? 1.0f : 0.0f) * rangeCheck;           
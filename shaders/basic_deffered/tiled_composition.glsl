@@ -0,0 +1,158 @@
+#include <shared.inl>
+#include <common/core.glsl>
+#include <common/shadows.glsl>
+#include <common/g_buffer.glsl>
+
+DAXA_USE_PUSH_CONSTANT(TiledCompositionPush)
+
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+#define LIGHTS deref(daxa_push_constant.lights_buffer)
+
+#define TILE_THREAD_COUNT (TILED_COMPOSITION_TILE_SIZE * TILED_COMPOSITION_TILE_SIZE)
+
+layout(local_size_x = TILED_COMPOSITION_TILE_SIZE, local_size_y = TILED_COMPOSITION_TILE_SIZE) in;
+
+// view depth is positive, so its float bits keep their ordering and can go through integer atomics
+shared u32 tile_min_depth;
+shared u32 tile_max_depth;
+shared u32 tile_point_light_count;
+shared u32 tile_spot_light_count;
+shared u32 tile_point_lights[MAX_LIGHTS_PER_TILE];
+shared u32 tile_spot_lights[MAX_LIGHTS_PER_TILE];
+
+f32vec3 screen_to_view(f32vec2 uv) {
+    f32vec4 view = CAMERA.inverse_projection_matrix * f32vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+    return view.xyz / view.w;
+}
+
+// side plane through the eye, flipped so the tile center lies on the positive side
+f32vec3 make_side_plane(f32vec3 a, f32vec3 b, f32vec3 inside) {
+    f32vec3 normal = normalize(cross(a, b));
+    return dot(normal, inside) < 0.0 ? -normal : normal;
+}
+
+bool sphere_intersects_tile(f32vec3 center, f32 radius, f32vec3 planes[4], f32 min_depth, f32 max_depth) {
+    f32 depth = -center.z;
+    if(depth + radius < min_depth || depth - radius > max_depth) {
+        return false;
+    }
+
+    for(u32 i = 0; i < 4; i++) {
+        if(dot(planes[i], center) < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void main() {
+    i32vec2 coord = i32vec2(gl_GlobalInvocationID.xy);
+    bool inside_screen = all(lessThan(gl_GlobalInvocationID.xy, daxa_push_constant.screen_size));
+
+    if(gl_LocalInvocationIndex == 0) {
+        tile_min_depth = floatBitsToUint(3.402823466e+38);
+        tile_max_depth = 0;
+        tile_point_light_count = 0;
+        tile_spot_light_count = 0;
+    }
+    barrier();
+
+    f32vec3 albedo = f32vec3(0.0);
+    f32vec3 normal = f32vec3(0.0);
+    f32vec3 position = f32vec3(0.0);
+    f32 view_depth = 0.0;
+    bool has_geometry = false;
+
+    if(inside_screen) {
+        albedo = fetch_texture(daxa_push_constant.albedo, coord).rgb;
+        f32 depth = fetch_texture(daxa_push_constant.depth, coord).r;
+
+        // the depth buffer is cleared to 1, so that depth means no geometry was drawn here
+        has_geometry = depth < 1.0;
+        if(has_geometry) {
+            normal = decode_normal(fetch_texture(daxa_push_constant.normal, coord).rg);
+            f32vec2 uv = (f32vec2(coord) + 0.5) / f32vec2(daxa_push_constant.screen_size);
+            f32vec3 view_position = reconstruct_view_position(CAMERA.inverse_projection_matrix, uv, depth);
+            position = (CAMERA.inverse_view_matrix * f32vec4(view_position, 1.0)).xyz;
+            view_depth = max(-view_position.z, 0.0);
+            atomicMin(tile_min_depth, floatBitsToUint(view_depth));
+            atomicMax(tile_max_depth, floatBitsToUint(view_depth));
+        }
+    }
+    barrier();
+
+    f32 min_depth = uintBitsToFloat(tile_min_depth);
+    f32 max_depth = uintBitsToFloat(tile_max_depth);
+
+    // tiles with nothing but background skip culling altogether
+    if(tile_max_depth != 0) {
+        f32vec2 screen_size = f32vec2(daxa_push_constant.screen_size);
+        f32vec2 uv_min = f32vec2(gl_WorkGroupID.xy * TILED_COMPOSITION_TILE_SIZE) / screen_size;
+        f32vec2 uv_max = f32vec2((gl_WorkGroupID.xy + 1) * TILED_COMPOSITION_TILE_SIZE) / screen_size;
+
+        f32vec3 top_left = screen_to_view(uv_min);
+        f32vec3 top_right = screen_to_view(f32vec2(uv_max.x, uv_min.y));
+        f32vec3 bottom_left = screen_to_view(f32vec2(uv_min.x, uv_max.y));
+        f32vec3 bottom_right = screen_to_view(uv_max);
+        f32vec3 center = screen_to_view((uv_min + uv_max) * 0.5);
+
+        f32vec3 planes[4];
+        planes[0] = make_side_plane(top_left, bottom_left, center);
+        planes[1] = make_side_plane(bottom_right, top_right, center);
+        planes[2] = make_side_plane(top_right, top_left, center);
+        planes[3] = make_side_plane(bottom_left, bottom_right, center);
+
+        for(u32 i = gl_LocalInvocationIndex; i < LIGHTS.num_point_lights; i += TILE_THREAD_COUNT) {
+            PointLight light = deref(LIGHTS.point_lights[i]);
+            f32vec3 view_position = (CAMERA.view_matrix * f32vec4(light.position, 1.0)).xyz;
+            if(sphere_intersects_tile(view_position, light.range, planes, min_depth, max_depth)) {
+                u32 slot = atomicAdd(tile_point_light_count, 1);
+                if(slot < MAX_LIGHTS_PER_TILE) {
+                    tile_point_lights[slot] = i;
+                }
+            }
+        }
+
+        for(u32 i = gl_LocalInvocationIndex; i < LIGHTS.num_spot_lights; i += TILE_THREAD_COUNT) {
+            SpotLight light = deref(LIGHTS.spot_lights[i]);
+            f32vec3 view_position = (CAMERA.view_matrix * f32vec4(light.position, 1.0)).xyz;
+            if(sphere_intersects_tile(view_position, light.range, planes, min_depth, max_depth)) {
+                u32 slot = atomicAdd(tile_spot_light_count, 1);
+                if(slot < MAX_LIGHTS_PER_TILE) {
+                    tile_spot_lights[slot] = i;
+                }
+            }
+        }
+    }
+    barrier();
+
+    if(!inside_screen) {
+        return;
+    }
+
+    f32vec3 color = albedo;
+    if(has_geometry) {
+        f32vec3 camera_position = CAMERA.position;
+
+        // only the first directional light casts shadows
+        f32 shadow = calculate_shadow(CAMERA.shadow_info, position, normal, view_depth);
+        for(uint i = 0; i < LIGHTS.num_directional_lights; i++) {
+            f32 visibility = i == 0 ? shadow : 1.0;
+            color += visibility * calculate_directional_light(deref(LIGHTS.directional_lights[i]), color, normal, position, camera_position);
+        }
+
+        u32 point_light_count = min(tile_point_light_count, u32(MAX_LIGHTS_PER_TILE));
+        for(uint i = 0; i < point_light_count; i++) {
+            f32 visibility = calculate_point_shadow(CAMERA.shadow_atlas_info, tile_point_lights[i], deref(LIGHTS.point_lights[tile_point_lights[i]]).position, position, normal);
+            color += visibility * calculate_point_light(deref(LIGHTS.point_lights[tile_point_lights[i]]), color, normal, position, camera_position);
+        }
+
+        u32 spot_light_count = min(tile_spot_light_count, u32(MAX_LIGHTS_PER_TILE));
+        for(uint i = 0; i < spot_light_count; i++) {
+            f32 visibility = calculate_spot_shadow(CAMERA.shadow_atlas_info, tile_spot_lights[i], deref(LIGHTS.spot_lights[tile_spot_lights[i]]).position, position, normal);
+            color += visibility * calculate_spot_light(deref(LIGHTS.spot_lights[tile_spot_lights[i]]), color, normal, position, camera_position);
+        }
+    }
+
+    store_image(daxa_push_constant.output_image, coord, f32vec4(color, 1.0));
+}
@@ -1,41 +1,60 @@
 #include <shared.inl>
 #include <common/core.glsl>
+#include <common/clustering.glsl>
+#include <common/shadows.glsl>
 
 DAXA_USE_PUSH_CONSTANT(DrawPush)
 
+#if defined(SETTINGS_GPU_DRIVEN)
+// first_instance of the indirect command is the instance index, the fragment stage gets it passed down
+#define INSTANCE deref(daxa_push_constant.instance_buffer[gl_InstanceIndex])
+#define VERTEX deref(INSTANCE.vertex_buffer[gl_VertexIndex])
+#define OBJECT deref(INSTANCE.object_buffer)
+#define MATERIAL deref(deref(daxa_push_constant.instance_buffer[v_instance_index]).material_info_buffer)
+#else
 #define VERTEX deref(daxa_push_constant.face_buffer[gl_VertexIndex])
 #define OBJECT deref(daxa_push_constant.object_buffer)
-#define CAMERA deref(daxa_push_constant.camera_buffer)
 #define MATERIAL deref(daxa_push_constant.material_info_buffer)
+#endif
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+#define LIGHTS deref(daxa_push_constant.lights_buffer)
+#define CLUSTERS deref(daxa_push_constant.clusters_buffer)
 
 #if defined(DRAW_VERT)
 layout(location = 0) out f32vec2 v_uv;
 layout(location = 1) out f32vec3 v_position;
 layout(location = 2) out f32vec3 v_camera_position;
-#if defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-layout(location = 3) out f32mat3x3 v_tbn;
-#else
 layout(location = 3) out f32vec3 v_normal;
+// w is the bittangent sign, only written when normal mapping uses the vertex tangents
+layout(location = 4) out f32vec4 v_tangent;
+#if defined(SETTINGS_GPU_DRIVEN)
+layout(location = 6) flat out u32 v_instance_index;
 #endif
+// has to match the depth pre-pass bit for bit
+invariant gl_Position;
 
 void main() {
+#if defined(SETTINGS_GPU_DRIVEN)
+    v_instance_index = u32(gl_InstanceIndex);
+#endif
     f32vec3 position = (OBJECT.model_matrix * f32vec4(VERTEX.position.xyz, 1)).xyz;
     gl_Position = CAMERA.projection_matrix * CAMERA.view_matrix * f32vec4(position.xyz, 1);
 
     v_uv = VERTEX.uv.xy;
-#if !defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-    v_normal = f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz;
-#else
-    f32vec3 normal = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz);
-    f32vec3 tangent = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.tangent.xyz);
-    
-#if defined(SETTINGS_NORMAL_MAPPING_REORTHOGONALIZE_TBN_VECTORS)
-    tangent = normalize(tangent - dot(tangent, normal) * normal);
-#endif
-
-    f32vec3 bittangent = normalize(cross(normal, tangent) * VERTEX.tangent.w);
-    v_tbn = f32mat3x3(tangent, bittangent, normal);
-#endif
+    v_tangent = f32vec4(0.0);
+    if(NORMAL_MAPPING_MODE != NORMAL_MAPPING_MODE_USING_TANGENTS) {
+        v_normal = f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz;
+    } else {
+        f32vec3 normal = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.normal.xyz);
+        f32vec3 tangent = normalize(f32mat3x3(OBJECT.normal_matrix) * VERTEX.tangent.xyz);
+
+        if(REORTHOGONALIZE_TBN) {
+            tangent = normalize(tangent - dot(tangent, normal) * normal);
+        }
+
+        v_normal = normal;
+        v_tangent = f32vec4(tangent, VERTEX.tangent.w);
+    }
     v_position = position.xyz;
     v_camera_position = CAMERA.position;
     //v_camera_position = push_constant.camera_position;
@@ -45,10 +64,10 @@ void main() {
 layout(location = 0) in f32vec2 v_uv;
 layout(location = 1) in f32vec3 v_position;
 layout(location = 2) in f32vec3 v_camera_position;
-#if defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-layout(location = 3) in f32mat3x3 v_tbn;
-#else
 layout(location = 3) in f32vec3 v_normal;
+layout(location = 4) in f32vec4 v_tangent;
+#if defined(SETTINGS_GPU_DRIVEN)
+layout(location = 6) flat in u32 v_instance_index;
 #endif
 
 layout(location = 0) out f32vec4 out_color;
@@ -63,11 +82,7 @@ vec3 getNormalFromMap(TextureId normal_map) {
     vec2 st1 = dFdx(v_uv);
     vec2 st2 = dFdy(v_uv);
 
-#if defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-    vec3 N   = normalize(v_tbn[2]);
-#else
     vec3 N   = normalize(v_normal);
-#endif
     vec3 T  = normalize(Q1*st2.t - Q2*st1.t);
     vec3 B  = -normalize(cross(N, T));
     mat3 TBN = mat3(T, B, N);
@@ -75,37 +90,62 @@ vec3 getNormalFromMap(TextureId normal_map) {
     return normalize(TBN * tangentNormal);
 }
 
-void main() {
-#if defined(SETTINGS_TEXTURING_NONE)
-    f32vec3 color = f32vec3(1.0, 1.0, 1.0);
-#elif defined(SETTINGS_TEXTURING_VERTEX_COLOR)
-    f32vec3 color = f32vec3(0.5, 0.5, 0.5);
-#elif defined(SETTINGS_TEXTURING_ALBEDO)
-    f32vec3 color = sample_texture(MATERIAL.albedo, v_uv).rgb;
-#else
-    f32vec3 color = f32vec3(0.0, 0.0, 0.0);
-#endif
-
-#if !defined(SETTINGS_SHADING_MODEL_NONE)
-#if defined(SETTINGS_NORMAL_MAPPING_NONE)
+f32vec3 getNormalFromTangents(TextureId normal_map) {
     f32vec3 normal = normalize(v_normal);
-#elif defined(SETTINGS_NORMAL_MAPPING_CALCULATING_TBN_VECTORS)
-    f32vec3 normal = getNormalFromMap(MATERIAL.normal_map);
-#elif defined(SETTINGS_NORMAL_MAPPING_USING_TANGENTS)
-    f32vec3 normal = normalize(v_tbn * normalize(sample_texture(MATERIAL.normal_map, v_uv).rgb * 2.0 - 1.0));
-#endif
-    for(uint i = 0; i < deref(daxa_push_constant.lights_buffer).num_directional_lights; i++) {
-        color += calculate_directional_light(deref(daxa_push_constant.lights_buffer).directional_lights[i], color, normal, v_position, v_camera_position);
+    f32vec3 tangent = normalize(v_tangent.xyz);
+    f32vec3 bittangent = normalize(cross(normal, tangent) * v_tangent.w);
+    f32mat3x3 tbn = f32mat3x3(tangent, bittangent, normal);
+    return normalize(tbn * normalize(sample_texture(normal_map, v_uv).rgb * 2.0 - 1.0));
+}
+
+void main() {
+    if(material_alpha_tested() && material_alpha(MATERIAL, v_uv) < MATERIAL.alpha_cutoff) {
+        discard;
     }
 
-    for(uint i = 0; i < deref(daxa_push_constant.lights_buffer).num_point_lights; i++) {
-        color += calculate_point_light(deref(daxa_push_constant.lights_buffer).point_lights[i], color, normal, v_position, v_camera_position);
+    // the modes are specialization constants, the branches not taken are folded away when the pipeline is created
+    f32vec3 color = f32vec3(0.0, 0.0, 0.0);
+    if(TEXTURING_MODE == TEXTURING_MODE_NONE) {
+        color = f32vec3(1.0, 1.0, 1.0);
+    } else if(TEXTURING_MODE == TEXTURING_MODE_VERTEX_COLOR) {
+        color = f32vec3(0.5, 0.5, 0.5);
+    } else if(TEXTURING_MODE == TEXTURING_MODE_ALBEDO) {
+        // a material without the texture samples white
+        color = material_has_feature(MATERIAL, MATERIAL_FEATURE_ALBEDO) ? sample_texture(MATERIAL.albedo, v_uv).rgb : f32vec3(1.0, 1.0, 1.0);
     }
 
-    for(uint i = 0; i < deref(daxa_push_constant.lights_buffer).num_spot_lights; i++) {
-        color += calculate_spot_light(deref(daxa_push_constant.lights_buffer).spot_lights[i], color, normal, v_position, v_camera_position);
+    if(SHADING_MODEL != SHADING_MODEL_NONE) {
+        f32vec3 normal = normalize(v_normal);
+        if(material_has_feature(MATERIAL, MATERIAL_FEATURE_NORMAL_MAP)) {
+            if(NORMAL_MAPPING_MODE == NORMAL_MAPPING_MODE_CALCULATING_TBN_VECTORS) {
+                normal = getNormalFromMap(MATERIAL.normal_map);
+            } else if(NORMAL_MAPPING_MODE == NORMAL_MAPPING_MODE_USING_TANGENTS) {
+                normal = getNormalFromTangents(MATERIAL.normal_map);
+            }
+        }
+        f32 view_depth = -(CAMERA.view_matrix * f32vec4(v_position, 1.0)).z;
+        // only the first directional light casts shadows
+        f32 shadow = calculate_shadow(CAMERA.shadow_info, v_position, normal, view_depth);
+        for(uint i = 0; i < LIGHTS.num_directional_lights; i++) {
+            f32 visibility = i == 0 ? shadow : 1.0;
+            color += visibility * calculate_directional_light(deref(LIGHTS.directional_lights[i]), color, normal, v_position, v_camera_position);
+        }
+        u32 cluster_index = get_cluster_index(gl_FragCoord.xy / CLUSTERS.screen_size, view_depth, CAMERA.near_plane, CAMERA.far_plane);
+        u32 point_light_count = CLUSTERS.clusters[cluster_index].point_light_count;
+        u32 spot_light_count = CLUSTERS.clusters[cluster_index].spot_light_count;
+
+        for(uint i = 0; i < point_light_count; i++) {
+            u32 light_index = CLUSTERS.clusters[cluster_index].light_indices[i];
+            f32 visibility = calculate_point_shadow(CAMERA.shadow_atlas_info, light_index, deref(LIGHTS.point_lights[light_index]).position, v_position, normal);
+            color += visibility * calculate_point_light(deref(LIGHTS.point_lights[light_index]), color, normal, v_position, v_camera_position);
+        }
+
+        for(uint i = point_light_count; i < point_light_count + spot_light_count; i++) {
+            u32 light_index = CLUSTERS.clusters[cluster_index].light_indices[i];
+            f32 visibility = calculate_spot_shadow(CAMERA.shadow_atlas_info, light_index, deref(LIGHTS.spot_lights[light_index]).position, v_position, normal);
+            color += visibility * calculate_spot_light(deref(LIGHTS.spot_lights[light_index]), color, normal, v_position, v_camera_position);
+        }
     }
-    #endif
 
     out_color = vec4(color, 1.0);
 }
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <shared.inl>
+
+u32 get_cluster_index(f32vec2 screen_uv, f32 view_depth, f32 near_plane, f32 far_plane) {
+    u32vec2 tile = u32vec2(clamp(screen_uv, 0.0, 0.9999) * f32vec2(CLUSTER_X, CLUSTER_Y));
+    f32 slice = floor(log(max(view_depth, near_plane) / near_plane) / log(far_plane / near_plane) * f32(CLUSTER_Z));
+    u32 z = u32(clamp(slice, 0.0, f32(CLUSTER_Z - 1)));
+    return tile.x + tile.y * CLUSTER_X + z * CLUSTER_X * CLUSTER_Y;
+}
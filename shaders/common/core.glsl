@@ -3,9 +3,23 @@
 #include <shared.inl>
 
 #define sample_texture(texture_id, uv) texture(sampler2D(daxa_get_texture(texture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), uv)
+#define sample_texture_array(texture_id, uvw) texture(sampler2DArray(daxa_get_texture(texture2DArray, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), uvw)
 #define sample_cube_map(texture_id, uv) texture(samplerCube(daxa_get_texture(textureCube, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), uv)
 #define get_cube_sampler(texture_id) samplerCube(daxa_get_texture(textureCube, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id))
 #define get_cube_map_size(texture_id, mip_level) textureSize(samplerCube(daxa_get_texture(textureCube, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), mip_level)
 #define get_cube_map_lod(texture_id, uv, mip_level) textureLod(samplerCube(daxa_get_texture(textureCube, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), uv, mip_level)
 #define read_buffer(type, ptr) daxa_buffer_address_to_ref(type, ptr)
-#define texture_size(texture_id, mip) textureSize(sampler2D(daxa_get_texture(texture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), mip)
\ No newline at end of file
+#define texture_size(texture_id, mip) textureSize(sampler2D(daxa_get_texture(texture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), mip)
+#define sample_texture_grad(texture_id, uv, ddx, ddy) textureGrad(sampler2D(daxa_get_texture(texture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), uv, ddx, ddy)
+#define fetch_texture(texture_id, coord) texelFetch(sampler2D(daxa_get_texture(texture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), coord, 0)
+#define fetch_texture_lod(texture_id, coord, lod) texelFetch(sampler2D(daxa_get_texture(texture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), coord, lod)
+#define load_image(image_view_id, coord) imageLoad(daxa_get_image(image2D, image_view_id), coord)
+#define fetch_uint_texture(texture_id, coord) texelFetch(usampler2D(daxa_get_texture(utexture2D, texture_id.image_view_id), daxa_get_sampler(texture_id.sampler_id)), coord, 0)
+#define store_image(image_view_id, coord, value) imageStore(daxa_get_image(image2D, image_view_id), coord, value)
+// constant for the pipeline of a material bucket, so the fetches of a missing feature are compiled out
+#define material_has_feature(material, feature) (MATERIAL_FEATURES == MATERIAL_FEATURES_DYNAMIC ? (material.features & (feature)) != 0 : (MATERIAL_FEATURES & (feature)) != 0)
+// only the masked buckets discard, the pipelines drawing every bucket at once keep early depth testing like the
+// opaque ones and draw masked materials opaque
+#define material_alpha_tested() (MATERIAL_FEATURES != MATERIAL_FEATURES_DYNAMIC && (MATERIAL_FEATURES & MATERIAL_FEATURE_ALPHA_MASK) != 0)
+// as in glTF the factor scales the texture's alpha, without a texture the factor alone is the alpha
+#define material_alpha(material, uv) ((material_has_feature(material, MATERIAL_FEATURE_ALBEDO) ? sample_texture(material.albedo, uv).a : 1.0) * material.albedo_factor.a)
\ No newline at end of file
@@ -0,0 +1,48 @@
+#include <shared.inl>
+#include <common/core.glsl>
+
+DAXA_USE_PUSH_CONSTANT(DrawPush)
+
+// only the packed positions are fetched, a quarter of what the full vertex would cost
+#if defined(SETTINGS_GPU_DRIVEN)
+#define INSTANCE deref(daxa_push_constant.instance_buffer[gl_InstanceIndex])
+#define POSITION deref(INSTANCE.position_buffer[gl_VertexIndex]).value
+#define OBJECT deref(INSTANCE.object_buffer)
+#else
+#define POSITION deref(daxa_push_constant.position_buffer[gl_VertexIndex]).value
+#define OBJECT deref(daxa_push_constant.object_buffer)
+// the alpha masked pipeline also needs the uv and the material, it is only used with cpu submission
+#define VERTEX deref(daxa_push_constant.face_buffer[gl_VertexIndex])
+#define MATERIAL deref(daxa_push_constant.material_info_buffer)
+#endif
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+
+#if defined(DRAW_VERT)
+#if !defined(SETTINGS_GPU_DRIVEN)
+layout(location = 0) out f32vec2 v_uv;
+#endif
+// the shading pass tests against this depth with EQUAL, so both have to compute the exact same position
+invariant gl_Position;
+
+void main() {
+    f32vec3 position = (OBJECT.model_matrix * f32vec4(POSITION.xyz, 1)).xyz;
+    gl_Position = CAMERA.projection_matrix * CAMERA.view_matrix * f32vec4(position.xyz, 1);
+#if !defined(SETTINGS_GPU_DRIVEN)
+    v_uv = material_alpha_tested() ? VERTEX.uv.xy : f32vec2(0.0);
+#endif
+}
+
+#elif defined(DRAW_FRAG)
+#if !defined(SETTINGS_GPU_DRIVEN)
+layout(location = 0) in f32vec2 v_uv;
+#endif
+
+void main() {
+#if !defined(SETTINGS_GPU_DRIVEN)
+    if(material_alpha_tested() && material_alpha(MATERIAL, v_uv) < MATERIAL.alpha_cutoff) {
+        discard;
+    }
+#endif
+}
+
+#endif
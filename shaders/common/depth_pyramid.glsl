@@ -0,0 +1,119 @@
+#include <shared.inl>
+#include <common/core.glsl>
+
+DAXA_USE_PUSH_CONSTANT(DepthPyramidPush)
+
+layout(local_size_x = DEPTH_PYRAMID_GROUP_SIZE, local_size_y = DEPTH_PYRAMID_GROUP_SIZE) in;
+
+shared f32 tile[DEPTH_PYRAMID_GROUP_SIZE][DEPTH_PYRAMID_GROUP_SIZE];
+shared bool is_last_group;
+
+// the last group reads levels the other groups stored, daxa's image table is not coherent so the levels are
+// accessed through a coherent alias of the same binding
+layout(binding = DAXA_STORAGE_IMAGE_BINDING, set = 0) coherent uniform image2D coherent_images[];
+#define mip_image(mip) coherent_images[daxa_id_to_index(daxa_push_constant.mips[mip])]
+
+u32vec2 mip_size(u32 mip) {
+    return max(daxa_push_constant.pyramid_size >> mip, u32vec2(1));
+}
+
+// the pyramid is scaled down to a power of two, so a texel of the first level covers up to 2x2 depth texels
+f32 reduce_depth(u32vec2 texel) {
+    u32vec2 depth_size = daxa_push_constant.depth_size;
+    u32vec2 pyramid_size = daxa_push_constant.pyramid_size;
+    u32vec2 begin = (texel * depth_size) / pyramid_size;
+    u32vec2 end = min(((texel + 1) * depth_size + pyramid_size - 1) / pyramid_size, depth_size);
+
+    f32 depth = 0.0;
+    for(u32 y = begin.y; y < end.y; y++) {
+        for(u32 x = begin.x; x < end.x; x++) {
+            depth = max(depth, fetch_texture(daxa_push_constant.depth, i32vec2(x, y)).r);
+        }
+    }
+    return depth;
+}
+
+void store_mip(u32 mip, u32vec2 texel, f32 depth) {
+    if(all(lessThan(texel, mip_size(mip)))) {
+        imageStore(mip_image(mip), i32vec2(texel), f32vec4(depth));
+    }
+}
+
+void main() {
+    u32vec2 local = gl_LocalInvocationID.xy;
+    u32vec2 tile_origin = gl_WorkGroupID.xy * DEPTH_PYRAMID_TILE_SIZE;
+
+    // level 0, every invocation writes a 2x2 quad and keeps its maximum for level 1
+    f32 depth = 0.0;
+    for(u32 i = 0; i < 4; i++) {
+        u32vec2 texel = tile_origin + local * 2 + u32vec2(i & 1, i >> 1);
+        if(all(lessThan(texel, daxa_push_constant.pyramid_size))) {
+            f32 value = reduce_depth(texel);
+            imageStore(mip_image(0), i32vec2(texel), f32vec4(value));
+            depth = max(depth, value);
+        }
+    }
+
+    if(daxa_push_constant.mip_count > 1) {
+        store_mip(1, (tile_origin >> 1) + local, depth);
+    }
+    tile[local.y][local.x] = depth;
+    barrier();
+
+    // the following levels of this tile are reduced in shared memory
+    u32 size = DEPTH_PYRAMID_GROUP_SIZE;
+    for(u32 mip = 2; mip < min(daxa_push_constant.mip_count, DEPTH_PYRAMID_SHARED_MIPS); mip++) {
+        size /= 2;
+        bool active = all(lessThan(local, u32vec2(size)));
+        if(active) {
+            u32vec2 source = local * 2;
+            depth = max(
+                max(tile[source.y][source.x], tile[source.y][source.x + 1]),
+                max(tile[source.y + 1][source.x], tile[source.y + 1][source.x + 1])
+            );
+        }
+        barrier();
+
+        if(active) {
+            tile[local.y][local.x] = depth;
+            store_mip(mip, (tile_origin >> mip) + local, depth);
+        }
+        barrier();
+    }
+
+    if(daxa_push_constant.mip_count <= DEPTH_PYRAMID_SHARED_MIPS) {
+        return;
+    }
+
+    // the last group to finish sees every tile and reduces the remaining small levels
+    memoryBarrierImage();
+    barrier();
+    if(gl_LocalInvocationIndex == 0) {
+        is_last_group = atomicAdd(deref(daxa_push_constant.counter_buffer).value, 1) == daxa_push_constant.group_count - 1;
+    }
+    barrier();
+
+    if(!is_last_group) {
+        return;
+    }
+    // pairs with the barrier the other groups made before counting themselves in
+    memoryBarrierImage();
+
+    for(u32 mip = DEPTH_PYRAMID_SHARED_MIPS; mip < daxa_push_constant.mip_count; mip++) {
+        u32vec2 level_size = mip_size(mip);
+        i32vec2 source_max = i32vec2(mip_size(mip - 1)) - 1;
+
+        for(u32 i = gl_LocalInvocationIndex; i < level_size.x * level_size.y; i += DEPTH_PYRAMID_GROUP_SIZE * DEPTH_PYRAMID_GROUP_SIZE) {
+            i32vec2 texel = i32vec2(i % level_size.x, i / level_size.x);
+            i32vec2 source = texel * 2;
+            f32 value = max(
+                max(imageLoad(mip_image(mip - 1), min(source, source_max)).r, imageLoad(mip_image(mip - 1), min(source + i32vec2(1, 0), source_max)).r),
+                max(imageLoad(mip_image(mip - 1), min(source + i32vec2(0, 1), source_max)).r, imageLoad(mip_image(mip - 1), min(source + i32vec2(1, 1), source_max)).r)
+            );
+            imageStore(mip_image(mip), texel, f32vec4(value));
+        }
+
+        memoryBarrierImage();
+        barrier();
+    }
+}
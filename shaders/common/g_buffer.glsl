@@ -0,0 +1,36 @@
+#pragma once
+
+#include <shared.inl>
+#include <common/core.glsl>
+
+// layout of the deferred G-buffer
+// albedo: rgba8 srgb, albedo in rgb, a is unused while none of the shading models reads metallic or roughness
+// normal: rg16f, octahedral world space normal
+// the position is not stored, it is rebuilt from the depth buffer
+
+f32vec2 octahedral_wrap(f32vec2 v) {
+    return (1.0 - abs(v.yx)) * f32vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+f32vec2 encode_normal(f32vec3 normal) {
+    normal /= abs(normal.x) + abs(normal.y) + abs(normal.z);
+    return normal.z >= 0.0 ? normal.xy : octahedral_wrap(normal.xy);
+}
+
+f32vec3 decode_normal(f32vec2 encoded) {
+    f32vec3 normal = f32vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    f32 fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+
+// uv covers the screen from 0 to 1, depth is the raw value of the depth buffer
+f32vec3 reconstruct_view_position(f32mat4x4 inverse_projection, f32vec2 uv, f32 depth) {
+    f32vec4 view = inverse_projection * f32vec4(uv * 2.0 - 1.0, depth, 1.0);
+    return view.xyz / view.w;
+}
+
+f32vec3 reconstruct_world_position(f32mat4x4 inverse_projection, f32mat4x4 inverse_view, f32vec2 uv, f32 depth) {
+    return (inverse_view * f32vec4(reconstruct_view_position(inverse_projection, uv, depth), 1.0)).xyz;
+}
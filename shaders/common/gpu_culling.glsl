@@ -0,0 +1,125 @@
+#include <shared.inl>
+#include <common/core.glsl>
+
+DAXA_USE_PUSH_CONSTANT(GPUCullingPush)
+
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+
+layout(local_size_x = GPU_CULLING_GROUP_SIZE) in;
+
+bool is_inside_frustum(f32mat4x4 view_projection, f32vec3 center, f32vec3 extent) {
+    f32mat4x4 rows = transpose(view_projection);
+    // clip space depth goes from 0 to 1, so the near plane is the z row on its own
+    f32vec4 planes[6] = f32vec4[](
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[2],
+        rows[3] - rows[2]
+    );
+
+    for(u32 i = 0; i < 6; i++) {
+        f32 distance = dot(planes[i].xyz, center) + planes[i].w;
+        f32 radius = dot(abs(planes[i].xyz), extent);
+        if(distance + radius < 0.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the box is occluded when its nearest depth lies behind the farthest depth of the pyramid texels it covers
+bool is_occluded(f32mat4x4 view_projection, f32vec3 center, f32vec3 extent) {
+    f32vec2 uv_min = f32vec2(1.0);
+    f32vec2 uv_max = f32vec2(0.0);
+    f32 nearest_depth = 1.0;
+
+    for(u32 i = 0; i < 8; i++) {
+        f32vec3 corner = center + extent * f32vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        f32vec4 clip = view_projection * f32vec4(corner, 1.0);
+        // boxes crossing the near plane can not be projected, keep them
+        if(clip.w <= CAMERA.near_plane) {
+            return false;
+        }
+
+        f32vec3 ndc = clip.xyz / clip.w;
+        f32vec2 uv = ndc.xy * 0.5 + 0.5;
+        uv_min = min(uv_min, uv);
+        uv_max = max(uv_max, uv);
+        nearest_depth = min(nearest_depth, ndc.z);
+    }
+
+    uv_min = clamp(uv_min, 0.0, 1.0);
+    uv_max = clamp(uv_max, 0.0, 1.0);
+
+    // pick the level where the rectangle spans at most 2x2 texels
+    f32vec2 pyramid_size = f32vec2(daxa_push_constant.depth_pyramid_size);
+    f32vec2 extent_texels = (uv_max - uv_min) * pyramid_size;
+    i32 level = clamp(i32(ceil(log2(max(max(extent_texels.x, extent_texels.y), 1.0)))), 0, i32(daxa_push_constant.depth_pyramid_mip_count) - 1);
+
+    i32vec2 level_size = max(i32vec2(daxa_push_constant.depth_pyramid_size) >> level, i32vec2(1));
+    i32vec2 texel_min = min(i32vec2(uv_min * f32vec2(level_size)), level_size - 1);
+    i32vec2 texel_max = min(i32vec2(uv_max * f32vec2(level_size)), level_size - 1);
+
+    f32 farthest_depth = 0.0;
+    for(i32 y = texel_min.y; y <= texel_max.y; y++) {
+        for(i32 x = texel_min.x; x <= texel_max.x; x++) {
+            farthest_depth = max(farthest_depth, fetch_texture_lod(daxa_push_constant.depth_pyramid, i32vec2(x, y), level).r);
+        }
+    }
+
+    return nearest_depth > farthest_depth;
+}
+
+void main() {
+    u32 instance_index = gl_GlobalInvocationID.x;
+    if(instance_index >= daxa_push_constant.instance_count) {
+        return;
+    }
+
+    DrawInstance instance = deref(daxa_push_constant.instance_buffer[instance_index]);
+    u32 phase = daxa_push_constant.phase;
+
+    // the early phase only takes what survived last frame, the late phase decides this frame's visibility
+    bool was_visible = phase == GPU_CULLING_PHASE_ALL || deref(daxa_push_constant.visibility_buffer[instance_index]).value != 0;
+    if(phase == GPU_CULLING_PHASE_EARLY && !was_visible) {
+        return;
+    }
+
+    bool visible = true;
+    if(daxa_push_constant.frustum_culling != 0 || phase == GPU_CULLING_PHASE_LATE) {
+        f32mat4x4 model_matrix = deref(instance.object_buffer).model_matrix;
+        f32mat3x3 absolute = f32mat3x3(abs(model_matrix[0].xyz), abs(model_matrix[1].xyz), abs(model_matrix[2].xyz));
+        f32vec3 center = (model_matrix * f32vec4(instance.aabb_center, 1.0)).xyz;
+        f32vec3 extent = absolute * instance.aabb_extent;
+        f32mat4x4 view_projection = CAMERA.projection_matrix * CAMERA.view_matrix;
+
+        if(daxa_push_constant.frustum_culling != 0) {
+            visible = is_inside_frustum(view_projection, center, extent);
+        }
+
+        if(visible && phase == GPU_CULLING_PHASE_LATE) {
+            visible = !is_occluded(view_projection, center, extent);
+        }
+    }
+
+    if(phase == GPU_CULLING_PHASE_LATE) {
+        deref(daxa_push_constant.visibility_buffer[instance_index]).value = visible ? 1 : 0;
+        // whatever was visible last frame has already been drawn by the early phase
+        visible = visible && !was_visible;
+    }
+
+    if(!visible) {
+        return;
+    }
+
+    u32 slot = atomicAdd(deref(daxa_push_constant.count_buffer[instance.batch_index]).value, 1);
+    deref(daxa_push_constant.command_buffer[instance.first_command + slot]) = DrawIndexedIndirectCommand(
+        instance.index_count,
+        1,
+        instance.first_index,
+        instance.vertex_offset,
+        instance_index
+    );
+}
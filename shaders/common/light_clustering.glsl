@@ -0,0 +1,116 @@
+#include <shared.inl>
+#include <common/core.glsl>
+
+DAXA_USE_PUSH_CONSTANT(LightClusteringPush)
+
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+#define LIGHTS deref(daxa_push_constant.lights_buffer)
+#define CLUSTERS deref(daxa_push_constant.clusters_buffer)
+
+layout(local_size_x = LIGHT_CLUSTERING_GROUP_SIZE) in;
+
+// lights are streamed through shared memory in batches, every cluster of the group tests the same batch
+shared f32vec4 shared_lights[LIGHT_CLUSTERING_GROUP_SIZE];
+
+f32vec3 screen_to_view(f32vec2 uv, f32 view_depth) {
+    f32vec4 view = CAMERA.inverse_projection_matrix * f32vec4(uv * 2.0 - 1.0, 1.0, 1.0);
+    view.xyz /= view.w;
+    return view.xyz * (view_depth / -view.z);
+}
+
+bool sphere_intersects_aabb(f32vec4 sphere, f32vec3 aabb_min, f32vec3 aabb_max) {
+    f32vec3 closest = clamp(sphere.xyz, aabb_min, aabb_max) - sphere.xyz;
+    return dot(closest, closest) <= sphere.w * sphere.w;
+}
+
+void main() {
+    u32 cluster_index = gl_GlobalInvocationID.x;
+    bool active = cluster_index < CLUSTER_COUNT;
+
+    if(cluster_index == 0) {
+        CLUSTERS.screen_size = daxa_push_constant.screen_size;
+    }
+
+    u32 x = cluster_index % CLUSTER_X;
+    u32 y = (cluster_index / CLUSTER_X) % CLUSTER_Y;
+    u32 z = cluster_index / (CLUSTER_X * CLUSTER_Y);
+
+    f32 near_plane = CAMERA.near_plane;
+    f32 far_plane = CAMERA.far_plane;
+    f32 slice_near = near_plane * pow(far_plane / near_plane, f32(z) / f32(CLUSTER_Z));
+    f32 slice_far = near_plane * pow(far_plane / near_plane, f32(z + 1) / f32(CLUSTER_Z));
+
+    f32vec2 uv_min = f32vec2(x, y) / f32vec2(CLUSTER_X, CLUSTER_Y);
+    f32vec2 uv_max = f32vec2(x + 1, y + 1) / f32vec2(CLUSTER_X, CLUSTER_Y);
+
+    f32vec3 aabb_min = f32vec3(1e30);
+    f32vec3 aabb_max = f32vec3(-1e30);
+    for(u32 i = 0; i < 8; i++) {
+        f32vec2 uv = f32vec2((i & 1) != 0 ? uv_max.x : uv_min.x, (i & 2) != 0 ? uv_max.y : uv_min.y);
+        f32vec3 corner = screen_to_view(uv, (i & 4) != 0 ? slice_far : slice_near);
+        aabb_min = min(aabb_min, corner);
+        aabb_max = max(aabb_max, corner);
+    }
+
+    u32 point_light_count = 0;
+    u32 spot_light_count = 0;
+    bool overflowed = false;
+
+    u32 num_point_lights = LIGHTS.num_point_lights;
+    for(u32 base = 0; base < num_point_lights; base += LIGHT_CLUSTERING_GROUP_SIZE) {
+        u32 light_index = base + gl_LocalInvocationIndex;
+        if(light_index < num_point_lights) {
+            PointLight light = deref(LIGHTS.point_lights[light_index]);
+            shared_lights[gl_LocalInvocationIndex] = f32vec4((CAMERA.view_matrix * f32vec4(light.position, 1.0)).xyz, light.range);
+        }
+        memoryBarrierShared();
+        barrier();
+
+        u32 batch_size = min(u32(LIGHT_CLUSTERING_GROUP_SIZE), num_point_lights - base);
+        for(u32 i = 0; active && i < batch_size; i++) {
+            if(sphere_intersects_aabb(shared_lights[i], aabb_min, aabb_max)) {
+                if(point_light_count < MAX_POINT_LIGHTS_PER_CLUSTER) {
+                    CLUSTERS.clusters[cluster_index].light_indices[point_light_count] = base + i;
+                    point_light_count++;
+                } else {
+                    overflowed = true;
+                }
+            }
+        }
+        barrier();
+    }
+
+    // spot lights are culled by the bounding sphere of their cone's range
+    u32 num_spot_lights = LIGHTS.num_spot_lights;
+    for(u32 base = 0; base < num_spot_lights; base += LIGHT_CLUSTERING_GROUP_SIZE) {
+        u32 light_index = base + gl_LocalInvocationIndex;
+        if(light_index < num_spot_lights) {
+            SpotLight light = deref(LIGHTS.spot_lights[light_index]);
+            shared_lights[gl_LocalInvocationIndex] = f32vec4((CAMERA.view_matrix * f32vec4(light.position, 1.0)).xyz, light.range);
+        }
+        memoryBarrierShared();
+        barrier();
+
+        // spot lights follow the point lights, the list stays packed for the shading passes
+        u32 batch_size = min(u32(LIGHT_CLUSTERING_GROUP_SIZE), num_spot_lights - base);
+        for(u32 i = 0; active && i < batch_size; i++) {
+            if(sphere_intersects_aabb(shared_lights[i], aabb_min, aabb_max)) {
+                if(spot_light_count < MAX_SPOT_LIGHTS_PER_CLUSTER) {
+                    CLUSTERS.clusters[cluster_index].light_indices[point_light_count + spot_light_count] = base + i;
+                    spot_light_count++;
+                } else {
+                    overflowed = true;
+                }
+            }
+        }
+        barrier();
+    }
+
+    if(active) {
+        CLUSTERS.clusters[cluster_index].point_light_count = point_light_count;
+        CLUSTERS.clusters[cluster_index].spot_light_count = spot_light_count;
+        if(overflowed) {
+            atomicAdd(CLUSTERS.overflow_count, 1);
+        }
+    }
+}
@@ -16,6 +16,7 @@ struct PointLight {
     f32vec3 position;
     f32vec3 color;
     f32 intensity;
+    f32 range;
 };
 
 struct SpotLight {
@@ -25,78 +26,92 @@ struct SpotLight {
     f32 intensity;
     f32 cut_off;
     f32 outer_cut_off;     
+    f32 range;
 };
 
+DAXA_ENABLE_BUFFER_PTR(DirectionalLight)
+DAXA_ENABLE_BUFFER_PTR(PointLight)
+DAXA_ENABLE_BUFFER_PTR(SpotLight)
+
+// inverse square falloff never reaches zero, lights are cut off once they drop below this
+#define LIGHT_ATTENUATION_CUTOFF 0.05f
+
 #if !defined(__cplusplus)
+f32 calculate_range_window(f32 distance, f32 range) {
+    f32 ratio = distance / range;
+    f32 window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window;
+}
+
 f32vec3 calculate_directional_light(DirectionalLight light, f32vec3 frag_color, f32vec3 normal, f32vec3 frag_position, f32vec3 camera_position) {
     f32vec3 light_dir = normalize(-light.direction);
     
-#if defined(SETTINGS_SHADING_MODEL_LAMBERTIAN)
-    f32vec3 diffuse = frag_color * light.color * max(dot(normal, light_dir), 0.0) * light.intensity;
-    return diffuse;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_PHONG)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 specular = max(dot(view_dir, reflect(-light_dir, normal)), 0.0);
-    return frag_color * light.color * (diffuse + specular) * light.intensity;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_BLINN_PHONG)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-    f32vec3 halfway_dir = normalize(light_dir + view_dir);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 specular = max(dot(view_dir, halfway_dir), 0.0);
-    return frag_color * light.color * (diffuse + specular) * light.intensity;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_GAUSSIAN)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-    f32vec3 halfway_dir = normalize(light_dir + view_dir);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 normal_half = acos(dot(halfway_dir, normal));
-    f32 exponent = normal_half / 1.0;
-    exponent = -(exponent * exponent);
-    return frag_color * light.color * (diffuse + exp(exponent)) * light.intensity;
-#endif
+    if(SHADING_MODEL == SHADING_MODEL_LAMBERTIAN) {
+        f32vec3 diffuse = frag_color * light.color * max(dot(normal, light_dir), 0.0) * light.intensity;
+        return diffuse;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_PHONG) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 specular = max(dot(view_dir, reflect(-light_dir, normal)), 0.0);
+        return frag_color * light.color * (diffuse + specular) * light.intensity;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_BLINN_PHONG) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+        f32vec3 halfway_dir = normalize(light_dir + view_dir);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 specular = max(dot(view_dir, halfway_dir), 0.0);
+        return frag_color * light.color * (diffuse + specular) * light.intensity;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_GAUSSIAN) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+        f32vec3 halfway_dir = normalize(light_dir + view_dir);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 normal_half = acos(dot(halfway_dir, normal));
+        f32 exponent = normal_half / 1.0;
+        exponent = -(exponent * exponent);
+        return frag_color * light.color * (diffuse + exp(exponent)) * light.intensity;
+    }
     return f32vec3(0.0);
 }
 
 f32vec3 calculate_point_light(PointLight light, f32vec3 frag_color, f32vec3 normal, f32vec3 frag_position, f32vec3 camera_position) {
     f32vec3 light_dir = normalize(light.position - frag_position);
     f32 distance = length(light.position.xyz - frag_position);
-    f32 attenuation = 1.0f / (distance * distance);
-
-#if defined(SETTINGS_SHADING_MODEL_LAMBERTIAN)
-    f32vec3 diffuse = frag_color * light.color * max(dot(normal, light_dir), 0.0) * attenuation * light.intensity;
-    return diffuse;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_PHONG)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 specular = max(dot(view_dir, reflect(-light_dir, normal)), 0.0);
-    return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_BLINN_PHONG)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-    f32vec3 halfway_dir = normalize(light_dir + view_dir);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 specular = max(dot(view_dir, halfway_dir), 0.0);
-    return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_GAUSSIAN)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-    f32vec3 halfway_dir = normalize(light_dir + view_dir);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 normal_half = acos(dot(halfway_dir, normal));
-    f32 exponent = normal_half / 1.0;
-    exponent = -(exponent * exponent);
-    return frag_color * light.color * (diffuse + exp(exponent)) * attenuation * light.intensity;
-#endif
+    f32 attenuation = calculate_range_window(distance, light.range) / (distance * distance);
+
+    if(SHADING_MODEL == SHADING_MODEL_LAMBERTIAN) {
+        f32vec3 diffuse = frag_color * light.color * max(dot(normal, light_dir), 0.0) * attenuation * light.intensity;
+        return diffuse;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_PHONG) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 specular = max(dot(view_dir, reflect(-light_dir, normal)), 0.0);
+        return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_BLINN_PHONG) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+        f32vec3 halfway_dir = normalize(light_dir + view_dir);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 specular = max(dot(view_dir, halfway_dir), 0.0);
+        return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_GAUSSIAN) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+        f32vec3 halfway_dir = normalize(light_dir + view_dir);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 normal_half = acos(dot(halfway_dir, normal));
+        f32 exponent = normal_half / 1.0;
+        exponent = -(exponent * exponent);
+        return frag_color * light.color * (diffuse + exp(exponent)) * attenuation * light.intensity;
+    }
     return f32vec3(0.0);
 }
 
@@ -108,38 +123,37 @@ f32vec3 calculate_spot_light(SpotLight light, f32vec3 frag_color, f32vec3 normal
     f32 intensity = clamp((theta - light.outer_cut_off) / epsilon, 0.0, 1.0);
 
     f32 distance = length(light.position - frag_position);
-    f32 attenuation = 1.0 / (distance * distance); 
-
-#if defined(SETTINGS_SHADING_MODEL_LAMBERTIAN)
-    f32vec3 diffuse = frag_color * light.color * max(dot(normal, light_dir), 0.0) * attenuation * light.intensity * intensity;
-    return diffuse;
-
-#endif
-#if defined(SETTINGS_SHADING_MODEL_PHONG)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 specular = max(dot(view_dir, reflect(-light_dir, normal)), 0.0);
-    return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity * intensity;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_BLINN_PHONG)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-    f32vec3 halfway_dir = normalize(light_dir + view_dir);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 specular = max(dot(view_dir, halfway_dir), 0.0);
-    return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity * intensity;
-#endif
-#if defined(SETTINGS_SHADING_MODEL_GAUSSIAN)
-    f32vec3 view_dir = normalize(camera_position - frag_position);
-    f32vec3 halfway_dir = normalize(light_dir + view_dir);
-
-    f32 diffuse = max(dot(normal, light_dir), 0.0);
-    f32 normal_half = acos(dot(halfway_dir, normal));
-    f32 exponent = normal_half / 1.0;
-    exponent = -(exponent * exponent);
-    return frag_color * light.color * (diffuse + exp(exponent)) * attenuation * light.intensity * intensity;
-#endif
+    f32 attenuation = calculate_range_window(distance, light.range) / (distance * distance); 
+
+    if(SHADING_MODEL == SHADING_MODEL_LAMBERTIAN) {
+        f32vec3 diffuse = frag_color * light.color * max(dot(normal, light_dir), 0.0) * attenuation * light.intensity * intensity;
+        return diffuse;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_PHONG) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 specular = max(dot(view_dir, reflect(-light_dir, normal)), 0.0);
+        return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity * intensity;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_BLINN_PHONG) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+        f32vec3 halfway_dir = normalize(light_dir + view_dir);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 specular = max(dot(view_dir, halfway_dir), 0.0);
+        return frag_color * light.color * (diffuse + specular) * attenuation * light.intensity * intensity;
+    }
+    if(SHADING_MODEL == SHADING_MODEL_GAUSSIAN) {
+        f32vec3 view_dir = normalize(camera_position - frag_position);
+        f32vec3 halfway_dir = normalize(light_dir + view_dir);
+
+        f32 diffuse = max(dot(normal, light_dir), 0.0);
+        f32 normal_half = acos(dot(halfway_dir, normal));
+        f32 exponent = normal_half / 1.0;
+        exponent = -(exponent * exponent);
+        return frag_color * light.color * (diffuse + exp(exponent)) * attenuation * light.intensity * intensity;
+    }
     return f32vec3(0.0);
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include <shared.inl>
+#include <common/core.glsl>
+
+DAXA_USE_PUSH_CONSTANT(ShadowDrawPush)
+
+#define POSITION deref(daxa_push_constant.position_buffer[gl_VertexIndex]).value
+#define OBJECT deref(daxa_push_constant.object_buffer)
+
+#if defined(DRAW_VERT)
+
+void main() {
+    f32vec3 position = (OBJECT.model_matrix * f32vec4(POSITION.xyz, 1)).xyz;
+    gl_Position = daxa_push_constant.view_projection * f32vec4(position.xyz, 1);
+}
+
+#elif defined(DRAW_FRAG)
+
+void main() {}
+
+#endif
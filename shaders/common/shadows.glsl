@@ -0,0 +1,114 @@
+#pragma once
+
+#include <shared.inl>
+#include <common/core.glsl>
+
+#define SHADOW deref(shadow_info)
+
+// 1 is fully lit, the cascade is picked by view depth and filtered with a 3x3 pcf kernel
+f32 calculate_shadow(daxa_RWBufferPtr(ShadowInfo) shadow_info, f32vec3 position, f32vec3 normal, f32 view_depth) {
+    if(SHADOW.enabled == 0) {
+        return 1.0;
+    }
+
+    u32 cascade = SHADOW_CASCADE_COUNT;
+    for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        if(view_depth < SHADOW.cascade_splits[i]) {
+            cascade = i;
+            break;
+        }
+    }
+
+    if(cascade == SHADOW_CASCADE_COUNT) {
+        return 1.0;
+    }
+
+    // pushing the position along the normal by a texel hides most acne without detaching the shadow
+    f32vec3 offset_position = position + normal * SHADOW.normal_bias * SHADOW.cascade_texel_sizes[cascade];
+    f32vec4 clip = SHADOW.cascade_view_projections[cascade] * f32vec4(offset_position, 1.0);
+    f32vec3 ndc = clip.xyz / clip.w;
+    f32vec2 uv = ndc.xy * 0.5 + 0.5;
+    f32 depth = ndc.z - SHADOW.depth_bias;
+
+    f32 texel = 1.0 / f32(SHADOW_MAP_SIZE);
+    f32 lit = 0.0;
+    for(i32 x = -1; x <= 1; x++) {
+        for(i32 y = -1; y <= 1; y++) {
+            f32 occluder = sample_texture_array(SHADOW.shadow_map, f32vec3(uv + f32vec2(x, y) * texel, f32(cascade))).r;
+            lit += depth <= occluder ? 1.0 : 0.0;
+        }
+    }
+
+    return lit / 9.0;
+}
+
+#define SHADOW_ATLAS deref(shadow_atlas_info)
+
+f32 calculate_atlas_shadow(daxa_RWBufferPtr(ShadowAtlasInfo) shadow_atlas_info, u32 view_index, f32vec3 position, f32vec3 normal, f32 light_distance) {
+    f32vec4 rect = SHADOW_ATLAS.views[view_index].atlas_rect;
+    if(rect.z == 0.0) {
+        return 1.0;
+    }
+
+    f32vec3 offset_position = position + normal * SHADOW_ATLAS.normal_bias * SHADOW_ATLAS.views[view_index].texel_scale * light_distance;
+    f32vec4 clip = SHADOW_ATLAS.views[view_index].view_projection * f32vec4(offset_position, 1.0);
+    if(clip.w <= 0.0) {
+        return 1.0;
+    }
+
+    f32vec3 ndc = clip.xyz / clip.w;
+    f32vec2 uv = rect.xy + (ndc.xy * 0.5 + 0.5) * rect.z;
+    f32 depth = ndc.z - SHADOW_ATLAS.depth_bias;
+
+    // the kernel must not reach into the neighbouring tiles
+    f32 texel = 1.0 / f32(SHADOW_ATLAS_SIZE);
+    f32vec2 uv_min = rect.xy + texel * 0.5;
+    f32vec2 uv_max = rect.xy + rect.z - texel * 0.5;
+    f32 lit = 0.0;
+    for(i32 x = -1; x <= 1; x++) {
+        for(i32 y = -1; y <= 1; y++) {
+            f32 occluder = sample_texture(SHADOW_ATLAS.atlas, clamp(uv + f32vec2(x, y) * texel, uv_min, uv_max)).r;
+            lit += depth <= occluder ? 1.0 : 0.0;
+        }
+    }
+
+    return lit / 9.0;
+}
+
+f32 calculate_point_shadow(daxa_RWBufferPtr(ShadowAtlasInfo) shadow_atlas_info, u32 light_index, f32vec3 light_position, f32vec3 position, f32vec3 normal) {
+    if(SHADOW_ATLAS.enabled == 0) {
+        return 1.0;
+    }
+
+    u32 first_view = deref(SHADOW_ATLAS.point_light_views[light_index]).value;
+    if(first_view == SHADOW_ATLAS_NO_VIEW) {
+        return 1.0;
+    }
+
+    // faces are ordered +x, -x, +y, -y, +z, -z like the views the atlas renders
+    f32vec3 to_fragment = position - light_position;
+    f32vec3 distance = abs(to_fragment);
+    u32 face;
+    if(distance.x >= distance.y && distance.x >= distance.z) {
+        face = to_fragment.x > 0.0 ? 0 : 1;
+    } else if(distance.y >= distance.z) {
+        face = to_fragment.y > 0.0 ? 2 : 3;
+    } else {
+        face = to_fragment.z > 0.0 ? 4 : 5;
+    }
+
+    return calculate_atlas_shadow(shadow_atlas_info, first_view + face, position, normal, length(to_fragment));
+}
+
+f32 calculate_spot_shadow(daxa_RWBufferPtr(ShadowAtlasInfo) shadow_atlas_info, u32 light_index, f32vec3 light_position, f32vec3 position, f32vec3 normal) {
+    if(SHADOW_ATLAS.enabled == 0) {
+        return 1.0;
+    }
+
+    u32 view = deref(SHADOW_ATLAS.spot_light_views[light_index]).value;
+    if(view == SHADOW_ATLAS_NO_VIEW) {
+        return 1.0;
+    }
+
+    return calculate_atlas_shadow(shadow_atlas_info, view, position, normal, length(position - light_position));
+}
@@ -8,6 +8,47 @@
 #define APPNAME "Daxa Renderer"
 #define APPNAME_PREFIX(x) ("[" APPNAME "] " x)
 
+// modes of the permutation settings, shaders get them as specialization constants so every combination shares one
+// spir-v module and only the pipeline is built per combination
+#define SPECIALIZATION_TEXTURING_MODE 0
+#define SPECIALIZATION_SHADING_MODEL 1
+#define SPECIALIZATION_NORMAL_MAPPING_MODE 2
+#define SPECIALIZATION_REORTHOGONALIZE_TBN 3
+#define SPECIALIZATION_MATERIAL_FEATURES 4
+
+#define TEXTURING_MODE_NONE 0
+#define TEXTURING_MODE_VERTEX_COLOR 1
+#define TEXTURING_MODE_ALBEDO 2
+
+#define SHADING_MODEL_NONE 0
+#define SHADING_MODEL_LAMBERTIAN 1
+#define SHADING_MODEL_PHONG 2
+#define SHADING_MODEL_BLINN_PHONG 3
+#define SHADING_MODEL_GAUSSIAN 4
+
+#define NORMAL_MAPPING_MODE_NONE 0
+#define NORMAL_MAPPING_MODE_USING_TANGENTS 1
+#define NORMAL_MAPPING_MODE_CALCULATING_TBN_VECTORS 2
+
+// textures a material actually has and its alpha mode, materials are bucketed by this mask at load time and every
+// bucket gets a pipeline that skips the fetches of the features it lacks
+#define MATERIAL_FEATURE_ALBEDO (1 << 0)
+#define MATERIAL_FEATURE_METALLIC_ROUGHNESS (1 << 1)
+#define MATERIAL_FEATURE_NORMAL_MAP (1 << 2)
+// highest bit, so the draw sort puts the masked buckets behind every opaque one
+#define MATERIAL_FEATURE_ALPHA_MASK (1 << 3)
+#define MATERIAL_BUCKET_COUNT 16
+// pipelines drawing materials of every bucket at once read the mask from the material instead
+#define MATERIAL_FEATURES_DYNAMIC 0xFFFFFFFF
+
+#if !defined(__cplusplus)
+layout(constant_id = SPECIALIZATION_TEXTURING_MODE) const u32 TEXTURING_MODE = TEXTURING_MODE_NONE;
+layout(constant_id = SPECIALIZATION_SHADING_MODEL) const u32 SHADING_MODEL = SHADING_MODEL_NONE;
+layout(constant_id = SPECIALIZATION_NORMAL_MAPPING_MODE) const u32 NORMAL_MAPPING_MODE = NORMAL_MAPPING_MODE_NONE;
+layout(constant_id = SPECIALIZATION_REORTHOGONALIZE_TBN) const bool REORTHOGONALIZE_TBN = false;
+layout(constant_id = SPECIALIZATION_MATERIAL_FEATURES) const u32 MATERIAL_FEATURES = MATERIAL_FEATURES_DYNAMIC;
+#endif
+
 #include "common/lighting.glsl"
 
 struct DrawVertex {
@@ -19,19 +60,50 @@ struct DrawVertex {
 
 DAXA_ENABLE_BUFFER_PTR(DrawVertex)
 
-#define MAX_LIGHTS 16
+// tightly packed copy of DrawVertex::position for passes that only need depth
+struct DrawPosition {
+    f32vec3 value;
+};
+
+DAXA_ENABLE_BUFFER_PTR(DrawPosition)
 
 struct LightsInfo {
-    i32 num_directional_lights;
-    DirectionalLight directional_lights[MAX_LIGHTS];
-    i32 num_point_lights;
-    PointLight point_lights[MAX_LIGHTS];
-    i32 num_spot_lights;
-    SpotLight spot_lights[MAX_LIGHTS];
+    u32 num_directional_lights;
+    u32 num_point_lights;
+    u32 num_spot_lights;
+    daxa_RWBufferPtr(DirectionalLight) directional_lights;
+    daxa_RWBufferPtr(PointLight) point_lights;
+    daxa_RWBufferPtr(SpotLight) spot_lights;
 };
 
 DAXA_ENABLE_BUFFER_PTR(LightsInfo)
 
+// froxel grid, screen tiles scale with the resolution and depth slices are exponential between near and far plane
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define MAX_LIGHTS_PER_CLUSTER 128
+// point and spot lights have budgets of their own so one kind can not crowd out the other
+#define MAX_POINT_LIGHTS_PER_CLUSTER 96
+#define MAX_SPOT_LIGHTS_PER_CLUSTER (MAX_LIGHTS_PER_CLUSTER - MAX_POINT_LIGHTS_PER_CLUSTER)
+#define LIGHT_CLUSTERING_GROUP_SIZE 64
+
+struct LightCluster {
+    u32 point_light_count;
+    u32 spot_light_count;
+    u32 light_indices[MAX_LIGHTS_PER_CLUSTER];
+};
+
+struct LightClusters {
+    f32vec2 screen_size;
+    // clusters that had to drop a light, cleared before every clustering dispatch
+    u32 overflow_count;
+    LightCluster clusters[CLUSTER_COUNT];
+};
+
+DAXA_ENABLE_BUFFER_PTR(LightClusters)
+
 struct TextureId {
     ImageViewId image_view_id;
     SamplerId sampler_id;
@@ -52,6 +124,10 @@ struct MaterialInfo {
     TextureId emissive_map;
     u32 has_emissive_map;
     f32vec3 emissive_factor;
+    // MATERIAL_FEATURE_* bits
+    u32 features;
+    // fragments of alpha masked materials with less albedo alpha are discarded
+    f32 alpha_cutoff;
 };
 
 DAXA_ENABLE_BUFFER_PTR(MaterialInfo)
@@ -63,6 +139,62 @@ struct ObjectInfo {
 
 DAXA_ENABLE_BUFFER_PTR(ObjectInfo)
 
+// cascaded shadow maps of the first directional light, all cascades are layers of one depth array
+#define SHADOW_CASCADE_COUNT 4
+#define SHADOW_MAP_SIZE 2048
+
+struct ShadowInfo {
+    f32mat4x4 cascade_view_projections[SHADOW_CASCADE_COUNT];
+    // view depth at which each cascade ends
+    f32vec4 cascade_splits;
+    // world space size of one shadow map texel per cascade, scales the normal offset
+    f32vec4 cascade_texel_sizes;
+    TextureId shadow_map;
+    f32 depth_bias;
+    f32 normal_bias;
+    u32 enabled;
+};
+
+DAXA_ENABLE_BUFFER_PTR(ShadowInfo)
+
+// point and spot light shadows share one depth atlas, point lights take six consecutive views, one per cube face
+#define SHADOW_ATLAS_SIZE 4096
+#define SHADOW_ATLAS_MAX_VIEWS 64
+#define SHADOW_ATLAS_NO_VIEW 0xFFFFFFFFu
+
+struct ShadowView {
+    f32mat4x4 view_projection;
+    // offset in xy and size in z of the view's tile in atlas uvs, a size of 0 means the tile was not rendered yet
+    f32vec4 atlas_rect;
+    // world space size of a texel one unit away from the light
+    f32 texel_scale;
+};
+
+struct ShadowViewIndex {
+    u32 value;
+};
+
+DAXA_ENABLE_BUFFER_PTR(ShadowViewIndex)
+
+struct ShadowAtlasInfo {
+    ShadowView views[SHADOW_ATLAS_MAX_VIEWS];
+    // first view of every uploaded light or SHADOW_ATLAS_NO_VIEW, indexed like the light buffers
+    daxa_RWBufferPtr(ShadowViewIndex) point_light_views;
+    daxa_RWBufferPtr(ShadowViewIndex) spot_light_views;
+    TextureId atlas;
+    f32 depth_bias;
+    f32 normal_bias;
+    u32 enabled;
+};
+
+DAXA_ENABLE_BUFFER_PTR(ShadowAtlasInfo)
+
+struct ShadowDrawPush {
+    f32mat4x4 view_projection;
+    daxa_RWBufferPtr(ObjectInfo) object_buffer;
+    daxa_RWBufferPtr(DrawPosition) position_buffer;
+};
+
 struct CameraInfo {
     f32mat4x4 projection_matrix;
     f32mat4x4 inverse_projection_matrix;
@@ -71,16 +203,92 @@ struct CameraInfo {
     f32vec3 position;
     f32 near_plane;
     f32 far_plane;
+    daxa_RWBufferPtr(ShadowInfo) shadow_info;
+    daxa_RWBufferPtr(ShadowAtlasInfo) shadow_atlas_info;
 };
 
 DAXA_ENABLE_BUFFER_PTR(CameraInfo)
 
+#define GPU_CULLING_GROUP_SIZE 64
+
+// matches VkDrawIndexedIndirectCommand
+struct DrawIndexedIndirectCommand {
+    u32 index_count;
+    u32 instance_count;
+    u32 first_index;
+    i32 vertex_offset;
+    u32 first_instance;
+};
+
+DAXA_ENABLE_BUFFER_PTR(DrawIndexedIndirectCommand)
+
+struct DrawCount {
+    u32 value;
+};
+
+DAXA_ENABLE_BUFFER_PTR(DrawCount)
+
+// one primitive of one entity, the culling pass turns visible ones into indirect commands of their batch
+struct DrawInstance {
+    daxa_RWBufferPtr(ObjectInfo) object_buffer;
+    daxa_RWBufferPtr(DrawVertex) vertex_buffer;
+    daxa_RWBufferPtr(DrawPosition) position_buffer;
+    daxa_RWBufferPtr(MaterialInfo) material_info_buffer;
+    f32vec3 aabb_center;
+    f32vec3 aabb_extent;
+    u32 index_count;
+    u32 first_index;
+    i32 vertex_offset;
+    u32 batch_index;
+    u32 first_command;
+};
+
+DAXA_ENABLE_BUFFER_PTR(DrawInstance)
+
+// two phase occlusion culling, the early phase draws what was visible last frame, the late phase tests
+// everything else against the depth pyramid built from the early phase
+#define GPU_CULLING_PHASE_ALL 0
+#define GPU_CULLING_PHASE_EARLY 1
+#define GPU_CULLING_PHASE_LATE 2
+
+struct GPUCullingPush {
+    daxa_RWBufferPtr(CameraInfo) camera_buffer;
+    daxa_RWBufferPtr(DrawInstance) instance_buffer;
+    daxa_RWBufferPtr(DrawIndexedIndirectCommand) command_buffer;
+    daxa_RWBufferPtr(DrawCount) count_buffer;
+    daxa_RWBufferPtr(DrawCount) visibility_buffer;
+    TextureId depth_pyramid;
+    u32vec2 depth_pyramid_size;
+    u32 depth_pyramid_mip_count;
+    u32 instance_count;
+    u32 frustum_culling;
+    u32 phase;
+};
+
+#define DEPTH_PYRAMID_GROUP_SIZE 16
+#define DEPTH_PYRAMID_TILE_SIZE (DEPTH_PYRAMID_GROUP_SIZE * 2)
+#define DEPTH_PYRAMID_SHARED_MIPS 6
+#define DEPTH_PYRAMID_MAX_MIPS 12
+
+struct DepthPyramidPush {
+    TextureId depth;
+    ImageViewId mips[DEPTH_PYRAMID_MAX_MIPS];
+    u32vec2 depth_size;
+    u32vec2 pyramid_size;
+    u32 mip_count;
+    u32 group_count;
+    daxa_RWBufferPtr(DrawCount) counter_buffer;
+};
+
 struct DrawPush {
     daxa_RWBufferPtr(CameraInfo) camera_buffer;
     daxa_RWBufferPtr(ObjectInfo) object_buffer;
     daxa_RWBufferPtr(LightsInfo) lights_buffer;
+    daxa_RWBufferPtr(LightClusters) clusters_buffer;
     daxa_RWBufferPtr(DrawVertex) face_buffer;
+    daxa_RWBufferPtr(DrawPosition) position_buffer;
     daxa_RWBufferPtr(MaterialInfo) material_info_buffer;
+    daxa_RWBufferPtr(DrawInstance) instance_buffer;
 };
 
 struct SkyboxDrawPush {
@@ -92,10 +300,92 @@ struct SkyboxDrawPush {
 struct CompositionPush {
     TextureId albedo;
     TextureId normal;
-    TextureId position;
+    TextureId depth;
     //TextureId ssao;
     daxa_RWBufferPtr(CameraInfo) camera_buffer;
     daxa_RWBufferPtr(LightsInfo) lights_buffer;
+    daxa_RWBufferPtr(LightClusters) clusters_buffer;
+};
+
+#define TILED_COMPOSITION_TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 256
+
+struct TiledCompositionPush {
+    TextureId albedo;
+    TextureId normal;
+    TextureId depth;
+    ImageViewId output_image;
+    u32vec2 screen_size;
+    daxa_RWBufferPtr(CameraInfo) camera_buffer;
+    daxa_RWBufferPtr(LightsInfo) lights_buffer;
+};
+
+#define LIGHT_VOLUME_SEGMENTS 16
+#define LIGHT_VOLUME_RINGS 8
+#define LIGHT_VOLUME_SPHERE_VERTEX_COUNT (LIGHT_VOLUME_SEGMENTS * LIGHT_VOLUME_RINGS * 6)
+#define LIGHT_VOLUME_CONE_VERTEX_COUNT (LIGHT_VOLUME_SEGMENTS * 6)
+#define LIGHT_VOLUME_POINT 0
+#define LIGHT_VOLUME_SPOT 1
+
+struct LightVolumePush {
+    TextureId albedo;
+    TextureId normal;
+    TextureId depth;
+    daxa_RWBufferPtr(CameraInfo) camera_buffer;
+    daxa_RWBufferPtr(LightsInfo) lights_buffer;
+    u32 light_type;
+};
+
+// 32 bit visibility id, the draw index within its batch sits in the high bits and the triangle index of that draw in the low bits
+#define VISIBILITY_TRIANGLE_BITS 20
+#define VISIBILITY_TRIANGLE_MASK ((1u << VISIBILITY_TRIANGLE_BITS) - 1u)
+#define VISIBILITY_MAX_DRAWS ((1u << (32 - VISIBILITY_TRIANGLE_BITS)) - 1u)
+#define VISIBILITY_EMPTY 0xFFFFFFFFu
+#define VISIBILITY_RESOLVE_GROUP_SIZE 8
+
+struct MeshIndex {
+    u32 value;
+};
+
+DAXA_ENABLE_BUFFER_PTR(MeshIndex)
+
+struct VisibilityDrawInfo {
+    daxa_RWBufferPtr(ObjectInfo) object_buffer;
+    daxa_RWBufferPtr(DrawVertex) vertex_buffer;
+    daxa_RWBufferPtr(DrawPosition) position_buffer;
+    daxa_RWBufferPtr(MeshIndex) index_buffer;
+    daxa_RWBufferPtr(MaterialInfo) material_info_buffer;
+    u32 first_index;
+    u32 first_vertex;
+    u32 indexed;
+};
+
+DAXA_ENABLE_BUFFER_PTR(VisibilityDrawInfo)
+
+struct VisibilityPush {
+    daxa_RWBufferPtr(CameraInfo) camera_buffer;
+    daxa_RWBufferPtr(VisibilityDrawInfo) draw_info_buffer;
+    u32 draw_index;
+    // first draw of the batch, ids are relative to it
+    u32 draw_base;
+};
+
+struct VisibilityResolvePush {
+    TextureId visibility;
+    ImageViewId output_image;
+    u32vec2 screen_size;
+    daxa_RWBufferPtr(CameraInfo) camera_buffer;
+    daxa_RWBufferPtr(VisibilityDrawInfo) draw_info_buffer;
+    daxa_RWBufferPtr(LightsInfo) lights_buffer;
+    daxa_RWBufferPtr(LightClusters) clusters_buffer;
+    u32 draw_base;
+};
+
+struct LightClusteringPush {
+    f32vec2 screen_size;
+    daxa_RWBufferPtr(CameraInfo) camera_buffer;
+    daxa_RWBufferPtr(LightsInfo) lights_buffer;
+    daxa_RWBufferPtr(LightClusters) clusters_buffer;
 };
 
 #define SSAO_KERNEL_SIZE 64
@@ -112,7 +402,7 @@ DAXA_ENABLE_BUFFER_PTR(SSAOKernel)
 
 struct SSAOGenerationPush {
     TextureId normal;
-    TextureId position;
+    TextureId depth;
     TextureId ssao_noise;
     daxa_RWBufferPtr(CameraInfo) camera_buffer;
     daxa_RWBufferPtr(SSAOKernel) ssao_kernel_buffer;
@@ -0,0 +1,128 @@
+#include <shared.inl>
+#include <common/core.glsl>
+#include <common/clustering.glsl>
+#include <common/shadows.glsl>
+
+DAXA_USE_PUSH_CONSTANT(VisibilityResolvePush)
+
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+#define LIGHTS deref(daxa_push_constant.lights_buffer)
+#define CLUSTERS deref(daxa_push_constant.clusters_buffer)
+
+layout(local_size_x = VISIBILITY_RESOLVE_GROUP_SIZE, local_size_y = VISIBILITY_RESOLVE_GROUP_SIZE) in;
+
+f32vec3 pixel_ray_direction(f32vec2 pixel) {
+    f32vec2 ndc = pixel / f32vec2(daxa_push_constant.screen_size) * 2.0 - 1.0;
+    f32vec4 view = CAMERA.inverse_projection_matrix * f32vec4(ndc, 1.0, 1.0);
+    return normalize((CAMERA.inverse_view_matrix * f32vec4(view.xyz / view.w, 0.0)).xyz);
+}
+
+// barycentrics of the point where the ray hits the triangle's plane, also valid outside of the triangle
+f32vec3 ray_barycentrics(f32vec3 origin, f32vec3 direction, f32vec3 p0, f32vec3 p1, f32vec3 p2) {
+    f32vec3 edge_1 = p1 - p0;
+    f32vec3 edge_2 = p2 - p0;
+    f32vec3 p = cross(direction, edge_2);
+    f32 inverse_determinant = 1.0 / dot(edge_1, p);
+    f32vec3 t = origin - p0;
+    f32 u = dot(t, p) * inverse_determinant;
+    f32 v = dot(direction, cross(t, edge_1)) * inverse_determinant;
+    return f32vec3(1.0 - u - v, u, v);
+}
+
+f32vec2 interpolate(f32vec3 barycentrics, f32vec2 a, f32vec2 b, f32vec2 c) {
+    return a * barycentrics.x + b * barycentrics.y + c * barycentrics.z;
+}
+
+f32vec3 interpolate(f32vec3 barycentrics, f32vec3 a, f32vec3 b, f32vec3 c) {
+    return a * barycentrics.x + b * barycentrics.y + c * barycentrics.z;
+}
+
+void main() {
+    i32vec2 coord = i32vec2(gl_GlobalInvocationID.xy);
+    if(any(greaterThanEqual(gl_GlobalInvocationID.xy, daxa_push_constant.screen_size))) {
+        return;
+    }
+
+    u32 visibility = fetch_uint_texture(daxa_push_constant.visibility, coord).r;
+    // later batches leave the pixels they did not cover to the batches before them
+    if(visibility == VISIBILITY_EMPTY) {
+        if(daxa_push_constant.draw_base == 0) {
+            store_image(daxa_push_constant.output_image, coord, f32vec4(0.2, 0.4, 1.0, 1.0));
+        }
+        return;
+    }
+
+    VisibilityDrawInfo draw = deref(daxa_push_constant.draw_info_buffer[daxa_push_constant.draw_base + (visibility >> VISIBILITY_TRIANGLE_BITS)]);
+    u32 triangle = visibility & VISIBILITY_TRIANGLE_MASK;
+    ObjectInfo object = deref(draw.object_buffer);
+    MaterialInfo material = deref(draw.material_info_buffer);
+
+    DrawVertex vertices[3];
+    f32vec3 positions[3];
+    for(u32 i = 0; i < 3; i++) {
+        u32 vertex_index = draw.indexed != 0 ? draw.first_vertex + deref(draw.index_buffer[draw.first_index + triangle * 3 + i]).value : draw.first_vertex + triangle * 3 + i;
+        vertices[i] = deref(draw.vertex_buffer[vertex_index]);
+        positions[i] = (object.model_matrix * f32vec4(vertices[i].position, 1.0)).xyz;
+    }
+
+    // neighbouring pixels are intersected with the same plane to get the uv gradients rasterization would have given us
+    f32vec2 pixel = f32vec2(coord) + 0.5;
+    f32vec3 camera_position = CAMERA.position;
+    f32vec3 barycentrics = ray_barycentrics(camera_position, pixel_ray_direction(pixel), positions[0], positions[1], positions[2]);
+    f32vec3 barycentrics_x = ray_barycentrics(camera_position, pixel_ray_direction(pixel + f32vec2(1.0, 0.0)), positions[0], positions[1], positions[2]);
+    f32vec3 barycentrics_y = ray_barycentrics(camera_position, pixel_ray_direction(pixel + f32vec2(0.0, 1.0)), positions[0], positions[1], positions[2]);
+
+    f32vec3 position = interpolate(barycentrics, positions[0], positions[1], positions[2]);
+    f32vec2 uv = interpolate(barycentrics, vertices[0].uv, vertices[1].uv, vertices[2].uv);
+    f32vec2 uv_ddx = interpolate(barycentrics_x, vertices[0].uv, vertices[1].uv, vertices[2].uv) - uv;
+    f32vec2 uv_ddy = interpolate(barycentrics_y, vertices[0].uv, vertices[1].uv, vertices[2].uv) - uv;
+
+    // the modes are specialization constants, the branches not taken are folded away when the pipeline is created
+    f32vec3 color = f32vec3(0.0, 0.0, 0.0);
+    if(TEXTURING_MODE == TEXTURING_MODE_NONE) {
+        color = f32vec3(1.0, 1.0, 1.0);
+    } else if(TEXTURING_MODE == TEXTURING_MODE_VERTEX_COLOR) {
+        color = f32vec3(0.5, 0.5, 0.5);
+    } else if(TEXTURING_MODE == TEXTURING_MODE_ALBEDO) {
+        color = sample_texture_grad(material.albedo, uv, uv_ddx, uv_ddy).rgb;
+    }
+
+    if(SHADING_MODEL != SHADING_MODEL_NONE) {
+        f32mat3x3 normal_matrix = f32mat3x3(object.normal_matrix);
+        f32vec3 normal = normalize(normal_matrix * interpolate(barycentrics, vertices[0].normal, vertices[1].normal, vertices[2].normal));
+        if(NORMAL_MAPPING_MODE == NORMAL_MAPPING_MODE_USING_TANGENTS) {
+            f32vec3 tangent = normalize(normal_matrix * interpolate(barycentrics, vertices[0].tangent.xyz, vertices[1].tangent.xyz, vertices[2].tangent.xyz));
+            if(REORTHOGONALIZE_TBN) {
+                tangent = normalize(tangent - dot(tangent, normal) * normal);
+            }
+            f32vec3 bittangent = normalize(cross(normal, tangent) * vertices[0].tangent.w);
+            f32mat3x3 tbn = f32mat3x3(tangent, bittangent, normal);
+            normal = normalize(tbn * normalize(sample_texture_grad(material.normal_map, uv, uv_ddx, uv_ddy).rgb * 2.0 - 1.0));
+        }
+
+        f32 view_depth = -(CAMERA.view_matrix * f32vec4(position, 1.0)).z;
+        // only the first directional light casts shadows
+        f32 shadow = calculate_shadow(CAMERA.shadow_info, position, normal, view_depth);
+        for(uint i = 0; i < LIGHTS.num_directional_lights; i++) {
+            f32 visibility = i == 0 ? shadow : 1.0;
+            color += visibility * calculate_directional_light(deref(LIGHTS.directional_lights[i]), color, normal, position, camera_position);
+        }
+        u32 cluster_index = get_cluster_index(pixel / f32vec2(daxa_push_constant.screen_size), view_depth, CAMERA.near_plane, CAMERA.far_plane);
+        u32 point_light_count = CLUSTERS.clusters[cluster_index].point_light_count;
+        u32 spot_light_count = CLUSTERS.clusters[cluster_index].spot_light_count;
+
+        for(uint i = 0; i < point_light_count; i++) {
+            u32 light_index = CLUSTERS.clusters[cluster_index].light_indices[i];
+            f32 visibility = calculate_point_shadow(CAMERA.shadow_atlas_info, light_index, deref(LIGHTS.point_lights[light_index]).position, position, normal);
+            color += visibility * calculate_point_light(deref(LIGHTS.point_lights[light_index]), color, normal, position, camera_position);
+        }
+
+        for(uint i = point_light_count; i < point_light_count + spot_light_count; i++) {
+            u32 light_index = CLUSTERS.clusters[cluster_index].light_indices[i];
+            f32 visibility = calculate_spot_shadow(CAMERA.shadow_atlas_info, light_index, deref(LIGHTS.spot_lights[light_index]).position, position, normal);
+            color += visibility * calculate_spot_light(deref(LIGHTS.spot_lights[light_index]), color, normal, position, camera_position);
+        }
+    }
+
+    store_image(daxa_push_constant.output_image, coord, f32vec4(color, 1.0));
+}
@@ -0,0 +1,25 @@
+#include <shared.inl>
+#include <common/core.glsl>
+
+DAXA_USE_PUSH_CONSTANT(VisibilityPush)
+
+#define CAMERA deref(daxa_push_constant.camera_buffer)
+#define DRAW deref(daxa_push_constant.draw_info_buffer[daxa_push_constant.draw_index])
+
+#if defined(DRAW_VERT)
+
+void main() {
+    VisibilityDrawInfo draw = DRAW;
+    f32vec3 position = deref(draw.position_buffer[gl_VertexIndex]).value;
+    gl_Position = CAMERA.projection_matrix * CAMERA.view_matrix * deref(draw.object_buffer).model_matrix * f32vec4(position, 1.0);
+}
+
+#elif defined(DRAW_FRAG)
+
+layout(location = 0) out u32 out_visibility;
+
+void main() {
+    out_visibility = ((daxa_push_constant.draw_index - daxa_push_constant.draw_base) << VISIBILITY_TRIANGLE_BITS) | (u32(gl_PrimitiveID) & VISIBILITY_TRIANGLE_MASK);
+}
+
+#endif
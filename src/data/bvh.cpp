@@ -0,0 +1,571 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace dare {
+    namespace {
+        auto surface_area(const glm::vec3& aabb_min, const glm::vec3& aabb_max) -> f32 {
+            glm::vec3 size = glm::max(aabb_max - aabb_min, glm::vec3(0.0f));
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        auto elapsed_ms(std::chrono::high_resolution_clock::time_point start) -> f32 {
+            return std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+    }
+
+    BVH::~BVH() {
+        if(this->pending_build.valid()) {
+            this->pending_build.wait();
+        }
+    }
+
+    void BVH::insert(entt::entity entity, const glm::vec3& aabb_min, const glm::vec3& aabb_max) {
+        if(this->contains(entity)) {
+            this->update(entity, aabb_min, aabb_max);
+            return;
+        }
+
+        u32 leaf_index = static_cast<u32>(this->leaves.size());
+        u32 leaf_node = this->allocate_node();
+        this->leaves.push_back({ entity, aabb_min, aabb_max, leaf_node });
+        this->leaf_lookup[entity] = leaf_index;
+        this->nodes[leaf_node].aabb_min = aabb_min;
+        this->nodes[leaf_node].aabb_max = aabb_max;
+        this->nodes[leaf_node].leaf = leaf_index;
+
+        this->structure_version++;
+
+        if(this->root == INVALID_INDEX) {
+            this->root = leaf_node;
+            return;
+        }
+
+        // walk down towards the sibling that grows the total surface area the least
+        u32 index = this->root;
+        while(!this->nodes[index].is_leaf()) {
+            const Node& node = this->nodes[index];
+            f32 area = surface_area(node.aabb_min, node.aabb_max);
+            f32 combined_area = surface_area(glm::min(node.aabb_min, aabb_min), glm::max(node.aabb_max, aabb_max));
+
+            // pairing with this node creates a parent of the combined size, going deeper enlarges this node instead
+            f32 cost = 2.0f * combined_area;
+            f32 inheritance_cost = 2.0f * (combined_area - area);
+
+            auto child_cost = [&](u32 child) -> f32 {
+                const Node& child_node = this->nodes[child];
+                f32 enlarged = surface_area(glm::min(child_node.aabb_min, aabb_min), glm::max(child_node.aabb_max, aabb_max));
+                return (child_node.is_leaf() ? enlarged : enlarged - surface_area(child_node.aabb_min, child_node.aabb_max)) + inheritance_cost;
+            };
+
+            f32 left_cost = child_cost(node.left);
+            f32 right_cost = child_cost(node.right);
+            if(cost < left_cost && cost < right_cost) {
+                break;
+            }
+
+            index = left_cost < right_cost ? node.left : node.right;
+        }
+
+        u32 sibling = index;
+        u32 old_parent = this->nodes[sibling].parent;
+        u32 new_parent = this->allocate_node();
+        this->nodes[new_parent].parent = old_parent;
+        this->nodes[new_parent].left = sibling;
+        this->nodes[new_parent].right = leaf_node;
+        this->nodes[new_parent].aabb_min = glm::min(this->nodes[sibling].aabb_min, aabb_min);
+        this->nodes[new_parent].aabb_max = glm::max(this->nodes[sibling].aabb_max, aabb_max);
+        this->interior_area += surface_area(this->nodes[new_parent].aabb_min, this->nodes[new_parent].aabb_max);
+        this->nodes[sibling].parent = new_parent;
+        this->nodes[leaf_node].parent = new_parent;
+
+        if(old_parent == INVALID_INDEX) {
+            this->root = new_parent;
+        } else {
+            if(this->nodes[old_parent].left == sibling) {
+                this->nodes[old_parent].left = new_parent;
+            } else {
+                this->nodes[old_parent].right = new_parent;
+            }
+            this->refit_ancestors(old_parent);
+        }
+    }
+
+    void BVH::remove(entt::entity entity) {
+        auto it = this->leaf_lookup.find(entity);
+        if(it == this->leaf_lookup.end()) {
+            return;
+        }
+
+        u32 leaf_index = it->second;
+        u32 node = this->leaves[leaf_index].node;
+        this->leaf_lookup.erase(it);
+
+        // keep the leaves packed, the last one takes the freed slot
+        u32 last_index = static_cast<u32>(this->leaves.size() - 1);
+        if(leaf_index != last_index) {
+            this->leaves[leaf_index] = this->leaves[last_index];
+            this->leaf_lookup[this->leaves[leaf_index].entity] = leaf_index;
+            this->nodes[this->leaves[leaf_index].node].leaf = leaf_index;
+        }
+        this->leaves.pop_back();
+
+        this->structure_version++;
+
+        if(node == this->root) {
+            this->root = INVALID_INDEX;
+            this->free_node(node);
+            return;
+        }
+
+        // the sibling takes the place of the parent
+        u32 parent = this->nodes[node].parent;
+        u32 grand_parent = this->nodes[parent].parent;
+        u32 sibling = this->nodes[parent].left == node ? this->nodes[parent].right : this->nodes[parent].left;
+
+        if(grand_parent == INVALID_INDEX) {
+            this->root = sibling;
+            this->nodes[sibling].parent = INVALID_INDEX;
+        } else {
+            if(this->nodes[grand_parent].left == parent) {
+                this->nodes[grand_parent].left = sibling;
+            } else {
+                this->nodes[grand_parent].right = sibling;
+            }
+            this->nodes[sibling].parent = grand_parent;
+            this->refit_ancestors(grand_parent);
+        }
+
+        this->interior_area -= surface_area(this->nodes[parent].aabb_min, this->nodes[parent].aabb_max);
+        this->free_node(parent);
+        this->free_node(node);
+    }
+
+    auto BVH::get_bounds(entt::entity entity, glm::vec3& aabb_min, glm::vec3& aabb_max) const -> bool {
+        auto it = this->leaf_lookup.find(entity);
+        if(it == this->leaf_lookup.end()) {
+            return false;
+        }
+
+        aabb_min = this->leaves[it->second].aabb_min;
+        aabb_max = this->leaves[it->second].aabb_max;
+        return true;
+    }
+
+    void BVH::update(entt::entity entity, const glm::vec3& aabb_min, const glm::vec3& aabb_max) {
+        auto it = this->leaf_lookup.find(entity);
+        if(it == this->leaf_lookup.end()) {
+            this->insert(entity, aabb_min, aabb_max);
+            return;
+        }
+
+        Leaf& leaf = this->leaves[it->second];
+        leaf.aabb_min = aabb_min;
+        leaf.aabb_max = aabb_max;
+        this->nodes[leaf.node].aabb_min = aabb_min;
+        this->nodes[leaf.node].aabb_max = aabb_max;
+
+        if(this->nodes[leaf.node].parent != INVALID_INDEX) {
+            this->refit_ancestors(this->nodes[leaf.node].parent);
+        }
+
+        this->refit_count++;
+    }
+
+    void BVH::clear() {
+        if(this->pending_build.valid()) {
+            this->pending_build.wait();
+            this->pending_build = {};
+        }
+
+        this->nodes.clear();
+        this->free_nodes.clear();
+        this->leaves.clear();
+        this->leaf_lookup.clear();
+        this->root = INVALID_INDEX;
+        this->structure_version++;
+        this->interior_area = 0.0;
+        this->stats = {};
+    }
+
+    void BVH::rebuild() {
+        std::vector<BuildPrimitive> primitives;
+        primitives.reserve(this->leaves.size());
+        for(u32 i = 0; i < this->leaves.size(); i++) {
+            const Leaf& leaf = this->leaves[i];
+            primitives.push_back({ leaf.aabb_min, leaf.aabb_max, (leaf.aabb_min + leaf.aabb_max) * 0.5f, i });
+        }
+
+        this->adopt(build(std::move(primitives)));
+    }
+
+    void BVH::maintain() {
+        if(this->pending_build.valid() && this->pending_build.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            BuildResult result = this->pending_build.get();
+            // leaves were added or removed while building, the next check starts over
+            if(this->pending_version == this->structure_version) {
+                this->adopt(std::move(result));
+            }
+        }
+
+        this->stats.cost = this->calculate_cost();
+
+        this->stats.node_count = static_cast<u32>(this->nodes.size() - this->free_nodes.size());
+        this->stats.leaf_count = static_cast<u32>(this->leaves.size());
+        this->stats.refits_last_frame = this->refit_count;
+        this->refit_count = 0;
+
+        if(this->pending_build.valid() || this->leaves.size() < 2 || this->stats.cost <= this->stats.build_cost * this->rebuild_threshold) {
+            return;
+        }
+
+        if(!this->background_rebuild) {
+            this->rebuild();
+            return;
+        }
+
+        // the worker only sees a snapshot, bounds that move in the meantime are refit after adopting
+        std::vector<BuildPrimitive> primitives;
+        primitives.reserve(this->leaves.size());
+        for(u32 i = 0; i < this->leaves.size(); i++) {
+            const Leaf& leaf = this->leaves[i];
+            primitives.push_back({ leaf.aabb_min, leaf.aabb_max, (leaf.aabb_min + leaf.aabb_max) * 0.5f, i });
+        }
+
+        this->pending_version = this->structure_version;
+        this->pending_build = std::async(std::launch::async, &BVH::build, std::move(primitives));
+    }
+
+    void BVH::adopt(BuildResult&& result) {
+        this->nodes = std::move(result.nodes);
+        this->free_nodes.clear();
+        this->root = result.root;
+
+        for(u32 i = 0; i < this->nodes.size(); i++) {
+            if(this->nodes[i].is_leaf()) {
+                this->leaves[this->nodes[i].leaf].node = i;
+            }
+        }
+
+        this->refit_all();
+        // the running sum restarts from the fresh tree so the drift of the incremental updates never piles up
+        this->interior_area = this->sum_interior_area();
+
+        this->stats.cost = this->calculate_cost();
+        this->stats.build_cost = this->stats.cost;
+        this->stats.build_ms = result.build_ms;
+        this->stats.rebuild_count++;
+    }
+
+    auto BVH::build(std::vector<BuildPrimitive> primitives) -> BuildResult {
+        constexpr u32 BIN_COUNT = 12;
+        auto start = std::chrono::high_resolution_clock::now();
+
+        BuildResult result = { {}, INVALID_INDEX, 0.0f };
+        if(primitives.empty()) {
+            return result;
+        }
+
+        result.nodes.reserve(primitives.size() * 2 - 1);
+        result.nodes.push_back({});
+        result.root = 0;
+
+        struct Range {
+            u32 node;
+            u32 begin;
+            u32 end;
+        };
+        std::vector<Range> stack = { { 0, 0, static_cast<u32>(primitives.size()) } };
+
+        while(!stack.empty()) {
+            Range range = stack.back();
+            stack.pop_back();
+
+            glm::vec3 aabb_min = glm::vec3(std::numeric_limits<f32>::max());
+            glm::vec3 aabb_max = glm::vec3(std::numeric_limits<f32>::lowest());
+            glm::vec3 centroid_min = aabb_min;
+            glm::vec3 centroid_max = aabb_max;
+            for(u32 i = range.begin; i < range.end; i++) {
+                aabb_min = glm::min(aabb_min, primitives[i].aabb_min);
+                aabb_max = glm::max(aabb_max, primitives[i].aabb_max);
+                centroid_min = glm::min(centroid_min, primitives[i].centroid);
+                centroid_max = glm::max(centroid_max, primitives[i].centroid);
+            }
+
+            result.nodes[range.node].aabb_min = aabb_min;
+            result.nodes[range.node].aabb_max = aabb_max;
+
+            if(range.end - range.begin == 1) {
+                result.nodes[range.node].leaf = primitives[range.begin].leaf;
+                continue;
+            }
+
+            // binned surface area heuristic over the centroids
+            f32 best_cost = std::numeric_limits<f32>::max();
+            i32 best_axis = -1;
+            u32 best_split = 0;
+
+            for(i32 axis = 0; axis < 3; axis++) {
+                f32 extent = centroid_max[axis] - centroid_min[axis];
+                if(extent <= 0.0f) {
+                    continue;
+                }
+
+                struct Bin {
+                    glm::vec3 aabb_min = glm::vec3(std::numeric_limits<f32>::max());
+                    glm::vec3 aabb_max = glm::vec3(std::numeric_limits<f32>::lowest());
+                    u32 count = 0;
+                };
+                std::array<Bin, BIN_COUNT> bins = {};
+
+                f32 scale = static_cast<f32>(BIN_COUNT) / extent;
+                for(u32 i = range.begin; i < range.end; i++) {
+                    u32 bin = std::min(BIN_COUNT - 1, static_cast<u32>((primitives[i].centroid[axis] - centroid_min[axis]) * scale));
+                    bins[bin].aabb_min = glm::min(bins[bin].aabb_min, primitives[i].aabb_min);
+                    bins[bin].aabb_max = glm::max(bins[bin].aabb_max, primitives[i].aabb_max);
+                    bins[bin].count++;
+                }
+
+                std::array<f32, BIN_COUNT - 1> left_area = {};
+                std::array<u32, BIN_COUNT - 1> left_count = {};
+                Bin left = {};
+                for(u32 i = 0; i < BIN_COUNT - 1; i++) {
+                    left.aabb_min = glm::min(left.aabb_min, bins[i].aabb_min);
+                    left.aabb_max = glm::max(left.aabb_max, bins[i].aabb_max);
+                    left.count += bins[i].count;
+                    left_area[i] = surface_area(left.aabb_min, left.aabb_max);
+                    left_count[i] = left.count;
+                }
+
+                Bin right = {};
+                for(u32 i = BIN_COUNT - 1; i > 0; i--) {
+                    right.aabb_min = glm::min(right.aabb_min, bins[i].aabb_min);
+                    right.aabb_max = glm::max(right.aabb_max, bins[i].aabb_max);
+                    right.count += bins[i].count;
+
+                    if(left_count[i - 1] == 0 || right.count == 0) {
+                        continue;
+                    }
+
+                    f32 cost = left_count[i - 1] * left_area[i - 1] + right.count * surface_area(right.aabb_min, right.aabb_max);
+                    if(cost < best_cost) {
+                        best_cost = cost;
+                        best_axis = axis;
+                        best_split = i;
+                    }
+                }
+            }
+
+            u32 middle = (range.begin + range.end) / 2;
+            if(best_axis != -1) {
+                f32 scale = static_cast<f32>(BIN_COUNT) / (centroid_max[best_axis] - centroid_min[best_axis]);
+                auto split = std::partition(primitives.begin() + range.begin, primitives.begin() + range.end, [&](const BuildPrimitive& primitive) {
+                    return std::min(BIN_COUNT - 1, static_cast<u32>((primitive.centroid[best_axis] - centroid_min[best_axis]) * scale)) < best_split;
+                });
+                u32 split_index = static_cast<u32>(split - primitives.begin());
+                if(split_index != range.begin && split_index != range.end) {
+                    middle = split_index;
+                }
+            }
+
+            u32 left_node = static_cast<u32>(result.nodes.size());
+            u32 right_node = left_node + 1;
+            result.nodes.push_back({ .parent = range.node });
+            result.nodes.push_back({ .parent = range.node });
+            result.nodes[range.node].left = left_node;
+            result.nodes[range.node].right = right_node;
+
+            stack.push_back({ left_node, range.begin, middle });
+            stack.push_back({ right_node, middle, range.end });
+        }
+
+        result.build_ms = elapsed_ms(start);
+        return result;
+    }
+
+    auto BVH::allocate_node() -> u32 {
+        if(!this->free_nodes.empty()) {
+            u32 index = this->free_nodes.back();
+            this->free_nodes.pop_back();
+            this->nodes[index] = {};
+            return index;
+        }
+
+        this->nodes.push_back({});
+        return static_cast<u32>(this->nodes.size() - 1);
+    }
+
+    void BVH::free_node(u32 index) {
+        this->nodes[index] = {};
+        this->free_nodes.push_back(index);
+    }
+
+    void BVH::refit_ancestors(u32 index) {
+        while(index != INVALID_INDEX) {
+            Node& node = this->nodes[index];
+            f32 old_area = surface_area(node.aabb_min, node.aabb_max);
+            node.aabb_min = glm::min(this->nodes[node.left].aabb_min, this->nodes[node.right].aabb_min);
+            node.aabb_max = glm::max(this->nodes[node.left].aabb_max, this->nodes[node.right].aabb_max);
+            this->interior_area += surface_area(node.aabb_min, node.aabb_max) - old_area;
+            index = node.parent;
+        }
+    }
+
+    void BVH::refit_all() {
+        // a fresh build always places children after their parent, so a reverse sweep is bottom up
+        for(u32 i = static_cast<u32>(this->nodes.size()); i-- > 0;) {
+            Node& node = this->nodes[i];
+            if(node.is_leaf()) {
+                node.aabb_min = this->leaves[node.leaf].aabb_min;
+                node.aabb_max = this->leaves[node.leaf].aabb_max;
+            } else if(node.left != INVALID_INDEX) {
+                node.aabb_min = glm::min(this->nodes[node.left].aabb_min, this->nodes[node.right].aabb_min);
+                node.aabb_max = glm::max(this->nodes[node.left].aabb_max, this->nodes[node.right].aabb_max);
+            }
+        }
+    }
+
+    auto BVH::calculate_cost() const -> f32 {
+        if(this->root == INVALID_INDEX) {
+            return 0.0f;
+        }
+
+        f32 root_area = surface_area(this->nodes[this->root].aabb_min, this->nodes[this->root].aabb_max);
+        if(root_area <= 0.0f) {
+            return 0.0f;
+        }
+
+        // expected number of interior nodes a random ray visits
+        return static_cast<f32>(std::max(this->interior_area, 0.0) / root_area);
+    }
+
+    auto BVH::sum_interior_area() const -> f64 {
+        if(this->root == INVALID_INDEX) {
+            return 0.0;
+        }
+
+        f64 area = 0.0;
+        std::vector<u32> stack = { this->root };
+        while(!stack.empty()) {
+            const Node& node = this->nodes[stack.back()];
+            stack.pop_back();
+            if(node.is_leaf()) {
+                continue;
+            }
+
+            area += surface_area(node.aabb_min, node.aabb_max);
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+        return area;
+    }
+
+    void BVH::query_frustum(const std::array<glm::vec4, 6>& planes, const std::function<void(entt::entity)>& callback) const {
+        if(this->root == INVALID_INDEX) {
+            return;
+        }
+
+        std::vector<u32> stack = { this->root };
+        while(!stack.empty()) {
+            const Node& node = this->nodes[stack.back()];
+            stack.pop_back();
+
+            glm::vec3 center = (node.aabb_min + node.aabb_max) * 0.5f;
+            glm::vec3 extent = (node.aabb_max - node.aabb_min) * 0.5f;
+            bool inside = true;
+            for(auto& plane : planes) {
+                f32 distance = glm::dot(glm::vec3(plane), center) + plane.w;
+                f32 radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+                if(distance + radius < 0.0f) {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if(!inside) {
+                continue;
+            }
+
+            if(node.is_leaf()) {
+                callback(this->leaves[node.leaf].entity);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    void BVH::query_aabb(const glm::vec3& aabb_min, const glm::vec3& aabb_max, const std::function<void(entt::entity)>& callback) const {
+        if(this->root == INVALID_INDEX) {
+            return;
+        }
+
+        std::vector<u32> stack = { this->root };
+        while(!stack.empty()) {
+            const Node& node = this->nodes[stack.back()];
+            stack.pop_back();
+
+            if(glm::any(glm::lessThan(node.aabb_max, aabb_min)) || glm::any(glm::greaterThan(node.aabb_min, aabb_max))) {
+                continue;
+            }
+
+            if(node.is_leaf()) {
+                callback(this->leaves[node.leaf].entity);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    auto BVH::query_ray(const glm::vec3& origin, const glm::vec3& direction, f32 max_distance) const -> RayHit {
+        RayHit hit = {};
+        hit.distance = max_distance;
+        if(this->root == INVALID_INDEX) {
+            return hit;
+        }
+
+        glm::vec3 inverse_direction = 1.0f / direction;
+        auto intersect = [&](const Node& node, f32& entry) -> bool {
+            glm::vec3 t0 = (node.aabb_min - origin) * inverse_direction;
+            glm::vec3 t1 = (node.aabb_max - origin) * inverse_direction;
+            glm::vec3 t_min = glm::min(t0, t1);
+            glm::vec3 t_max = glm::max(t0, t1);
+            entry = std::max(std::max(t_min.x, t_min.y), std::max(t_min.z, 0.0f));
+            f32 exit = std::min(std::min(t_max.x, t_max.y), t_max.z);
+            return entry <= exit && entry < hit.distance;
+        };
+
+        std::vector<u32> stack = { this->root };
+        while(!stack.empty()) {
+            const Node& node = this->nodes[stack.back()];
+            stack.pop_back();
+
+            f32 entry;
+            if(!intersect(node, entry)) {
+                continue;
+            }
+
+            if(node.is_leaf()) {
+                hit = { this->leaves[node.leaf].entity, entry };
+                continue;
+            }
+
+            // the nearer child goes on top so it can shorten the ray before the other one is visited
+            f32 left_entry, right_entry;
+            bool left_hit = intersect(this->nodes[node.left], left_entry);
+            bool right_hit = intersect(this->nodes[node.right], right_entry);
+            if(left_hit && right_hit) {
+                stack.push_back(left_entry < right_entry ? node.right : node.left);
+                stack.push_back(left_entry < right_entry ? node.left : node.right);
+            } else if(left_hit) {
+                stack.push_back(node.left);
+            } else if(right_hit) {
+                stack.push_back(node.right);
+            }
+        }
+
+        return hit;
+    }
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <entt/entt.hpp>
+#include <daxa/types.hpp>
+using namespace daxa::types;
+
+#include <array>
+#include <functional>
+#include <future>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace dare {
+    // dynamic bounding volume hierarchy over entity world bounds, one entity per leaf
+    //
+    // inserts descend greedily by surface area and moved entities only refit their ancestors, both slowly degrade
+    // the tree, so once its surface area cost drifts too far from the last full build a binned SAH build is started
+    // on a worker thread and swapped in when it is done
+    struct BVH {
+        static constexpr u32 INVALID_INDEX = std::numeric_limits<u32>::max();
+
+        struct Node {
+            glm::vec3 aabb_min = glm::vec3(0.0f);
+            glm::vec3 aabb_max = glm::vec3(0.0f);
+            u32 parent = INVALID_INDEX;
+            u32 left = INVALID_INDEX;
+            u32 right = INVALID_INDEX;
+            u32 leaf = INVALID_INDEX;
+
+            auto is_leaf() const -> bool { return leaf != INVALID_INDEX; }
+        };
+
+        struct Leaf {
+            entt::entity entity;
+            glm::vec3 aabb_min;
+            glm::vec3 aabb_max;
+            u32 node;
+        };
+
+        struct RayHit {
+            entt::entity entity = entt::null;
+            f32 distance = std::numeric_limits<f32>::max();
+        };
+
+        struct Stats {
+            u32 node_count = 0;
+            u32 leaf_count = 0;
+            u32 rebuild_count = 0;
+            u32 refits_last_frame = 0;
+            // surface area cost now and right after the last full build
+            f32 cost = 0.0f;
+            f32 build_cost = 0.0f;
+            f32 build_ms = 0.0f;
+            // filled in by the owner, which is the one driving the refits
+            f32 refit_ms = 0.0f;
+        };
+
+        // a rebuild is started once the cost grows past this factor of the cost after the last build
+        f32 rebuild_threshold = 1.5f;
+        bool background_rebuild = true;
+        Stats stats = {};
+
+        BVH() = default;
+        ~BVH();
+
+        void insert(entt::entity entity, const glm::vec3& aabb_min, const glm::vec3& aabb_max);
+        void remove(entt::entity entity);
+        void update(entt::entity entity, const glm::vec3& aabb_min, const glm::vec3& aabb_max);
+        auto contains(entt::entity entity) const -> bool { return this->leaf_lookup.contains(entity); }
+        // bounds the entity was last inserted or updated with, false when it is not in the tree
+        auto get_bounds(entt::entity entity, glm::vec3& aabb_min, glm::vec3& aabb_max) const -> bool;
+        auto size() const -> usize { return this->leaves.size(); }
+        // changes whenever an entity is inserted or removed, moving one only refits
+        auto get_structure_version() const -> u64 { return this->structure_version; }
+        void clear();
+
+        // synchronous full build over the current leaves
+        void rebuild();
+        // checks the tree quality, starts a background build if needed and adopts a finished one
+        void maintain();
+
+        void query_frustum(const std::array<glm::vec4, 6>& planes, const std::function<void(entt::entity)>& callback) const;
+        void query_aabb(const glm::vec3& aabb_min, const glm::vec3& aabb_max, const std::function<void(entt::entity)>& callback) const;
+        auto query_ray(const glm::vec3& origin, const glm::vec3& direction, f32 max_distance = std::numeric_limits<f32>::max()) const -> RayHit;
+
+        const std::vector<Node>& get_nodes() const { return this->nodes; }
+        u32 get_root() const { return this->root; }
+
+    private:
+        struct BuildResult {
+            std::vector<Node> nodes;
+            u32 root;
+            f32 build_ms;
+        };
+
+        struct BuildPrimitive {
+            glm::vec3 aabb_min;
+            glm::vec3 aabb_max;
+            glm::vec3 centroid;
+            u32 leaf;
+        };
+
+        static auto build(std::vector<BuildPrimitive> primitives) -> BuildResult;
+        void adopt(BuildResult&& result);
+
+        auto allocate_node() -> u32;
+        void free_node(u32 index);
+        void refit_ancestors(u32 index);
+        void refit_all();
+        // from the running interior area, constant time so it can be checked every frame
+        auto calculate_cost() const -> f32;
+        // walks the whole tree, only after a build
+        auto sum_interior_area() const -> f64;
+
+        std::vector<Node> nodes;
+        std::vector<u32> free_nodes;
+        std::vector<Leaf> leaves;
+        std::unordered_map<entt::entity, u32> leaf_lookup;
+        u32 root = INVALID_INDEX;
+
+        // structural changes invalidate a build started from an older snapshot of the leaves
+        u64 structure_version = 0;
+        u64 pending_version = 0;
+        std::future<BuildResult> pending_build;
+        // surface area of every interior node summed up, kept current along every refit path
+        f64 interior_area = 0.0;
+        u32 refit_count = 0;
+    };
+}
@@ -2,10 +2,12 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <entt/entt.hpp>
 #include "UUID.hpp"
 #include "../graphics/model.hpp"
 #include "../graphics/buffer.hpp"
@@ -34,6 +36,7 @@ namespace dare {
         glm::mat4 model_matrix = glm::mat4(1.0);
         glm::mat4 normal_matrix = glm::mat4(1.0);
         bool is_dirty = true;
+        bool has_changed = false;
 
         TransformComponent() = default;
         TransformComponent(const TransformComponent&) = default;
@@ -53,9 +56,32 @@ namespace dare {
             return glm::transpose(glm::inverse(calculate_matrix()));
         }
 
+        auto get_world_position() const -> glm::vec3 {
+            return glm::vec3(model_matrix[3]);
+        }
+
+        // a local direction turned by the rotation of every ancestor, a zero direction stays zero
+        auto get_world_direction(const glm::vec3& direction) const -> glm::vec3 {
+            glm::vec3 world = glm::mat3(model_matrix) * direction;
+            return glm::length(world) > 0.0f ? glm::normalize(world) : world;
+        }
+
         std::shared_ptr<Buffer<ObjectInfo>> object_info;
     };
 
+    // intrusive linked list of children, so the hierarchy lives in the same contiguous pool as everything else
+    struct RelationshipComponent {
+        entt::entity parent = entt::null;
+        entt::entity first_child = entt::null;
+        entt::entity previous_sibling = entt::null;
+        entt::entity next_sibling = entt::null;
+        u32 children = 0;
+        u32 depth = 0;
+
+        RelationshipComponent() = default;
+        RelationshipComponent(const RelationshipComponent&) = default;
+    };
+
     struct ModelComponent {
         std::shared_ptr<Model> model{};
 
@@ -64,6 +90,17 @@ namespace dare {
         ModelComponent(const std::shared_ptr<Model> &_model) : model{_model} {};
     };
 
+    // marks an entity as an occluder for the software occlusion culler, vertices are in object space and should
+    // describe a simplified stand-in that never covers more than the rendered mesh, empty falls back to the model
+    struct OccluderComponent {
+        std::vector<glm::vec3> vertices;
+        std::vector<u32> indices;
+
+        OccluderComponent() = default;
+        OccluderComponent(const OccluderComponent&) = default;
+        OccluderComponent(const std::vector<glm::vec3>& _vertices, const std::vector<u32>& _indices) : vertices{_vertices}, indices{_indices} {};
+    };
+
     struct DirectionalLightComponent {
         glm::vec3 direction = { 0.0f, -1.0f, 0.0f };
         glm::vec3 color = { 1.0f, 1.0f, 1.0f };
@@ -36,6 +36,10 @@ namespace dare {
         operator entt::entity() const { return handle; }
         operator uint32_t() const { return static_cast<uint32_t>(handle); }
 
+        void set_parent(Entity parent) { scene->set_parent(*this, parent); }
+        void remove_parent() { scene->remove_parent(*this); }
+        Entity get_parent() { return {get_component<RelationshipComponent>().parent, scene}; }
+
         UUID get_UUID() { return get_component<IDComponent>().ID; }
         entt::entity get_handle() { return handle; }
 
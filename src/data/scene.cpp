@@ -2,12 +2,28 @@
 #include "entity.hpp"
 #include "components.hpp"
 
+#include <chrono>
+#include <limits>
+
 namespace dare {
     Scene::Scene(daxa::Device& device) : device{device} {
-        lights_buffer = std::make_unique<Buffer<LightsInfo>>(device);
+        geometry_pool = std::make_shared<GeometryPool>(device);
+        buffer_pool = std::make_shared<BufferPool>(device, 64 * 1024, APPNAME_PREFIX("scene_buffer_pool"));
+        lights_buffer = std::make_unique<Buffer<LightsInfo>>(buffer_pool);
+        directional_lights_buffer = std::make_unique<GrowableBuffer<DirectionalLight>>(device);
+        point_lights_buffer = std::make_unique<GrowableBuffer<PointLight>>(device);
+        spot_lights_buffer = std::make_unique<GrowableBuffer<SpotLight>>(device);
+
+        registry.on_construct<ModelComponent>().connect<&Scene::structure_changed>(*this);
+        registry.on_update<ModelComponent>().connect<&Scene::structure_changed>(*this);
+        registry.on_destroy<ModelComponent>().connect<&Scene::structure_changed>(*this);
     }
     Scene::~Scene() = default;
 
+    void Scene::structure_changed(entt::registry&, entt::entity) {
+        structure_version++;
+    }
+
     Entity Scene::create_entity(const std::string &name) {
         return create_entity_with_UUID(UUID(), name);
     }
@@ -16,15 +32,178 @@ namespace dare {
         Entity entity = {registry.create(), this};
         entity.add_component<IDComponent>(uuid);
         entity.add_component<TransformComponent>();
-        entity.get_component<TransformComponent>().object_info = std::make_shared<Buffer<ObjectInfo>>(device);
-        //entity.add_component<RelationshipComponent>();
+        entity.get_component<TransformComponent>().object_info = std::make_shared<Buffer<ObjectInfo>>(buffer_pool);
+        entity.add_component<RelationshipComponent>();
+        hierarchy_dirty = true;
         auto &tag = entity.add_component<TagComponent>();
         tag.tag = name.empty() ? "Entity" : name;
         return entity;
     }
 
     void Scene::destroy_entity(Entity entity) {
+        // re-fetch every iteration, destroying a child can move the pool underneath us
+        while(registry.get<RelationshipComponent>(entity).first_child != entt::null) {
+            destroy_entity({registry.get<RelationshipComponent>(entity).first_child, this});
+        }
+
+        remove_parent(entity);
+        bvh.remove(entity);
         registry.destroy(entity);
+        hierarchy_dirty = true;
+    }
+
+    bool Scene::is_valid(Entity entity) {
+        return registry.valid(entity);
+    }
+
+    void Scene::set_parent(Entity child, Entity parent) {
+        if(child == parent) { return; }
+
+        // refuse to parent an entity under one of its own descendants
+        for(entt::entity ancestor = parent; ancestor != entt::null; ancestor = registry.get<RelationshipComponent>(ancestor).parent) {
+            if(ancestor == static_cast<entt::entity>(child)) { return; }
+        }
+
+        remove_parent(child);
+
+        auto& relationship = registry.get<RelationshipComponent>(child);
+        auto& parent_relationship = registry.get<RelationshipComponent>(parent);
+
+        relationship.parent = parent;
+        relationship.previous_sibling = entt::null;
+        relationship.next_sibling = parent_relationship.first_child;
+        if(parent_relationship.first_child != entt::null) {
+            registry.get<RelationshipComponent>(parent_relationship.first_child).previous_sibling = child;
+        }
+        parent_relationship.first_child = child;
+        parent_relationship.children++;
+
+        update_depth(child, parent_relationship.depth + 1);
+        registry.get<TransformComponent>(child).is_dirty = true;
+        hierarchy_dirty = true;
+    }
+
+    void Scene::remove_parent(Entity child) {
+        auto& relationship = registry.get<RelationshipComponent>(child);
+        if(relationship.parent == entt::null) { return; }
+
+        auto& parent_relationship = registry.get<RelationshipComponent>(relationship.parent);
+        if(parent_relationship.first_child == static_cast<entt::entity>(child)) {
+            parent_relationship.first_child = relationship.next_sibling;
+        }
+        if(relationship.previous_sibling != entt::null) {
+            registry.get<RelationshipComponent>(relationship.previous_sibling).next_sibling = relationship.next_sibling;
+        }
+        if(relationship.next_sibling != entt::null) {
+            registry.get<RelationshipComponent>(relationship.next_sibling).previous_sibling = relationship.previous_sibling;
+        }
+        parent_relationship.children--;
+
+        relationship.parent = entt::null;
+        relationship.previous_sibling = entt::null;
+        relationship.next_sibling = entt::null;
+
+        update_depth(child, 0);
+        registry.get<TransformComponent>(child).is_dirty = true;
+        hierarchy_dirty = true;
+    }
+
+    void Scene::update_depth(entt::entity entity, u32 depth) {
+        auto& relationship = registry.get<RelationshipComponent>(entity);
+        relationship.depth = depth;
+        for(entt::entity child = relationship.first_child; child != entt::null; child = registry.get<RelationshipComponent>(child).next_sibling) {
+            update_depth(child, depth + 1);
+        }
+    }
+
+    void Scene::update_transforms(daxa::CommandList& cmd_list, StagingRing& staging) {
+        // owning group keeps both pools packed in the same order, sorting by depth makes it breadth-first
+        // so every parent is resolved before its children and the pass is a single linear sweep
+        auto group = registry.group<RelationshipComponent, TransformComponent>();
+        if(hierarchy_dirty) {
+            group.sort<RelationshipComponent>([](const RelationshipComponent& lhs, const RelationshipComponent& rhs) {
+                return lhs.depth < rhs.depth;
+            });
+            hierarchy_dirty = false;
+        }
+
+        group.each([&](RelationshipComponent& relationship, TransformComponent& transform) {
+            const TransformComponent* parent_transform = nullptr;
+            if(relationship.parent != entt::null) {
+                parent_transform = &registry.get<TransformComponent>(relationship.parent);
+            }
+
+            // a clean entity under a clean parent keeps last frame's matrices, so only touched subtrees are recomputed
+            transform.has_changed = transform.is_dirty || (parent_transform != nullptr && parent_transform->has_changed);
+            if(!transform.has_changed) {
+                return;
+            }
+
+            glm::mat4 local = transform.calculate_matrix();
+            transform.model_matrix = parent_transform != nullptr ? parent_transform->model_matrix * local : local;
+            transform.normal_matrix = glm::transpose(glm::inverse(transform.model_matrix));
+            transform.is_dirty = false;
+
+            transform.object_info->update(cmd_list, staging, ObjectInfo {
+                .model_matrix = *reinterpret_cast<const f32mat4x4 *>(&transform.model_matrix),
+                .normal_matrix = *reinterpret_cast<const f32mat4x4 *>(&transform.normal_matrix)
+            });
+        });
+    }
+
+    void Scene::update_bvh() {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // model space bounds of the whole model moved into world space, same as the per primitive boxes in culling
+        auto world_bounds = [](const Model& model, const glm::mat4& model_matrix, glm::vec3& aabb_min, glm::vec3& aabb_max) {
+            glm::vec3 local_min = glm::vec3(std::numeric_limits<f32>::max());
+            glm::vec3 local_max = glm::vec3(std::numeric_limits<f32>::lowest());
+            for(auto& primitive : model.primitives) {
+                local_min = glm::min(local_min, primitive.aabb_min);
+                local_max = glm::max(local_max, primitive.aabb_max);
+            }
+            if(model.primitives.empty()) {
+                local_min = local_max = glm::vec3(0.0f);
+            }
+
+            glm::mat3 absolute = glm::mat3(model_matrix);
+            for(u32 i = 0; i < 3; i++) {
+                absolute[i] = glm::abs(absolute[i]);
+            }
+
+            glm::vec3 center = glm::vec3(model_matrix * glm::vec4((local_min + local_max) * 0.5f, 1.0f));
+            glm::vec3 extent = absolute * ((local_max - local_min) * 0.5f);
+            aabb_min = center - extent;
+            aabb_max = center + extent;
+        };
+
+        usize tracked = 0;
+        registry.view<ModelComponent, TransformComponent>().each([&](entt::entity entity, ModelComponent& model, TransformComponent& transform) {
+            tracked++;
+            if(bvh.contains(entity) && !transform.has_changed) {
+                return;
+            }
+
+            glm::vec3 aabb_min, aabb_max;
+            world_bounds(*model.model, transform.model_matrix, aabb_min, aabb_max);
+            bvh.update(entity, aabb_min, aabb_max);
+        });
+
+        // a model component was removed from a living entity
+        if(tracked != bvh.size()) {
+            std::vector<entt::entity> stale;
+            registry.each([&](entt::entity entity) {
+                if(bvh.contains(entity) && !registry.all_of<ModelComponent>(entity)) {
+                    stale.push_back(entity);
+                }
+            });
+            for(auto entity : stale) {
+                bvh.remove(entity);
+            }
+        }
+
+        bvh.stats.refit_ms = std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        bvh.maintain();
     }
 
     void Scene::iterate(std::function<void(Entity)> fn) {
@@ -37,72 +216,87 @@ namespace dare {
         });
     };
 
-    void Scene::update() {
-        auto cmd_list = device.create_command_list({
-            .debug_name = APPNAME_PREFIX("updating object info of entities"),
-        });
+    void Scene::update(daxa::CommandList& cmd_list, StagingRing& staging) {
+        update_transforms(cmd_list, staging);
+        update_bvh();
 
-        LightsInfo info;
-        info.num_directional_lights = 0;
-        info.num_point_lights = 0;
-        info.num_spot_lights = 0;
+        std::vector<DirectionalLight> directional_lights;
+        point_lights.clear();
+        spot_lights.clear();
+        point_light_entities.clear();
+        spot_light_entities.clear();
+
+        // distance at which intensity / distance^2 falls below the cutoff, used to bin lights into clusters
+        auto calculate_range = [](f32 intensity, const glm::vec3& color) -> f32 {
+            f32 brightest = std::max(color.r, std::max(color.g, color.b));
+            return std::sqrt(std::max(intensity * brightest, 0.0f) / LIGHT_ATTENUATION_CUTOFF);
+        };
 
         iterate([&](Entity entity) {
             if(entity.has_component<DirectionalLightComponent>()) {
                 auto& comp = entity.get_component<DirectionalLightComponent>();
-                glm::vec3 dir = comp.direction;
-                glm::vec3 col = comp.color;
-                info.directional_lights[info.num_directional_lights].direction = *reinterpret_cast<const f32vec3 *>(&dir);
-                info.directional_lights[info.num_directional_lights].color = *reinterpret_cast<const f32vec3 *>(&col);
-                info.directional_lights[info.num_directional_lights].intensity = comp.intensity;
-                info.num_directional_lights++;
+                glm::vec3 direction = entity.get_component<TransformComponent>().get_world_direction(comp.direction);
+                directional_lights.push_back(DirectionalLight {
+                    .direction = *reinterpret_cast<const f32vec3 *>(&direction),
+                    .color = *reinterpret_cast<const f32vec3 *>(&comp.color),
+                    .intensity = comp.intensity,
+                });
                 return;
             }
 
             if(entity.has_component<PointLightComponent>()) {
                 auto& comp = entity.get_component<PointLightComponent>();
-                glm::vec3 pos = entity.get_component<TransformComponent>().translation;
-                glm::vec3 col = comp.color;
-                info.point_lights[info.num_point_lights].position = *reinterpret_cast<const f32vec3 *>(&pos);
-                info.point_lights[info.num_point_lights].color = *reinterpret_cast<const f32vec3 *>(&col);
-                info.point_lights[info.num_point_lights].intensity = comp.intensity;
-                info.num_point_lights++;
+                glm::vec3 pos = entity.get_component<TransformComponent>().get_world_position();
+                point_lights.push_back(PointLight {
+                    .position = *reinterpret_cast<const f32vec3 *>(&pos),
+                    .color = *reinterpret_cast<const f32vec3 *>(&comp.color),
+                    .intensity = comp.intensity,
+                    .range = calculate_range(comp.intensity, comp.color),
+                });
+                point_light_entities.push_back(entity.get_handle());
                 return;
             }
 
             if(entity.has_component<SpotLightComponent>()) {
                 auto& comp = entity.get_component<SpotLightComponent>();
-                glm::vec3 pos = entity.get_component<TransformComponent>().translation;
-                glm::vec3 dir = comp.direction;
-                glm::vec3 col = comp.color;
-                info.spot_lights[info.num_spot_lights].position = *reinterpret_cast<const f32vec3 *>(&pos);
-                info.spot_lights[info.num_spot_lights].direction = *reinterpret_cast<const f32vec3 *>(&dir);
-                info.spot_lights[info.num_spot_lights].color = *reinterpret_cast<const f32vec3 *>(&col);
-                info.spot_lights[info.num_spot_lights].intensity = comp.intensity;
-                info.spot_lights[info.num_spot_lights].cut_off = glm::cos(glm::radians(comp.cut_off));
-                info.spot_lights[info.num_spot_lights].outer_cut_off = glm::cos(glm::radians(comp.outer_cut_off));
-                info.num_spot_lights++;
+                auto& transform = entity.get_component<TransformComponent>();
+                glm::vec3 pos = transform.get_world_position();
+                glm::vec3 direction = transform.get_world_direction(comp.direction);
+                spot_lights.push_back(SpotLight {
+                    .position = *reinterpret_cast<const f32vec3 *>(&pos),
+                    .direction = *reinterpret_cast<const f32vec3 *>(&direction),
+                    .color = *reinterpret_cast<const f32vec3 *>(&comp.color),
+                    .intensity = comp.intensity,
+                    .cut_off = glm::cos(glm::radians(comp.cut_off)),
+                    .outer_cut_off = glm::cos(glm::radians(comp.outer_cut_off)),
+                    .range = calculate_range(comp.intensity, comp.color),
+                });
+                spot_light_entities.push_back(entity.get_handle());
                 return;
             }
+        });
 
-            auto& comp = entity.get_component<TransformComponent>();
-            if(comp.is_dirty) {
-                auto m = comp.calculate_matrix();
-                auto n = comp.calculate_normal_matrix();
-                comp.object_info->update(cmd_list, ObjectInfo {
-                    .model_matrix = *reinterpret_cast<const f32mat4x4 *>(&m),
-                    .normal_matrix = *reinterpret_cast<const f32mat4x4 *>(&n)
-                });
+        directional_lights_buffer->update(cmd_list, staging, directional_lights);
+        point_lights_buffer->update(cmd_list, staging, point_lights);
+        spot_lights_buffer->update(cmd_list, staging, spot_lights);
 
-                comp.is_dirty = false;
-            }
-        });
+        lights_info = LightsInfo {
+            .num_directional_lights = static_cast<u32>(directional_lights.size()),
+            .num_point_lights = static_cast<u32>(point_lights.size()),
+            .num_spot_lights = static_cast<u32>(spot_lights.size()),
+            .directional_lights = directional_lights_buffer->buffer_address,
+            .point_lights = point_lights_buffer->buffer_address,
+            .spot_lights = spot_lights_buffer->buffer_address,
+        };
 
-        lights_buffer->update(cmd_list, info);
+        lights_buffer->update(cmd_list, staging, lights_info);
 
-        cmd_list.complete();
-        device.submit_commands({
-            .command_lists = {std::move(cmd_list)}
-        });
+        // a handful of moves per frame, everything that reads the moved buffers fetches their address afterwards
+        if(buffer_pool->background_defragment) {
+            buffer_pool->defragment(cmd_list, 16);
+            if(buffer_pool->get_stats().moves_last_defragment > 0) {
+                structure_version++;
+            }
+        }
     }
 }
\ No newline at end of file
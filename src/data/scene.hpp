@@ -2,7 +2,9 @@
 #include <entt/entt.hpp>
 
 #include "UUID.hpp"
+#include "bvh.hpp"
 #include "../graphics/buffer.hpp"
+#include "../graphics/geometry_pool.hpp"
 
 using namespace daxa::types;
 #include "../../shaders/shared.inl"
@@ -17,14 +19,46 @@ namespace dare {
             Entity create_entity(const std::string &name = std::string());
             Entity create_entity_with_UUID(UUID uuid, const std::string &name = std::string());
             void destroy_entity(Entity entity);
+            bool is_valid(Entity entity);
             void iterate(std::function<void(Entity)> fn);
-            void update();
+            // records the uploads into the command list of the frame, the staging memory comes from its slice
+            void update(daxa::CommandList& cmd_list, StagingRing& staging);
 
+            void set_parent(Entity child, Entity parent);
+            void remove_parent(Entity child);
+
+            // vertices and indices of every model loaded into the scene
+            std::shared_ptr<GeometryPool> geometry_pool;
+            // object infos, materials and the lights info are sub-allocated from here
+            std::shared_ptr<BufferPool> buffer_pool;
+
+            // world bounds of every entity with a model, kept in sync by update
+            BVH bvh;
+            // bumped whenever a model component is added, replaced or removed and whenever defragmentation moved
+            // buffers, anything built from the models of the scene and their addresses only rebuilds when it changes
+            u64 structure_version = 0;
+
+            // host copy of what was last uploaded, passes that draw per light read the counts from here
+            LightsInfo lights_info = {};
+            // host copies of the uploaded lights and the entities they came from, in upload order
+            std::vector<PointLight> point_lights;
+            std::vector<SpotLight> spot_lights;
+            std::vector<entt::entity> point_light_entities;
+            std::vector<entt::entity> spot_light_entities;
             std::unique_ptr<Buffer<LightsInfo>> lights_buffer;
+            std::unique_ptr<GrowableBuffer<DirectionalLight>> directional_lights_buffer;
+            std::unique_ptr<GrowableBuffer<PointLight>> point_lights_buffer;
+            std::unique_ptr<GrowableBuffer<SpotLight>> spot_lights_buffer;
 
             daxa::Device& device;
         private:
+            void update_transforms(daxa::CommandList& cmd_list, StagingRing& staging);
+            void update_bvh();
+            void update_depth(entt::entity entity, u32 depth);
+            void structure_changed(entt::registry& registry, entt::entity entity);
+
             entt::registry registry;
+            bool hierarchy_dirty = true;
             friend Entity;
     };
 }
\ No newline at end of file
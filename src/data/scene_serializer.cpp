@@ -3,6 +3,7 @@
 #include "entity.hpp"
 #include <yaml-cpp/yaml.h>
 #include <fstream>
+#include <unordered_map>
 
 namespace YAML {
     template<>
@@ -90,6 +91,15 @@ namespace dare {
             out << YAML::EndMap;
         }
 
+        if(entity.has_component<RelationshipComponent>() && entity.get_parent()) {
+            out << YAML::Key << "RelationshipComponent";
+            out << YAML::BeginMap;
+
+            out << YAML::Key << "Parent" << YAML::Value << entity.get_parent().get_UUID();
+
+            out << YAML::EndMap;
+        }
+
         if(entity.has_component<ModelComponent>()) {
             out << YAML::Key << "ModelComponent";
             out << YAML::BeginMap;
@@ -99,6 +109,21 @@ namespace dare {
             out << YAML::EndMap;
         }
 
+        if(entity.has_component<OccluderComponent>()) {
+            out << YAML::Key << "OccluderComponent";
+            out << YAML::BeginMap;
+
+            auto& occluder = entity.get_component<OccluderComponent>();
+            out << YAML::Key << "Vertices" << YAML::Value << YAML::BeginSeq;
+            for(auto& vertex : occluder.vertices) {
+                out << vertex;
+            }
+            out << YAML::EndSeq;
+            out << YAML::Key << "Indices" << YAML::Value << YAML::Flow << occluder.indices;
+
+            out << YAML::EndMap;
+        }
+
         if(entity.has_component<DirectionalLightComponent>()) {
             out << YAML::Key << "DirectionalLightComponent";
             out << YAML::BeginMap;
@@ -169,6 +194,8 @@ namespace dare {
 
         auto scene_name = data["Scene"].as<std::string>();
         auto entities = data["Entities"];
+        std::unordered_map<UUID, Entity> entity_map;
+        std::vector<std::pair<Entity, UUID>> parent_links;
         if(entities) {
             for(auto entity : entities) {
                 auto uuid = entity["Entity"].as<u64>();
@@ -179,6 +206,7 @@ namespace dare {
                 }
 
                 Entity deserialized_entity = scene->create_entity_with_UUID(uuid, name);
+                entity_map[uuid] = deserialized_entity;
 
                 auto transform_component = entity["TransformComponent"];
                 if(transform_component) {
@@ -188,12 +216,24 @@ namespace dare {
                     comp.scale = transform_component["Scale"].as<glm::vec3>();
                 }
 
+                auto relationship_component = entity["RelationshipComponent"];
+                if(relationship_component) {
+                    parent_links.push_back({deserialized_entity, relationship_component["Parent"].as<u64>()});
+                }
+
                 auto model_component = entity["ModelComponent"];
                 if(model_component) {
-                    auto model = std::make_shared<Model>(device, model_component["Path"].as<std::string>());
+                    auto model = std::make_shared<Model>(device, scene->geometry_pool, scene->buffer_pool, model_component["Path"].as<std::string>());
                     deserialized_entity.add_component<ModelComponent>(model);
                 }
 
+                auto occluder_component = entity["OccluderComponent"];
+                if(occluder_component) {
+                    auto& occluder = deserialized_entity.add_component<OccluderComponent>();
+                    occluder.vertices = occluder_component["Vertices"].as<std::vector<glm::vec3>>();
+                    occluder.indices = occluder_component["Indices"].as<std::vector<u32>>();
+                }
+
                 auto directional_light_component = entity["DirectionalLightComponent"];
                 if(directional_light_component) {
                     auto& light = deserialized_entity.add_component<DirectionalLightComponent>();
@@ -221,6 +261,14 @@ namespace dare {
             }
         }
 
+        // parents can be written after their children, so link once every entity exists
+        for(auto& [child, parent_uuid] : parent_links) {
+            auto it = entity_map.find(parent_uuid);
+            if(it != entity_map.end()) {
+                scene->set_parent(child, it->second);
+            }
+        }
+
         return scene;
     }
 }
\ No newline at end of file
@@ -4,15 +4,20 @@
 using namespace daxa::types;
 
 #include "../utils/utils.hpp"
+#include "buffer_pool.hpp"
+#include "staging_ring.hpp"
 
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 namespace dare {
+    // a single T on the gpu, either in a buffer of its own or sub-allocated from a pool, pooled buffers can be
+    // moved by defragmentation so buffer_id, offset and buffer_address are only valid until the next one
     template<typename T>
-    struct Buffer {
+    struct Buffer : BufferAllocation {
         daxa::Device& device;
-        daxa::BufferId buffer_id;
-        daxa::BufferDeviceAddress buffer_address;
+        std::shared_ptr<BufferPool> pool;
 
         Buffer(daxa::Device& device, const std::string& debug_name = "created buffer type of " + std::string{type_name<T>()}, daxa::MemoryFlags memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY) : device{device} {
             this->buffer_id = device.create_buffer({
@@ -22,11 +27,22 @@ namespace dare {
             });
 
             this->buffer_address = device.get_device_address(buffer_id);
+            this->size = sizeof(T);
+        }
+        Buffer(const std::shared_ptr<BufferPool>& pool) : device{pool->device}, pool{pool} {
+            pool->allocate(*this, sizeof(T), std::max<u32>(alignof(T), BufferPool::GRANULARITY));
         }
         ~Buffer() {
-            device.destroy_buffer(buffer_id);
+            if(pool) {
+                pool->free(*this);
+            } else {
+                device.destroy_buffer(buffer_id);
+            }
         }
 
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+
         void update(const T& data) {
             auto cmd_list = device.create_command_list({
                 .debug_name = "updating buffer " + std::string{type_name<T>()},
@@ -48,6 +64,7 @@ namespace dare {
             cmd_list.copy_buffer_to_buffer({
                 .src_buffer = staging_buffer,
                 .dst_buffer = buffer_id,
+                .dst_offset = offset,
                 .size = sizeof(T),
             });
 
@@ -65,26 +82,80 @@ namespace dare {
             device.destroy_buffer(staging_buffer);
         }
 
-        void update(daxa::CommandList& cmd_list, const T& data) {
-            daxa::BufferId staging_buffer = device.create_buffer({
-                .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-                .size = static_cast<u32>(sizeof(T)),
+        // the staging memory comes from the slice of the frame being recorded, host writes are visible to the
+        // gpu once the command list is submitted
+        void update(daxa::CommandList& cmd_list, StagingRing& staging, const T& data) {
+            StagingRing::Allocation staging_allocation = staging.allocate(cmd_list, sizeof(T));
+            std::memcpy(staging_allocation.host_address, &data, sizeof(T));
+
+            // the frames still in flight may read the previous contents
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::READ,
+                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
             });
 
-            cmd_list.destroy_buffer_deferred(staging_buffer);
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = staging_allocation.buffer_id,
+                .src_offset = staging_allocation.offset,
+                .dst_buffer = buffer_id,
+                .dst_offset = offset,
+                .size = sizeof(T),
+            });
 
-            auto staging_buffer_ptr = device.get_host_address_as<u8>(staging_buffer);
-            std::memcpy(staging_buffer_ptr, &data, sizeof(T));
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::READ,
+            });
+        }
+    };
+
+    // array buffer that reallocates with doubled capacity when the uploaded data no longer fits
+    template<typename T>
+    struct GrowableBuffer {
+        daxa::Device& device;
+        daxa::BufferId buffer_id;
+        daxa::BufferDeviceAddress buffer_address;
+        usize capacity;
+        std::string debug_name;
+
+        GrowableBuffer(daxa::Device& device, usize initial_capacity = 16, const std::string& debug_name = "created growable buffer type of " + std::string{type_name<T>()}) : device{device}, capacity{std::max<usize>(initial_capacity, 1)}, debug_name{debug_name} {
+            allocate();
+        }
+        ~GrowableBuffer() {
+            device.destroy_buffer(buffer_id);
+        }
 
+        // grows the buffer for contents that get written on the gpu, old contents are not kept
+        void reserve(daxa::CommandList& cmd_list, usize count) {
+            if(count > capacity) {
+                cmd_list.destroy_buffer_deferred(buffer_id);
+                capacity = std::max(count, capacity * 2);
+                allocate();
+            }
+        }
+
+        void update(daxa::CommandList& cmd_list, StagingRing& staging, const std::vector<T>& data) {
+            reserve(cmd_list, data.size());
+
+            if(data.empty()) {
+                return;
+            }
+
+            u32 size = static_cast<u32>(data.size() * sizeof(T));
+            StagingRing::Allocation staging_allocation = staging.allocate(cmd_list, size);
+            std::memcpy(staging_allocation.host_address, data.data(), size);
+
+            // the frames still in flight may read the previous contents
             cmd_list.pipeline_barrier({
-                .awaited_pipeline_access = daxa::AccessConsts::HOST_WRITE,
-                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
+                .awaited_pipeline_access = daxa::AccessConsts::READ,
+                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
             });
 
             cmd_list.copy_buffer_to_buffer({
-                .src_buffer = staging_buffer,
+                .src_buffer = staging_allocation.buffer_id,
+                .src_offset = staging_allocation.offset,
                 .dst_buffer = buffer_id,
-                .size = sizeof(T),
+                .size = size,
             });
 
             cmd_list.pipeline_barrier({
@@ -92,5 +163,52 @@ namespace dare {
                 .waiting_pipeline_access = daxa::AccessConsts::READ,
             });
         }
+
+        // uploads count elements of data starting at first to the same place in the buffer and keeps the rest,
+        // growing loses the old contents so all of data is uploaded in that case
+        void update(daxa::CommandList& cmd_list, StagingRing& staging, const std::vector<T>& data, usize first, usize count) {
+            if(data.size() > capacity) {
+                update(cmd_list, staging, data);
+                return;
+            }
+
+            if(count == 0) {
+                return;
+            }
+
+            u32 size = static_cast<u32>(count * sizeof(T));
+            StagingRing::Allocation staging_allocation = staging.allocate(cmd_list, size);
+            std::memcpy(staging_allocation.host_address, data.data() + first, size);
+
+            // the frames still in flight may read the previous contents
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::READ,
+                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            });
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = staging_allocation.buffer_id,
+                .src_offset = staging_allocation.offset,
+                .dst_buffer = buffer_id,
+                .dst_offset = first * sizeof(T),
+                .size = size,
+            });
+
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::READ,
+            });
+        }
+
+    private:
+        void allocate() {
+            this->buffer_id = device.create_buffer({
+                .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+                .size = static_cast<u32>(capacity * sizeof(T)),
+                .debug_name = debug_name,
+            });
+
+            this->buffer_address = device.get_device_address(buffer_id);
+        }
     };
 }
\ No newline at end of file
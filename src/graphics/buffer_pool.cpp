@@ -0,0 +1,200 @@
+#include "buffer_pool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace dare {
+    BufferPool::BufferPool(daxa::Device& device, u32 block_size, const std::string& debug_name) : device{device}, block_size{block_size}, debug_name{debug_name} {}
+
+    BufferPool::~BufferPool() {
+        for(auto& block : this->blocks) {
+            this->device.destroy_buffer(block->buffer_id);
+        }
+    }
+
+    void BufferPool::allocate(BufferAllocation& allocation, u32 size, u32 alignment) {
+        if(allocation.block != nullptr) {
+            throw std::runtime_error("buffer allocation is already placed");
+        }
+
+        size = std::max(size, 1u);
+        alignment = std::max(alignment, GRANULARITY);
+
+        for(auto& block : this->blocks) {
+            if(this->place(block.get(), allocation, size, alignment)) {
+                return;
+            }
+        }
+
+        // allocations bigger than a block get a block of their own
+        u32 needed = ((size + alignment - 1 + GRANULARITY - 1) / GRANULARITY) * GRANULARITY;
+        BufferPoolBlock* block = this->create_block(std::max(this->block_size, needed));
+        if(!this->place(block, allocation, size, alignment)) {
+            throw std::runtime_error("buffer pool failed to place an allocation into a new block");
+        }
+    }
+
+    void BufferPool::free(BufferAllocation& allocation) {
+        BufferPoolBlock* block = allocation.block;
+        if(block == nullptr) {
+            return;
+        }
+
+        this->release(allocation);
+
+        // one empty block stays around so an entity that gets created right after is cheap
+        if(block->allocations.empty() && this->blocks.size() > 1) {
+            this->device.destroy_buffer(block->buffer_id);
+            std::erase_if(this->blocks, [&](const std::unique_ptr<BufferPoolBlock>& b) { return b.get() == block; });
+        }
+    }
+
+    void BufferPool::defragment(daxa::CommandList& cmd_list, u32 max_moves) {
+        this->moves_last_defragment = 0;
+        if(this->blocks.size() < 2) {
+            return;
+        }
+
+        auto source_it = std::min_element(this->blocks.begin(), this->blocks.end(), [](const auto& a, const auto& b) {
+            return a->allocator.get_stats().used < b->allocator.get_stats().used;
+        });
+        BufferPoolBlock* source = source_it->get();
+
+        std::vector<BufferAllocation*> candidates(source->allocations.begin(), source->allocations.end());
+        bool has_barrier = false;
+
+        for(BufferAllocation* allocation : candidates) {
+            if(this->moves_last_defragment >= max_moves) {
+                break;
+            }
+
+            BufferAllocation moved = {};
+            bool placed = false;
+            for(auto& block : this->blocks) {
+                if(block.get() != source && this->place(block.get(), moved, allocation->size, allocation->alignment)) {
+                    placed = true;
+                    break;
+                }
+            }
+
+            // the other blocks are full, moving anything else would not free the source either
+            if(!placed) {
+                break;
+            }
+
+            if(!has_barrier) {
+                cmd_list.pipeline_barrier({
+                    .awaited_pipeline_access = daxa::AccessConsts::READ_WRITE,
+                    .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ_WRITE,
+                });
+                has_barrier = true;
+            }
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = allocation->buffer_id,
+                .src_offset = allocation->offset,
+                .dst_buffer = moved.buffer_id,
+                .dst_offset = moved.offset,
+                .size = allocation->size,
+            });
+
+            // the placeholder registered itself with the new block, the real allocation takes over its range
+            this->release(*allocation);
+            moved.block->allocations.erase(&moved);
+            moved.block->allocations.insert(allocation);
+            allocation->buffer_id = moved.buffer_id;
+            allocation->buffer_address = moved.buffer_address;
+            allocation->offset = moved.offset;
+            allocation->size = moved.size;
+            allocation->block = moved.block;
+            allocation->range = moved.range;
+            allocation->alignment = moved.alignment;
+
+            this->moves_last_defragment++;
+        }
+
+        if(has_barrier) {
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::READ,
+            });
+        }
+
+        // the copies above still read from the source block, so it has to outlive this command list
+        if(source->allocations.empty()) {
+            cmd_list.destroy_buffer_deferred(source->buffer_id);
+            std::erase_if(this->blocks, [&](const std::unique_ptr<BufferPoolBlock>& b) { return b.get() == source; });
+        }
+    }
+
+    auto BufferPool::get_stats() const -> Stats {
+        Stats stats = {
+            .block_count = static_cast<u32>(this->blocks.size()),
+            .moves_last_defragment = this->moves_last_defragment,
+        };
+
+        u64 free_bytes = 0;
+        for(auto& block : this->blocks) {
+            OffsetAllocator::Stats block_stats = block->allocator.get_stats();
+            stats.allocation_count += block_stats.allocation_count;
+            stats.reserved_bytes += block->size;
+            stats.used_bytes += static_cast<u64>(block_stats.used) * GRANULARITY;
+            stats.free_range_count += block_stats.free_block_count;
+            stats.largest_free_range = std::max(stats.largest_free_range, static_cast<u64>(block_stats.largest_free_block) * GRANULARITY);
+            free_bytes += static_cast<u64>(block_stats.free) * GRANULARITY;
+        }
+
+        if(free_bytes > 0) {
+            stats.fragmentation = 1.0f - static_cast<f32>(stats.largest_free_range) / static_cast<f32>(free_bytes);
+        }
+
+        return stats;
+    }
+
+    auto BufferPool::create_block(u32 size) -> BufferPoolBlock* {
+        daxa::BufferId buffer_id = this->device.create_buffer({
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .size = size,
+            .debug_name = this->debug_name + "_block",
+        });
+
+        this->blocks.push_back(std::make_unique<BufferPoolBlock>(BufferPoolBlock {
+            .buffer_id = buffer_id,
+            .buffer_address = this->device.get_device_address(buffer_id),
+            .size = size,
+            .allocator = OffsetAllocator{size / GRANULARITY},
+            .allocations = {},
+        }));
+
+        return this->blocks.back().get();
+    }
+
+    auto BufferPool::place(BufferPoolBlock* block, BufferAllocation& allocation, u32 size, u32 alignment) -> bool {
+        // alignments above the granularity over-allocate and round the offset up inside the range
+        u32 units = (size + GRANULARITY - 1) / GRANULARITY + (alignment / GRANULARITY - 1);
+        OffsetAllocator::Allocation range = block->allocator.allocate(units);
+        if(!range.is_valid()) {
+            return false;
+        }
+
+        usize offset = static_cast<usize>(range.offset) * GRANULARITY;
+        offset = (offset + alignment - 1) / alignment * alignment;
+
+        allocation.buffer_id = block->buffer_id;
+        allocation.buffer_address = block->buffer_address + offset;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.block = block;
+        allocation.range = range;
+        allocation.alignment = alignment;
+        block->allocations.insert(&allocation);
+        return true;
+    }
+
+    void BufferPool::release(BufferAllocation& allocation) {
+        allocation.block->allocator.free(allocation.range);
+        allocation.block->allocations.erase(&allocation);
+        allocation.block = nullptr;
+        allocation.range = {};
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "offset_allocator.hpp"
+
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace dare {
+    struct BufferPoolBlock;
+
+    // a range of a gpu buffer, either a whole dedicated buffer or a piece of one of a pool's blocks
+    struct BufferAllocation {
+        daxa::BufferId buffer_id = {};
+        // already includes the offset
+        daxa::BufferDeviceAddress buffer_address = 0;
+        usize offset = 0;
+        u32 size = 0;
+
+    private:
+        friend struct BufferPool;
+        BufferPoolBlock* block = nullptr;
+        OffsetAllocator::Allocation range = {};
+        u32 alignment = 0;
+    };
+
+    struct BufferPoolBlock {
+        daxa::BufferId buffer_id;
+        daxa::BufferDeviceAddress buffer_address;
+        u32 size;
+        OffsetAllocator allocator;
+        std::unordered_set<BufferAllocation*> allocations;
+    };
+
+    // carves small buffers out of a few big ones, every small buffer would otherwise be its own driver allocation
+    //
+    // ranges are handed out in GRANULARITY sized units by an offset allocator per block, the pool keeps a pointer
+    // to every allocation so defragmentation can move them and patch their buffer and address, users therefore
+    // have to read the address from the allocation every frame instead of caching it
+    struct BufferPool {
+        static constexpr u32 GRANULARITY = 16;
+
+        struct Stats {
+            u32 block_count = 0;
+            u32 allocation_count = 0;
+            u64 reserved_bytes = 0;
+            u64 used_bytes = 0;
+            u32 free_range_count = 0;
+            u64 largest_free_range = 0;
+            // share of the free memory that is not part of the largest free range
+            f32 fragmentation = 0.0f;
+            u32 moves_last_defragment = 0;
+        };
+
+        BufferPool(daxa::Device& device, u32 block_size = 64 * 1024, const std::string& debug_name = "buffer_pool");
+        ~BufferPool();
+
+        // throws when the allocation is already placed
+        void allocate(BufferAllocation& allocation, u32 size, u32 alignment = GRANULARITY);
+        void free(BufferAllocation& allocation);
+        // empties the least used block into the others, copies are recorded into cmd_list and at most max_moves
+        // allocations are moved so the work can be spread over several frames
+        void defragment(daxa::CommandList& cmd_list, u32 max_moves = 64);
+
+        auto get_stats() const -> Stats;
+
+        // lets the owner run a few defragment moves every frame
+        bool background_defragment = false;
+        daxa::Device& device;
+
+    private:
+        auto create_block(u32 size) -> BufferPoolBlock*;
+        auto place(BufferPoolBlock* block, BufferAllocation& allocation, u32 size, u32 alignment) -> bool;
+        void release(BufferAllocation& allocation);
+
+        std::vector<std::unique_ptr<BufferPoolBlock>> blocks;
+        u32 block_size;
+        u32 moves_last_defragment = 0;
+        std::string debug_name;
+    };
+}
@@ -0,0 +1,143 @@
+#include "geometry_pool.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace dare {
+    GeometryPool::GeometryPool(daxa::Device& device, u32 vertex_capacity, u32 index_capacity) : device{device}, vertex_allocator{vertex_capacity}, index_allocator{index_capacity} {
+        this->vertex_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = static_cast<u32>(sizeof(DrawVertex) * vertex_capacity),
+            .debug_name = APPNAME_PREFIX("geometry_pool_vertex_buffer"),
+        });
+
+        this->position_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = static_cast<u32>(sizeof(DrawPosition) * vertex_capacity),
+            .debug_name = APPNAME_PREFIX("geometry_pool_position_buffer"),
+        });
+
+        this->index_buffer = device.create_buffer(daxa::BufferInfo{
+            .size = static_cast<u32>(sizeof(u32) * index_capacity),
+            .debug_name = APPNAME_PREFIX("geometry_pool_index_buffer"),
+        });
+
+        this->vertex_buffer_address = device.get_device_address(this->vertex_buffer);
+        this->position_buffer_address = device.get_device_address(this->position_buffer);
+        this->index_buffer_address = device.get_device_address(this->index_buffer);
+    }
+
+    GeometryPool::~GeometryPool() {
+        this->device.destroy_buffer(this->vertex_buffer);
+        this->device.destroy_buffer(this->position_buffer);
+        this->device.destroy_buffer(this->index_buffer);
+    }
+
+    auto GeometryPool::allocate(u32 vertex_count, u32 index_count) -> Allocation {
+        Allocation allocation = {};
+
+        if(vertex_count > 0) {
+            allocation.vertices = this->vertex_allocator.allocate(vertex_count);
+            if(!allocation.vertices.is_valid()) {
+                throw std::runtime_error("geometry pool is out of vertex space");
+            }
+        }
+
+        if(index_count > 0) {
+            allocation.indices = this->index_allocator.allocate(index_count);
+            if(!allocation.indices.is_valid()) {
+                this->vertex_allocator.free(allocation.vertices);
+                throw std::runtime_error("geometry pool is out of index space");
+            }
+        }
+
+        return allocation;
+    }
+
+    void GeometryPool::free(const Allocation& allocation) {
+        this->vertex_allocator.free(allocation.vertices);
+        this->index_allocator.free(allocation.indices);
+    }
+
+    void GeometryPool::upload(const Allocation& allocation, const std::vector<DrawVertex>& vertices, const std::vector<u32>& indices) {
+        if(vertices.empty() && indices.empty()) {
+            return;
+        }
+
+        u32 vertex_size = static_cast<u32>(sizeof(DrawVertex) * vertices.size());
+        u32 position_size = static_cast<u32>(sizeof(DrawPosition) * vertices.size());
+        u32 index_size = static_cast<u32>(sizeof(u32) * indices.size());
+
+        auto cmd_list = this->device.create_command_list({
+            .debug_name = APPNAME_PREFIX("geometry_pool_upload_cmd_list"),
+        });
+
+        // everything shares one staging buffer, vertices first, then positions, then indices
+        auto staging_buffer = this->device.create_buffer({
+            .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+            .size = vertex_size + position_size + index_size,
+            .debug_name = APPNAME_PREFIX("geometry_pool_staging_buffer"),
+        });
+        cmd_list.destroy_buffer_deferred(staging_buffer);
+
+        auto buffer_ptr = this->device.get_host_address_as<u8>(staging_buffer);
+        std::memcpy(buffer_ptr, vertices.data(), vertex_size);
+        DrawPosition* positions = reinterpret_cast<DrawPosition*>(buffer_ptr + vertex_size);
+        for(usize i = 0; i < vertices.size(); i++) {
+            positions[i] = DrawPosition { .value = vertices[i].position };
+        }
+        std::memcpy(buffer_ptr + vertex_size + position_size, indices.data(), index_size);
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::HOST_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
+        });
+
+        if(vertex_size > 0) {
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = staging_buffer,
+                .src_offset = 0,
+                .dst_buffer = this->vertex_buffer,
+                .dst_offset = sizeof(DrawVertex) * allocation.vertices.offset,
+                .size = vertex_size,
+            });
+
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = staging_buffer,
+                .src_offset = vertex_size,
+                .dst_buffer = this->position_buffer,
+                .dst_offset = sizeof(DrawPosition) * allocation.vertices.offset,
+                .size = position_size,
+            });
+        }
+
+        if(index_size > 0) {
+            cmd_list.copy_buffer_to_buffer({
+                .src_buffer = staging_buffer,
+                .src_offset = vertex_size + position_size,
+                .dst_buffer = this->index_buffer,
+                .dst_offset = sizeof(u32) * allocation.indices.offset,
+                .size = index_size,
+            });
+        }
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::VERTEX_SHADER_READ,
+        });
+        cmd_list.complete();
+        this->device.submit_commands({
+            .command_lists = {std::move(cmd_list)},
+        });
+        this->device.wait_idle();
+    }
+
+    void GeometryPool::bind_index_buffer(daxa::CommandList& cmd_list) {
+        cmd_list.set_index_buffer(this->index_buffer, 0, 4);
+    }
+
+    auto GeometryPool::get_stats() const -> Stats {
+        return Stats {
+            .vertices = this->vertex_allocator.get_stats(),
+            .indices = this->index_allocator.get_stats(),
+        };
+    }
+}
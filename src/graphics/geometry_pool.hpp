@@ -0,0 +1,55 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "../../shaders/shared.inl"
+#include "offset_allocator.hpp"
+
+#include <vector>
+
+namespace dare {
+    // one vertex buffer and one index buffer shared by every model of a scene, models get ranges of them from
+    // an offset allocator, so all geometry can be drawn with a single index buffer bind and the draws of
+    // different models can go into the same indirect call
+    //
+    // positions are also kept in a tightly packed buffer of their own at the same offsets as the full vertices,
+    // depth only passes read that one instead
+    //
+    // the buffers are created once at their full capacity, that keeps their device addresses stable
+    struct GeometryPool {
+        struct Allocation {
+            OffsetAllocator::Allocation vertices;
+            OffsetAllocator::Allocation indices;
+        };
+
+        struct Stats {
+            OffsetAllocator::Stats vertices;
+            OffsetAllocator::Stats indices;
+        };
+
+        GeometryPool(daxa::Device& device, u32 vertex_capacity = 1 << 21, u32 index_capacity = 1 << 23);
+        ~GeometryPool();
+
+        // throws when either pool has no free range big enough left
+        auto allocate(u32 vertex_count, u32 index_count) -> Allocation;
+        void free(const Allocation& allocation);
+        // copies the data into the ranges of the allocation, waits for the upload to finish, the position
+        // stream is filled from the vertices
+        void upload(const Allocation& allocation, const std::vector<DrawVertex>& vertices, const std::vector<u32>& indices);
+
+        void bind_index_buffer(daxa::CommandList& cmd_list);
+        auto get_stats() const -> Stats;
+
+        daxa::BufferId vertex_buffer;
+        daxa::BufferId position_buffer;
+        daxa::BufferId index_buffer;
+        daxa::BufferDeviceAddress vertex_buffer_address;
+        daxa::BufferDeviceAddress position_buffer_address;
+        daxa::BufferDeviceAddress index_buffer_address;
+        daxa::Device& device;
+
+    private:
+        OffsetAllocator vertex_allocator;
+        OffsetAllocator index_allocator;
+    };
+}
@@ -7,9 +7,10 @@
 #include <tiny_gltf.h>
 
 #include <glm/gtc/type_ptr.hpp>
+#include <limits>
 
 namespace dare {
-    Model::Model(daxa::Device& device, const std::filesystem::path& path) : device{device}, path{path} {
+    Model::Model(daxa::Device& device, const std::shared_ptr<GeometryPool>& geometry_pool, const std::shared_ptr<BufferPool>& buffer_pool, const std::filesystem::path& path) : device{device}, geometry_pool{geometry_pool}, path{path} {
         auto timer = std::chrono::system_clock::now();
         std::vector<DrawVertex> vertices{};
         std::vector<u32> indices{};
@@ -128,48 +129,26 @@ namespace dare {
                 material_info.has_emissive_map = 0;
             }
 
+            // blended materials are still drawn opaque, there is no sorted transparent pass
+            material_info.alpha_cutoff = static_cast<f32>(material.alphaCutoff);
+            material_info.features = (material_info.has_albedo ? MATERIAL_FEATURE_ALBEDO : 0)
+                | (material_info.has_metallic_roughness ? MATERIAL_FEATURE_METALLIC_ROUGHNESS : 0)
+                | (material_info.has_normal_map ? MATERIAL_FEATURE_NORMAL_MAP : 0)
+                | (material.alphaMode == "MASK" ? MATERIAL_FEATURE_ALPHA_MASK : 0);
+
             material_infos.push_back(std::move(material_info));
         }
 
-        for(usize i = 0; i < material_infos.size(); i++) {
-            daxa::BufferId material_staging_buffer = device.create_buffer({
-                .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-                .size = sizeof(MaterialInfo),
-            });
-
-            daxa::BufferId material_info_buffer = device.create_buffer({
-                .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
-                .size = sizeof(MaterialInfo),
-            });
-
-            auto cmd_list = device.create_command_list({
-                .debug_name = APPNAME_PREFIX("cmd_list"),
-            });
-
-            auto buffer_ptr = device.get_host_address_as<MaterialInfo>(material_staging_buffer);
-            std::memcpy(buffer_ptr, &material_infos[i], sizeof(MaterialInfo));
-
-            cmd_list.pipeline_barrier({
-                .awaited_pipeline_access = daxa::AccessConsts::HOST_WRITE,
-                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
-            });
-
-            cmd_list.copy_buffer_to_buffer({
-                .src_buffer = material_staging_buffer,
-                .dst_buffer = material_info_buffer,
-                .size = static_cast<u32>(sizeof(MaterialInfo)),
-            });
-
-            cmd_list.complete();
-            device.submit_commands({
-                .command_lists = {std::move(cmd_list)}
-            });
-
-            device.wait_idle();
-            device.destroy_buffer(material_staging_buffer);
+        for(auto& material_info : material_infos) {
+            std::unique_ptr<Buffer<MaterialInfo>> material_buffer;
+            if(buffer_pool) {
+                material_buffer = std::make_unique<Buffer<MaterialInfo>>(buffer_pool);
+            } else {
+                material_buffer = std::make_unique<Buffer<MaterialInfo>>(device, APPNAME_PREFIX("material_info_buffer"));
+            }
 
-            material_buffers.push_back(material_info_buffer);
-            material_buffer_addresses.push_back(device.get_device_address(material_info_buffer));
+            material_buffer->update(material_info);
+            material_buffers.push_back(std::move(material_buffer));
         }
 
         for (auto & scene : model.scenes) {
@@ -212,8 +191,13 @@ namespace dare {
                         tangentsBuffer = reinterpret_cast<const float*>(&(model.buffers[view.buffer].data[accessor.byteOffset + view.byteOffset]));
                     }
 
+                    glm::vec3 aabb_min = glm::vec3(std::numeric_limits<f32>::max());
+                    glm::vec3 aabb_max = glm::vec3(std::numeric_limits<f32>::lowest());
+
                     for (size_t v = 0; v < vertexCount; v++) {
                         glm::vec3 temp_position = glm::make_vec3(&positionBuffer[v * 3]);
+                        aabb_min = glm::min(aabb_min, temp_position);
+                        aabb_max = glm::max(aabb_max, temp_position);
                         glm::vec3 temp_normal = glm::make_vec3(&normalBuffer[v * 3]);
                         glm::vec2 temp_uv = texCoordsBuffer ? glm::make_vec2(&texCoordsBuffer[v * 2]) : glm::vec2(0.0f);
                         glm::vec4 temp_tangent = tangentsBuffer ? glm::make_vec4(&tangentsBuffer[v * 4]) : glm::vec4(0.0);
@@ -265,7 +249,10 @@ namespace dare {
                         .first_vertex = vertexOffset,
                         .index_count = indexCount,
                         .vertex_count = vertexCount,
-                        .material_index = static_cast<u32>(primitive.material) 
+                        .material_index = static_cast<u32>(primitive.material),
+                        .material_bucket = primitive.material >= 0 ? material_infos[primitive.material].features : 0,
+                        .aabb_min = vertexCount > 0 ? aabb_min : glm::vec3(0.0f),
+                        .aabb_max = vertexCount > 0 ? aabb_max : glm::vec3(0.0f),
                     };
 
                     primitives.push_back(temp_primitive);
@@ -276,102 +263,45 @@ namespace dare {
             }
         }
 
-        vertex_buffer = device.create_buffer(daxa::BufferInfo{
-            .size = static_cast<u32>(sizeof(DrawVertex) * vertices.size()),
-            .debug_name = APPNAME_PREFIX("vertex_buffer"),
-        });
-
-        index_buffer = device.create_buffer(daxa::BufferInfo{
-            .size = static_cast<u32>(sizeof(u32) * indices.size()),
-            .debug_name = APPNAME_PREFIX("idnex_buffer"),
-        });
-
-        {
-            auto cmd_list = device.create_command_list({
-                .debug_name = APPNAME_PREFIX("cmd_list"),
-            });
-
-            auto vertex_staging_buffer = device.create_buffer({
-                .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-                .size = static_cast<u32>(sizeof(DrawVertex) * vertices.size()),
-                .debug_name = APPNAME_PREFIX("vertex_staging_buffer"),
-            });
-            cmd_list.destroy_buffer_deferred(vertex_staging_buffer);
-
-            auto buffer_ptr = device.get_host_address_as<DrawVertex>(vertex_staging_buffer);
-            std::memcpy(buffer_ptr, vertices.data(), vertices.size() * sizeof(DrawVertex));
-
-            cmd_list.pipeline_barrier({
-                .awaited_pipeline_access = daxa::AccessConsts::HOST_WRITE,
-                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
-            });
-
-            cmd_list.copy_buffer_to_buffer({
-                .src_buffer = vertex_staging_buffer,
-                .dst_buffer = vertex_buffer,
-                .size = static_cast<u32>(sizeof(DrawVertex) * vertices.size()),
-            });
-
-            cmd_list.pipeline_barrier({
-                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
-                .waiting_pipeline_access = daxa::AccessConsts::VERTEX_SHADER_READ,
-            });
-            cmd_list.complete();
-            device.submit_commands({
-                .command_lists = {std::move(cmd_list)},
-            });
+        cpu_positions.reserve(vertices.size());
+        for(auto& vertex : vertices) {
+            cpu_positions.push_back({ vertex.position.x, vertex.position.y, vertex.position.z });
         }
 
-        {
-            auto cmd_list = device.create_command_list({
-                .debug_name = APPNAME_PREFIX("cmd_list"),
-            });
-
-            auto index_staging_buffer = device.create_buffer({
-                .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
-                .size = static_cast<u32>(sizeof(u32) * indices.size()),
-                .debug_name = APPNAME_PREFIX("index_staging_buffer"),
-            });
-            cmd_list.destroy_buffer_deferred(index_staging_buffer);
-
-            auto buffer_ptr = device.get_host_address_as<u32>(index_staging_buffer);
-            std::memcpy(buffer_ptr, indices.data(), indices.size() * sizeof(u32));
-
-            cmd_list.pipeline_barrier({
-                .awaited_pipeline_access = daxa::AccessConsts::HOST_WRITE,
-                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
-            });
-
-            cmd_list.copy_buffer_to_buffer({
-                .src_buffer = index_staging_buffer,
-                .dst_buffer = index_buffer,
-                .size = static_cast<u32>(sizeof(u32) * indices.size()),
-            });
+        // alpha masked primitives are left out, their holes would occlude what is seen through them
+        cpu_indices.reserve(indices.size());
+        for(auto& primitive : primitives) {
+            if((primitive.material_bucket & MATERIAL_FEATURE_ALPHA_MASK) != 0) {
+                continue;
+            }
+            for(u32 i = primitive.first_index; i < primitive.first_index + primitive.index_count; i++) {
+                cpu_indices.push_back(indices[i] + primitive.first_vertex);
+            }
+        }
 
-            cmd_list.pipeline_barrier({
-                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
-                .waiting_pipeline_access = daxa::AccessConsts::VERTEX_SHADER_READ,
-            });
-            cmd_list.complete();
-            device.submit_commands({
-                .command_lists = {std::move(cmd_list)},
-            });
+        // primitives were built with offsets local to this model, the pool ranges turn them into global ones
+        geometry_allocation = geometry_pool->allocate(static_cast<u32>(vertices.size()), static_cast<u32>(indices.size()));
+        geometry_pool->upload(geometry_allocation, vertices, indices);
+        for(auto& primitive : primitives) {
+            primitive.first_vertex += geometry_allocation.vertices.offset;
+            primitive.first_index += geometry_allocation.indices.offset;
         }
 
+        vertex_buffer = geometry_pool->vertex_buffer;
+        index_buffer = geometry_pool->index_buffer;
+        vertex_buffer_address = geometry_pool->vertex_buffer_address;
+        position_buffer_address = geometry_pool->position_buffer_address;
+        index_buffer_address = geometry_pool->index_buffer_address;
+
         std::cout << path << " loaded in " << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now() - timer).count() << " ms!" << std::endl;
-        vertex_buffer_address = device.get_device_address(vertex_buffer);
     }
 
     Model::~Model() {
-        device.destroy_buffer(vertex_buffer);
-        device.destroy_buffer(index_buffer);
-        for (auto & buffer : material_buffers) {
-            device.destroy_buffer(buffer);
-        }
+        geometry_pool->free(geometry_allocation);
     }
 
     void Model::bind_index_buffer(daxa::CommandList & cmd_list) {
-        cmd_list.set_index_buffer(index_buffer, 0, 4);
+        geometry_pool->bind_index_buffer(cmd_list);
     }
 
     void Model::draw(daxa::CommandList & cmd_list) {
@@ -397,26 +327,35 @@ namespace dare {
 
     void Model::draw(daxa::CommandList & cmd_list, DrawPush& push_constant) {
         for (auto & primitive : primitives) {
-            push_constant.face_buffer = vertex_buffer_address;
-            push_constant.material_info_buffer = material_buffer_addresses[primitive.material_index];
-            cmd_list.push_constant(push_constant);
+            draw_primitive(cmd_list, primitive, push_constant);
+        }
+    }
 
-            if (primitive.index_count > 0) {
-                cmd_list.draw_indexed({
-                    .index_count = primitive.index_count,
-                    .instance_count = 1,
-                    .first_index = primitive.first_index,
-                    .vertex_offset = static_cast<i32>(primitive.first_vertex),
-                    .first_instance = 0,
-                });
-            } else {
-                cmd_list.draw({
-                    .vertex_count = primitive.vertex_count,
-                    .instance_count = 1,
-                    .first_vertex = primitive.first_vertex,
-                    .first_instance = 0
-                });
-            }
+    void Model::draw_primitive(daxa::CommandList & cmd_list, const Primitive& primitive, DrawPush& push_constant) {
+        push_constant.face_buffer = vertex_buffer_address;
+        push_constant.position_buffer = position_buffer_address;
+        push_constant.material_info_buffer = material_buffers[primitive.material_index]->buffer_address;
+        cmd_list.push_constant(push_constant);
+
+        draw_primitive(cmd_list, primitive);
+    }
+
+    void Model::draw_primitive(daxa::CommandList & cmd_list, const Primitive& primitive) {
+        if (primitive.index_count > 0) {
+            cmd_list.draw_indexed({
+                .index_count = primitive.index_count,
+                .instance_count = 1,
+                .first_index = primitive.first_index,
+                .vertex_offset = static_cast<i32>(primitive.first_vertex),
+                .first_instance = 0,
+            });
+        } else {
+            cmd_list.draw({
+                .vertex_count = primitive.vertex_count,
+                .instance_count = 1,
+                .first_vertex = primitive.first_vertex,
+                .first_instance = 0
+            });
         }
     }
 }
\ No newline at end of file
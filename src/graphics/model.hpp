@@ -7,34 +7,54 @@
 using namespace daxa::types;
 #include "../../shaders/shared.inl"
 #include "texture.hpp"
+#include "geometry_pool.hpp"
+#include "buffer.hpp"
 
 namespace dare {
     struct Primitive {
+        // offsets into the geometry pool's buffers
         u32 first_index;
         u32 first_vertex;
         u32 index_count;
         u32 vertex_count;
         u32 material_index;
+        // MATERIAL_FEATURE_* mask of the material, draws are grouped by it and drawn with a pipeline specialized to it
+        u32 material_bucket;
+        // object space bounds of the primitive's vertices
+        glm::vec3 aabb_min;
+        glm::vec3 aabb_max;
     };
 
     struct Model {
+        // the geometry pool's buffers, the model only owns its ranges of them
         daxa::BufferId vertex_buffer;
         daxa::BufferId index_buffer;
         std::vector<Primitive> primitives;
+        // cpu copy of the geometry for the software occlusion culler when an occluder has no geometry of its own,
+        // the indices are offset by each primitive's first vertex within the model rather than within the pool and
+        // leave out alpha masked primitives, whose holes must not occlude
+        std::vector<glm::vec3> cpu_positions;
+        std::vector<u32> cpu_indices;
         std::vector<MaterialInfo> material_infos;
-        std::vector<daxa::BufferId> material_buffers;
-        std::vector<u64> material_buffer_addresses;
+        std::vector<std::unique_ptr<Buffer<MaterialInfo>>> material_buffers;
         std::vector<std::unique_ptr<Texture>> images;
         std::unique_ptr<Texture> default_texture;
         u64 vertex_buffer_address;
+        u64 position_buffer_address;
+        u64 index_buffer_address;
         daxa::Device& device;
+        std::shared_ptr<GeometryPool> geometry_pool;
+        GeometryPool::Allocation geometry_allocation;
         std::string path;
 
-        Model(daxa::Device& device, const std::filesystem::path& path);
+        // without a buffer pool every material gets a buffer of its own
+        Model(daxa::Device& device, const std::shared_ptr<GeometryPool>& geometry_pool, const std::shared_ptr<BufferPool>& buffer_pool, const std::filesystem::path& path);
         ~Model();
 
         void bind_index_buffer(daxa::CommandList& cmd_list);
         void draw(daxa::CommandList& cmd_list);
         void draw(daxa::CommandList& cmd_list, DrawPush& push_constant);
+        void draw_primitive(daxa::CommandList& cmd_list, const Primitive& primitive);
+        void draw_primitive(daxa::CommandList& cmd_list, const Primitive& primitive, DrawPush& push_constant);
     };
 }
\ No newline at end of file
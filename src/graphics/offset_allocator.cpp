@@ -0,0 +1,235 @@
+#include "offset_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+namespace dare {
+    OffsetAllocator::OffsetAllocator(u32 capacity) : capacity{capacity} {
+        reset();
+    }
+
+    void OffsetAllocator::reset() {
+        this->used = 0;
+        this->allocation_count = 0;
+        this->nodes.clear();
+        this->free_nodes.clear();
+        this->bin_heads.fill(INVALID_INDEX);
+        this->second_level_masks.fill(0);
+        this->first_level_mask = 0;
+
+        if(this->capacity > 0) {
+            insert_into_bin(create_node(0, this->capacity));
+        }
+    }
+
+    auto OffsetAllocator::allocate(u32 size) -> Allocation {
+        if(size == 0) {
+            return {};
+        }
+
+        u32 bin = find_free_bin(bin_round_up(size));
+        if(bin == INVALID_INDEX) {
+            return {};
+        }
+
+        u32 index = this->bin_heads[bin];
+        remove_from_bin(index);
+
+        u32 remainder = this->nodes[index].size - size;
+        this->nodes[index].size = size;
+        this->nodes[index].used = true;
+
+        // the rest of the block goes back as a free block right after the allocation
+        if(remainder > 0) {
+            u32 rest = create_node(this->nodes[index].offset + size, remainder);
+            u32 next = this->nodes[index].neighbour_next;
+            this->nodes[rest].neighbour_prev = index;
+            this->nodes[rest].neighbour_next = next;
+            if(next != INVALID_INDEX) {
+                this->nodes[next].neighbour_prev = rest;
+            }
+            this->nodes[index].neighbour_next = rest;
+            insert_into_bin(rest);
+        }
+
+        this->used += size;
+        this->allocation_count++;
+
+        return Allocation {
+            .offset = this->nodes[index].offset,
+            .size = size,
+            .node = index,
+        };
+    }
+
+    void OffsetAllocator::free(const Allocation& allocation) {
+        if(!allocation.is_valid()) {
+            return;
+        }
+
+        u32 index = allocation.node;
+        if(index >= this->nodes.size() || !this->nodes[index].used) {
+            throw std::runtime_error("freeing an allocation that is not allocated");
+        }
+
+        this->used -= this->nodes[index].size;
+        this->allocation_count--;
+        this->nodes[index].used = false;
+
+        u32 prev = this->nodes[index].neighbour_prev;
+        if(prev != INVALID_INDEX && !this->nodes[prev].used) {
+            remove_from_bin(prev);
+            this->nodes[index].offset = this->nodes[prev].offset;
+            this->nodes[index].size += this->nodes[prev].size;
+            this->nodes[index].neighbour_prev = this->nodes[prev].neighbour_prev;
+            if(this->nodes[index].neighbour_prev != INVALID_INDEX) {
+                this->nodes[this->nodes[index].neighbour_prev].neighbour_next = index;
+            }
+            release_node(prev);
+        }
+
+        u32 next = this->nodes[index].neighbour_next;
+        if(next != INVALID_INDEX && !this->nodes[next].used) {
+            remove_from_bin(next);
+            this->nodes[index].size += this->nodes[next].size;
+            this->nodes[index].neighbour_next = this->nodes[next].neighbour_next;
+            if(this->nodes[index].neighbour_next != INVALID_INDEX) {
+                this->nodes[this->nodes[index].neighbour_next].neighbour_prev = index;
+            }
+            release_node(next);
+        }
+
+        insert_into_bin(index);
+    }
+
+    auto OffsetAllocator::get_stats() const -> Stats {
+        Stats stats = {
+            .capacity = this->capacity,
+            .used = this->used,
+            .free = this->capacity - this->used,
+            .allocation_count = this->allocation_count,
+        };
+
+        for(u32 bin = 0; bin < BIN_COUNT; bin++) {
+            for(u32 index = this->bin_heads[bin]; index != INVALID_INDEX; index = this->nodes[index].bin_next) {
+                stats.largest_free_block = std::max(stats.largest_free_block, this->nodes[index].size);
+                stats.free_block_count++;
+            }
+        }
+
+        return stats;
+    }
+
+    auto OffsetAllocator::bin_round_down(u32 size) -> u32 {
+        if(size < SECOND_LEVEL_COUNT) {
+            return size;
+        }
+
+        u32 log2 = 31 - std::countl_zero(size);
+        u32 first_level = log2 - SECOND_LEVEL_BITS + 1;
+        u32 second_level = (size >> (log2 - SECOND_LEVEL_BITS)) & (SECOND_LEVEL_COUNT - 1);
+        return first_level * SECOND_LEVEL_COUNT + second_level;
+    }
+
+    auto OffsetAllocator::bin_round_up(u32 size) -> u32 {
+        if(size < SECOND_LEVEL_COUNT) {
+            return size;
+        }
+
+        // every block in the returned bin is at least as big as size
+        u32 log2 = 31 - std::countl_zero(size);
+        u64 mask = (1ull << (log2 - SECOND_LEVEL_BITS)) - 1;
+        u64 rounded = (static_cast<u64>(size) + mask) & ~mask;
+        if(rounded > std::numeric_limits<u32>::max()) {
+            return BIN_COUNT;
+        }
+
+        return bin_round_down(static_cast<u32>(rounded));
+    }
+
+    auto OffsetAllocator::find_free_bin(u32 min_bin) const -> u32 {
+        if(min_bin >= BIN_COUNT) {
+            return INVALID_INDEX;
+        }
+
+        u32 first_level = min_bin / SECOND_LEVEL_COUNT;
+        u32 second_level_mask = this->second_level_masks[first_level] & (0xFFu << (min_bin % SECOND_LEVEL_COUNT));
+        if(second_level_mask != 0) {
+            return first_level * SECOND_LEVEL_COUNT + std::countr_zero(second_level_mask);
+        }
+
+        if(first_level + 1 >= FIRST_LEVEL_COUNT) {
+            return INVALID_INDEX;
+        }
+
+        u32 first_level_mask = this->first_level_mask & (~0u << (first_level + 1));
+        if(first_level_mask == 0) {
+            return INVALID_INDEX;
+        }
+
+        first_level = std::countr_zero(first_level_mask);
+        return first_level * SECOND_LEVEL_COUNT + std::countr_zero(static_cast<u32>(this->second_level_masks[first_level]));
+    }
+
+    auto OffsetAllocator::create_node(u32 offset, u32 size) -> u32 {
+        u32 index;
+        if(!this->free_nodes.empty()) {
+            index = this->free_nodes.back();
+            this->free_nodes.pop_back();
+        } else {
+            index = static_cast<u32>(this->nodes.size());
+            this->nodes.emplace_back();
+        }
+
+        this->nodes[index] = Node { .offset = offset, .size = size };
+        return index;
+    }
+
+    void OffsetAllocator::release_node(u32 index) {
+        this->nodes[index] = {};
+        this->free_nodes.push_back(index);
+    }
+
+    void OffsetAllocator::insert_into_bin(u32 index) {
+        u32 bin = bin_round_down(this->nodes[index].size);
+        u32 head = this->bin_heads[bin];
+
+        this->nodes[index].bin_prev = INVALID_INDEX;
+        this->nodes[index].bin_next = head;
+        if(head != INVALID_INDEX) {
+            this->nodes[head].bin_prev = index;
+        }
+        this->bin_heads[bin] = index;
+
+        u32 first_level = bin / SECOND_LEVEL_COUNT;
+        this->second_level_masks[first_level] |= static_cast<u8>(1u << (bin % SECOND_LEVEL_COUNT));
+        this->first_level_mask |= 1u << first_level;
+    }
+
+    void OffsetAllocator::remove_from_bin(u32 index) {
+        Node& node = this->nodes[index];
+        if(node.bin_prev != INVALID_INDEX) {
+            this->nodes[node.bin_prev].bin_next = node.bin_next;
+        }
+        if(node.bin_next != INVALID_INDEX) {
+            this->nodes[node.bin_next].bin_prev = node.bin_prev;
+        }
+
+        u32 bin = bin_round_down(node.size);
+        if(this->bin_heads[bin] == index) {
+            this->bin_heads[bin] = node.bin_next;
+
+            if(node.bin_next == INVALID_INDEX) {
+                u32 first_level = bin / SECOND_LEVEL_COUNT;
+                this->second_level_masks[first_level] &= static_cast<u8>(~(1u << (bin % SECOND_LEVEL_COUNT)));
+                if(this->second_level_masks[first_level] == 0) {
+                    this->first_level_mask &= ~(1u << first_level);
+                }
+            }
+        }
+
+        node.bin_prev = INVALID_INDEX;
+        node.bin_next = INVALID_INDEX;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <daxa/types.hpp>
+using namespace daxa::types;
+
+#include <array>
+#include <limits>
+#include <vector>
+
+namespace dare {
+    // two level segregated fit allocator over an abstract range of elements, it only hands out offsets so the
+    // same allocator works for any buffer, allocation and free are constant time and neighbouring free blocks
+    // are merged right away
+    //
+    // free blocks are binned by size, the first level is the power of two and the second level splits every
+    // power of two into SECOND_LEVEL_COUNT linear steps, a bitmap per level finds the next non empty bin
+    struct OffsetAllocator {
+        static constexpr u32 INVALID_INDEX = std::numeric_limits<u32>::max();
+        static constexpr u32 SECOND_LEVEL_BITS = 3;
+        static constexpr u32 SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_BITS;
+        static constexpr u32 FIRST_LEVEL_COUNT = 32 - SECOND_LEVEL_BITS + 1;
+        static constexpr u32 BIN_COUNT = FIRST_LEVEL_COUNT * SECOND_LEVEL_COUNT;
+
+        struct Allocation {
+            u32 offset = INVALID_INDEX;
+            u32 size = 0;
+            u32 node = INVALID_INDEX;
+
+            auto is_valid() const -> bool { return node != INVALID_INDEX; }
+        };
+
+        struct Stats {
+            u32 capacity = 0;
+            u32 used = 0;
+            u32 free = 0;
+            u32 largest_free_block = 0;
+            u32 allocation_count = 0;
+            u32 free_block_count = 0;
+        };
+
+        OffsetAllocator(u32 capacity);
+        ~OffsetAllocator() = default;
+
+        // returns an invalid allocation when no free block is big enough
+        auto allocate(u32 size) -> Allocation;
+        void free(const Allocation& allocation);
+        void reset();
+
+        auto get_stats() const -> Stats;
+
+    private:
+        struct Node {
+            u32 offset = 0;
+            u32 size = 0;
+            u32 bin_prev = INVALID_INDEX;
+            u32 bin_next = INVALID_INDEX;
+            u32 neighbour_prev = INVALID_INDEX;
+            u32 neighbour_next = INVALID_INDEX;
+            bool used = false;
+        };
+
+        static auto bin_round_down(u32 size) -> u32;
+        static auto bin_round_up(u32 size) -> u32;
+        auto find_free_bin(u32 min_bin) const -> u32;
+
+        auto create_node(u32 offset, u32 size) -> u32;
+        void release_node(u32 index);
+        void insert_into_bin(u32 index);
+        void remove_from_bin(u32 index);
+
+        u32 capacity;
+        u32 used = 0;
+        u32 allocation_count = 0;
+        std::vector<Node> nodes;
+        std::vector<u32> free_nodes;
+        std::array<u32, BIN_COUNT> bin_heads;
+        std::array<u8, FIRST_LEVEL_COUNT> second_level_masks;
+        u32 first_level_mask = 0;
+    };
+}
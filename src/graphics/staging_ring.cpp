@@ -0,0 +1,73 @@
+#include "staging_ring.hpp"
+
+#include <algorithm>
+
+namespace dare {
+    StagingRing::StagingRing(daxa::Device& device, usize frame_count, usize slice_size, const std::string& debug_name) : device{device}, frame_count{std::max<usize>(frame_count, 1)}, slice_size{slice_size}, debug_name{debug_name} {
+        this->create_buffer();
+    }
+
+    StagingRing::~StagingRing() {
+        this->device.destroy_buffer(this->buffer_id);
+    }
+
+    void StagingRing::create_buffer() {
+        this->buffer_id = this->device.create_buffer({
+            .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+            .size = static_cast<u32>(this->slice_size * this->frame_count),
+            .debug_name = this->debug_name,
+        });
+        this->host_address = this->device.get_host_address_as<u8>(this->buffer_id);
+    }
+
+    void StagingRing::begin_frame(daxa::CommandList& cmd_list, usize frame_index) {
+        this->required_slice_size = std::max(this->required_slice_size, this->head);
+        this->frame_index = frame_index % this->frame_count;
+        this->head = 0;
+        this->overflow_count = 0;
+
+        // every slice moves, older frames keep reading the old buffer until the deferred destroy runs
+        if(this->required_slice_size > this->slice_size) {
+            cmd_list.destroy_buffer_deferred(this->buffer_id);
+            this->slice_size = std::max(this->required_slice_size, this->slice_size * 2);
+            this->create_buffer();
+        }
+    }
+
+    auto StagingRing::allocate(daxa::CommandList& cmd_list, usize size, usize alignment) -> Allocation {
+        usize offset = (this->head + alignment - 1) / alignment * alignment;
+        this->head = offset + size;
+
+        if(this->head > this->slice_size) {
+            this->overflow_count++;
+
+            daxa::BufferId overflow_buffer = this->device.create_buffer({
+                .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_SEQUENTIAL_WRITE,
+                .size = static_cast<u32>(size),
+                .debug_name = this->debug_name + "_overflow",
+            });
+            cmd_list.destroy_buffer_deferred(overflow_buffer);
+
+            return Allocation {
+                .buffer_id = overflow_buffer,
+                .offset = 0,
+                .host_address = this->device.get_host_address_as<u8>(overflow_buffer),
+            };
+        }
+
+        usize slice_offset = this->frame_index * this->slice_size;
+        return Allocation {
+            .buffer_id = this->buffer_id,
+            .offset = slice_offset + offset,
+            .host_address = this->host_address + slice_offset + offset,
+        };
+    }
+
+    auto StagingRing::get_stats() const -> Stats {
+        return Stats {
+            .slice_size = this->slice_size,
+            .used_bytes = this->head,
+            .overflow_count = this->overflow_count,
+        };
+    }
+}
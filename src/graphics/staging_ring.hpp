@@ -0,0 +1,57 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+
+#include <string>
+#include <vector>
+
+namespace dare {
+    // host visible upload memory with one slice per frame in flight, a frame hands out its slice linearly and
+    // the slice is only reused once the gpu finished the frame that wrote it last, so per frame uploads
+    // neither allocate nor have to wait
+    //
+    // uploads that do not fit go into a temporary buffer and the ring grows at the start of a later frame
+    struct StagingRing {
+        struct Allocation {
+            daxa::BufferId buffer_id = {};
+            usize offset = 0;
+            u8* host_address = nullptr;
+        };
+
+        struct Stats {
+            u64 slice_size = 0;
+            u64 used_bytes = 0;
+            u32 overflow_count = 0;
+        };
+
+        StagingRing(daxa::Device& device, usize frame_count, usize slice_size = 1024 * 1024, const std::string& debug_name = "staging_ring");
+        ~StagingRing();
+
+        StagingRing(const StagingRing&) = delete;
+        StagingRing& operator=(const StagingRing&) = delete;
+
+        // only call once the gpu is done with the frame that last used this slot, an outgrown buffer is released
+        // through cmd_list so the frames still in flight keep it until they are done
+        void begin_frame(daxa::CommandList& cmd_list, usize frame_index);
+        auto allocate(daxa::CommandList& cmd_list, usize size, usize alignment = 16) -> Allocation;
+
+        // usage of the frame recorded last
+        auto get_stats() const -> Stats;
+
+    private:
+        void create_buffer();
+
+        daxa::Device& device;
+        daxa::BufferId buffer_id = {};
+        u8* host_address = nullptr;
+        usize frame_count;
+        usize slice_size;
+        // the biggest frame so far, the ring grows to it once a frame begins
+        usize required_slice_size = 0;
+        usize frame_index = 0;
+        usize head = 0;
+        u32 overflow_count = 0;
+        std::string debug_name;
+    };
+}
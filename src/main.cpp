@@ -3,6 +3,7 @@
 #include <thread>
 #include <iostream>
 #include <cmath>
+#include <random>
 
 #include <daxa/utils/imgui.hpp>
 #include <imgui_impl_glfw.h>
@@ -50,6 +51,8 @@ namespace dare {
         std::shared_ptr<SceneHiearchyPanel> scene_hiearchy = std::make_shared<SceneHiearchyPanel>(scene);
         std::unique_ptr<ViewportPanel> viewport_panel = std::make_unique<ViewportPanel>();
 
+        Entity stress_lights = {};
+
         App() = default;
         ~App() = default;
 
@@ -104,6 +107,20 @@ namespace dare {
                 if(ImGui::Button("Load scene")) {
                     scene = SceneSerializer::deserialize(this->rendering_system->context.device, "test.scene");
                     scene_hiearchy = std::make_shared<SceneHiearchyPanel>(scene);
+                    stress_lights = {};
+                }
+
+                ImGui::Separator();
+                ImGui::Text("Stress Lights");
+                for(u32 count : { 16u, 256u, 4096u }) {
+                    ImGui::SameLine();
+                    if(ImGui::Button(std::to_string(count).c_str())) {
+                        spawn_stress_lights(count);
+                    }
+                }
+                ImGui::SameLine();
+                if(ImGui::Button("Clear")) {
+                    clear_stress_lights();
                 }
                 ImGui::End();
             }
@@ -134,6 +151,37 @@ namespace dare {
             ImGui::Render();
         }
 
+        void clear_stress_lights() {
+            if(stress_lights && scene->is_valid(stress_lights)) {
+                scene->destroy_entity(stress_lights);
+            }
+            stress_lights = {};
+        }
+
+        // scatters random point lights over the scene to compare light culling paths under load
+        void spawn_stress_lights(u32 count) {
+            clear_stress_lights();
+
+            stress_lights = scene->create_entity("Stress Lights");
+
+            std::mt19937 generator(1337);
+            std::uniform_real_distribution<f32> position_distribution(-20.0f, 20.0f);
+            std::uniform_real_distribution<f32> height_distribution(0.0f, 8.0f);
+            std::uniform_real_distribution<f32> color_distribution(0.1f, 1.0f);
+            std::uniform_real_distribution<f32> intensity_distribution(1.0f, 8.0f);
+
+            for(u32 i = 0; i < count; i++) {
+                Entity light = scene->create_entity("Stress Light " + std::to_string(i));
+                light.get_component<TransformComponent>().translation = { position_distribution(generator), height_distribution(generator), position_distribution(generator) };
+
+                auto& point_light = light.add_component<PointLightComponent>();
+                point_light.color = { color_distribution(generator), color_distribution(generator), color_distribution(generator) };
+                point_light.intensity = intensity_distribution(generator);
+
+                light.set_parent(stress_lights);
+            }
+        }
+
         void draw() {
             current_frame = glfwGetTime();
             delta_time = current_frame - last_frame;
@@ -142,8 +190,6 @@ namespace dare {
             ui_update();
             this->rendering_system->task->rebuild_pipeline();
 
-            scene->update();
-
             if(viewport_panel->should_resize()) {
                 glm::vec2 size = viewport_panel->get_size();
                 cameras[current_camera].camera.resize(static_cast<i32>(size.x), static_cast<i32>(size.y));
@@ -154,9 +200,29 @@ namespace dare {
             cameras[current_camera].camera.set_rot(cameras[current_camera].rot.x, cameras[current_camera].rot.y);
             cameras[current_camera].update(delta_time);
 
+            if(auto clicked_uv = viewport_panel->get_clicked_uv()) {
+                pick_entity(*clicked_uv);
+            }
+
             rendering_system->draw(scene, cameras[current_camera]);
         }
 
+        // selects the entity whose bounds the ray under the cursor enters first
+        void pick_entity(const glm::vec2& uv) {
+            glm::mat4 inverse_view_projection = glm::inverse(cameras[current_camera].camera.get_vp());
+            glm::vec2 ndc = uv * 2.0f - 1.0f;
+            glm::vec4 near_point = inverse_view_projection * glm::vec4(ndc, 0.0f, 1.0f);
+            glm::vec4 far_point = inverse_view_projection * glm::vec4(ndc, 1.0f, 1.0f);
+
+            glm::vec3 origin = glm::vec3(near_point) / near_point.w;
+            glm::vec3 direction = glm::normalize(glm::vec3(far_point) / far_point.w - origin);
+
+            BVH::RayHit hit = scene->bvh.query_ray(origin, direction);
+            if(hit.entity != entt::null) {
+                scene_hiearchy->selected_entity = { hit.entity, scene.get() };
+            }
+        }
+
         void setup() {
             glfwSetWindowUserPointer(window->glfw_window_ptr, this);
             glfwSetCursorPosCallback(window->glfw_window_ptr, [](GLFWwindow * window_ptr, f64 x, f64 y) {
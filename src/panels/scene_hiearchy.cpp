@@ -22,31 +22,84 @@ namespace dare {
         }
     }
 
-    void SceneHiearchyPanel::draw() {
-        ImGui::Begin("Scene Hiearchy");
+    void SceneHiearchyPanel::draw_entity_node(Entity entity) {
+        auto& name = entity.get_component<TagComponent>().tag;
+        auto& relationship = entity.get_component<RelationshipComponent>();
 
-        scene->iterate([=](Entity entity) {
-            auto& name = entity.get_component<TagComponent>().tag;
-            if(ImGui::Button(name.c_str())) {
-                selected_entity = entity;
+        ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_SpanAvailWidth;
+        if(relationship.children == 0) { flags |= ImGuiTreeNodeFlags_Leaf; }
+        if(selected_entity == entity) { flags |= ImGuiTreeNodeFlags_Selected; }
+
+        bool opened = ImGui::TreeNodeEx(reinterpret_cast<void*>(static_cast<u64>(static_cast<u32>(entity))), flags, "%s", name.c_str());
+        if(ImGui::IsItemClicked()) {
+            selected_entity = entity;
+        }
+
+        if (ImGui::BeginDragDropSource()) {
+            entt::entity handle = entity;
+            ImGui::SetDragDropPayload("SCENE_HIEARCHY_ENTITY", &handle, sizeof(entt::entity));
+            ImGui::Text("%s", name.c_str());
+            ImGui::EndDragDropSource();
+        }
+
+        if (ImGui::BeginDragDropTarget()) {
+            if (const ImGuiPayload* payload = ImGui::AcceptDragDropPayload("SCENE_HIEARCHY_ENTITY")) {
+                entity_to_reparent = {*reinterpret_cast<const entt::entity*>(payload->Data), scene.get()};
+                new_parent = entity;
+            }
+            ImGui::EndDragDropTarget();
+        }
+
+        if (ImGui::BeginPopupContextItem()) {
+            if (ImGui::MenuItem("Delete Entity")) {
+                entity_to_delete = entity;
             }
 
-            bool entity_deleted = false;
-            if (ImGui::BeginPopupContextItem()) {
-                if (ImGui::MenuItem("Delete Entity")) {
-                    entity_deleted = true;
-                }
+            if (relationship.parent != entt::null && ImGui::MenuItem("Unparent Entity")) {
+                entity_to_reparent = entity;
+                new_parent = {};
+            }
 
-                ImGui::EndPopup();
+            ImGui::EndPopup();
+        }
+
+        if(opened) {
+            for(entt::entity child = entity.get_component<RelationshipComponent>().first_child; child != entt::null;) {
+                Entity child_entity = {child, scene.get()};
+                child = child_entity.get_component<RelationshipComponent>().next_sibling;
+                draw_entity_node(child_entity);
             }
+            ImGui::TreePop();
+        }
+    }
 
-            if(entity_deleted) {
-                scene->destroy_entity(entity);
-                if (selected_entity == entity)
-                    selected_entity = {};
+    void SceneHiearchyPanel::draw() {
+        ImGui::Begin("Scene Hiearchy");
+
+        scene->iterate([=](Entity entity) {
+            if(!entity.get_parent()) {
+                draw_entity_node(entity);
             }
         });
 
+        // editing the hierarchy while walking it would invalidate the sibling links we are iterating
+        if(entity_to_reparent) {
+            if(new_parent) {
+                scene->set_parent(entity_to_reparent, new_parent);
+            } else {
+                scene->remove_parent(entity_to_reparent);
+            }
+            entity_to_reparent = {};
+            new_parent = {};
+        }
+
+        if(entity_to_delete) {
+            scene->destroy_entity(entity_to_delete);
+            if (selected_entity && !scene->is_valid(selected_entity))
+                selected_entity = {};
+            entity_to_delete = {};
+        }
+
         if (ImGui::IsMouseDown(0) && ImGui::IsWindowHovered())
                 selected_entity = {};
 
@@ -81,6 +134,14 @@ namespace dare {
                 ImGui::CloseCurrentPopup();
             }
 
+            if (ImGui::MenuItem("Occluder")) {
+                if (!selected_entity.has_component<OccluderComponent>())
+                    selected_entity.add_component<OccluderComponent>();
+                else
+                    std::cout << "screw this" << std::endl;
+                ImGui::CloseCurrentPopup();
+            }
+
             if (ImGui::MenuItem("Spot Light")) {
                 if (!selected_entity.has_component<SpotLightComponent>())
                     selected_entity.add_component<SpotLightComponent>();
@@ -114,6 +175,14 @@ namespace dare {
                 ImGui::Text("File path: %s", comp.model->path.c_str());
             });
 
+            draw_component<OccluderComponent>("OccluderComponent", selected_entity, [](OccluderComponent& comp) {
+                if(comp.vertices.empty()) {
+                    ImGui::Text("Geometry: model");
+                } else {
+                    ImGui::Text("Triangles: %zu", comp.indices.size() / 3);
+                }
+            });
+
             draw_component<DirectionalLightComponent>("DirectionalLightComponent", selected_entity, [](DirectionalLightComponent& comp) {
                 ImGui::DragFloat3("Direction", &comp.direction.x);
                 ImGui::ColorPicker3("Color", &comp.color.x);
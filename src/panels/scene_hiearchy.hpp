@@ -13,5 +13,10 @@ namespace dare {
         ~SceneHiearchyPanel();
 
         void draw();
+        void draw_entity_node(Entity entity);
+
+        Entity entity_to_delete;
+        Entity entity_to_reparent;
+        Entity new_parent;
     };
 }
\ No newline at end of file
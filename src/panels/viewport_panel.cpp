@@ -14,6 +14,13 @@ namespace dare {
         }
 
         ImGui::Image(*reinterpret_cast<ImTextureID const *>(&image), region);
+
+        clicked_uv.reset();
+        if(ImGui::IsItemClicked(ImGuiMouseButton_Left) && region.x > 0.0f && region.y > 0.0f) {
+            ImVec2 mouse = ImGui::GetMousePos();
+            ImVec2 min = ImGui::GetItemRectMin();
+            clicked_uv = glm::vec2{ (mouse.x - min.x) / region.x, (mouse.y - min.y) / region.y };
+        }
         ImGui::End();
         ImGui::PopStyleVar();
     }
@@ -25,4 +32,8 @@ namespace dare {
     auto ViewportPanel::should_resize() -> bool {
         return resized;
     }
+
+    auto ViewportPanel::get_clicked_uv() -> std::optional<glm::vec2> {
+        return clicked_uv;
+    }
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <daxa/daxa.hpp>
 
+#include <optional>
+
 namespace dare {
     struct ViewportPanel {
         ViewportPanel() = default;
@@ -14,8 +16,11 @@ namespace dare {
         void draw(daxa::ImageId image);
         auto get_size() -> glm::vec2;
         auto should_resize() -> bool;
+        // position of this frame's left click inside the image, from 0 to 1
+        auto get_clicked_uv() -> std::optional<glm::vec2>;
 
         bool resized = true;
+        std::optional<glm::vec2> clicked_uv;
         glm::vec2 size{ 400.0f, 300.0f };
     };
 }
\ No newline at end of file
@@ -7,21 +7,23 @@ namespace dare {
         u32 sx = static_cast<u32>(this->size.x);
         u32 sy = static_cast<u32>(this->size.y);
 
+        // float target so the tiled compute composition can write it as a storage image
         this->color_image = this->context.device.create_image({
             .dimensions = 2,
-            .format = this->context.swapchain.get_format(),
+            .format = daxa::Format::R16G16B16A16_SFLOAT,
             .aspect = daxa::ImageAspectFlagBits::COLOR,
             .size = { sx, sy, 1 },
             .mip_level_count = 1,
             .array_layer_count = 1,
             .sample_count = 1,
-            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
+            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY | daxa::ImageUsageFlagBits::SHADER_READ_WRITE,
             .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
         });
 
+        // srgb so the albedo keeps its precision in the darks, composition reads it back linear through the sampler
         this->albedo_image = this->context.device.create_image({
             .dimensions = 2,
-            .format = this->context.swapchain.get_format(),
+            .format = daxa::Format::R8G8B8A8_SRGB,
             .aspect = daxa::ImageAspectFlagBits::COLOR,
             .size = { sx, sy, 1 },
             .mip_level_count = 1,
@@ -31,21 +33,10 @@ namespace dare {
             .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
         });
 
+        // octahedral normal
         this->normal_image = this->context.device.create_image({
             .dimensions = 2,
-            .format = daxa::Format::R16G16B16A16_SFLOAT,
-            .aspect = daxa::ImageAspectFlagBits::COLOR,
-            .size = { sx, sy, 1 },
-            .mip_level_count = 1,
-            .array_layer_count = 1,
-            .sample_count = 1,
-            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
-            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
-        });
-
-        this->position_image = this->context.device.create_image({
-            .dimensions = 2,
-            .format = daxa::Format::R16G16B16A16_SFLOAT,
+            .format = daxa::Format::R16G16_SFLOAT,
             .aspect = daxa::ImageAspectFlagBits::COLOR,
             .size = { sx, sy, 1 },
             .mip_level_count = 1,
@@ -63,10 +54,25 @@ namespace dare {
             .mip_level_count = 1,
             .array_layer_count = 1,
             .sample_count = 1,
-            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT,
+            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
             .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
         });
 
+        // sampling a combined depth stencil image needs a view of the depth aspect alone
+        this->depth_view = this->context.device.create_image_view({
+            .type = daxa::ImageViewType::REGULAR_2D,
+            .format = daxa::Format::D24_UNORM_S8_UINT,
+            .image = this->depth_image,
+            .slice = {
+                .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                .base_mip_level = 0,
+                .level_count = 1,
+                .base_array_layer = 0,
+                .layer_count = 1
+            },
+            .debug_name = APPNAME_PREFIX("g_buffer_depth_view"),
+        });
+
         /*this->ssao_image = this->context.device.create_image({
             .dimensions = 2,
             .format = daxa::Format::R8_UNORM,
@@ -110,14 +116,30 @@ namespace dare {
 
         //this->ssao_data = SSAO::generate(this->context.device);
 
-        rebuild_pipeline();
+        this->light_clustering = std::make_unique<LightClustering>(context);
+        this->gpu_driven = std::make_unique<GPUDriven>(context);
+        this->depth_pyramid = std::make_unique<DepthPyramid>(context);
+        this->depth_pyramid->resize(this->depth_image, sx, sy);
+        this->depth_prepass = std::make_unique<DepthPrepass>(context, daxa::Format::D24_UNORM_S8_UINT);
+        this->gpu_timer = std::make_unique<GPUTimer>(this->context.device, TIMER_COUNT);
+
+        // the first permutation is needed right away, every later one is built in the background
+        this->pipeline_builder = std::make_unique<PipelineBuilder<Settings, Pipelines>>([this](const Settings& settings) { return this->build_pipelines(settings); });
+        this->pipelines = this->pipeline_builder->build_now(this->settings);
+        this->depth_prepass->depth_prepass_pipeline = this->pipelines.depth_prepass;
+        this->depth_prepass->alpha_masked_pipelines = this->pipelines.depth_prepass_alpha_masked;
+        this->active_settings = this->settings;
+        this->has_rebuild_pipeline = false;
+#ifdef DARE_WARM_PIPELINES
+        this->pipeline_builder->warm_up(this->common_permutations());
+#endif
     }
 
     BasicDeffered::~BasicDeffered() {
         this->context.device.destroy_image(color_image);
         this->context.device.destroy_image(albedo_image);
         this->context.device.destroy_image(normal_image);
-        this->context.device.destroy_image(position_image);
+        this->context.device.destroy_image_view(depth_view);
         this->context.device.destroy_image(depth_image);
         /*this->context.device.destroy_image(ssao_image);
         this->context.device.destroy_image(ssao_blur_image);*/
@@ -126,11 +148,24 @@ namespace dare {
         //SSAO::cleanup(this->context.device, this->ssao_data);
     }
 
-    void BasicDeffered::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer) {
+    void BasicDeffered::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) {
+        // the compute path only implements lighting, attachment visualization always goes through the raster pass
+        bool tiled_composition = this->active_settings.composition.tiled_compute && this->active_settings.visualize_attachments.none;
+        bool light_volumes = this->active_settings.composition.light_volumes && this->active_settings.visualize_attachments.none;
+
+        this->gpu_timer->reset(cmd_list);
+
+        bool occlusion_culling = this->active_settings.draw_submission.gpu_driven && this->gpu_driven->occlusion_culling;
+
+        if(this->active_settings.draw_submission.gpu_driven) {
+            this->gpu_driven->update(cmd_list, scene);
+            this->gpu_driven->cull(cmd_list, camera_buffer, occlusion_culling ? GPU_CULLING_PHASE_EARLY : GPU_CULLING_PHASE_ALL);
+        }
+
         cmd_list.pipeline_barrier_image_transition({
-            .waiting_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
+            .waiting_pipeline_access = tiled_composition ? daxa::AccessConsts::COMPUTE_SHADER_WRITE : daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
             .before_layout = daxa::ImageLayout::UNDEFINED,
-            .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+            .after_layout = tiled_composition ? daxa::ImageLayout::GENERAL : daxa::ImageLayout::ATTACHMENT_OPTIMAL,
             .image_id = this->color_image,
         });
 
@@ -148,13 +183,6 @@ namespace dare {
             .image_id = this->normal_image,
         });
 
-        cmd_list.pipeline_barrier_image_transition({
-            .waiting_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
-            .before_layout = daxa::ImageLayout::UNDEFINED,
-            .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
-            .image_id = this->position_image,
-        });
-
         cmd_list.pipeline_barrier_image_transition({
             .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
             .before_layout = daxa::ImageLayout::UNDEFINED,
@@ -163,54 +191,149 @@ namespace dare {
             .image_id = this->depth_image,
         });
 
-        // G-buffer gather
+        DrawPush push_constant;
+        push_constant.camera_buffer = camera_buffer;
+        push_constant.lights_buffer = scene->lights_buffer->buffer_address;
+        push_constant.clusters_buffer = this->light_clustering->clusters_buffer_address;
+
+        // cpu submitted draws are recorded in chunks on the recording threads, pass records the renderpass around
+        // each chunk into that chunk's command list, the gpu driven phases are all drawn into cmd_list and
+        // bind_pipeline switches between the material buckets of cpu submission
+        auto record_pass = [&](const std::vector<u32>& phases, const ParallelRecorder::PassFunction& pass, const ParallelRecorder::BindFunction& bind_pipeline = nullptr) {
+            if(this->active_settings.draw_submission.gpu_driven) {
+                pass(cmd_list, 0, [&]() {
+                    for(u32 phase : phases) {
+                        this->gpu_driven->draw(cmd_list, push_constant, phase);
+                    }
+                });
+            } else {
+                this->context.parallel_recorder->record(cmd_list, draw_list, push_constant, pass, bind_pipeline);
+            }
+        };
+
+        auto gather = [&](daxa::AttachmentLoadOp load_op, daxa::AttachmentLoadOp depth_load_op, const std::vector<u32>& phases) {
+            record_pass(phases, [&](daxa::CommandList& pass_list, u32 chunk, const std::function<void()>& draw) {
+                pass_list.begin_renderpass({
+                    .color_attachments = {
+                        {
+                            .image_view = this->albedo_image.default_view(),
+                            .load_op = chunk == 0 ? load_op : daxa::AttachmentLoadOp::LOAD,
+                            .clear_value = std::array<f32, 4>{0.0f, 0.0f, 0.0f, 1.0f},
+                        },
+                        {
+                            .image_view = this->normal_image.default_view(),
+                            .load_op = chunk == 0 ? load_op : daxa::AttachmentLoadOp::LOAD,
+                            .clear_value = std::array<f32, 4>{0.0f, 0.0f, 0.0f, 1.0f},
+                        },
+                    },
+                    .depth_attachment = {{
+                        .image_view = this->depth_image.default_view(),
+                        .load_op = chunk == 0 ? depth_load_op : daxa::AttachmentLoadOp::LOAD,
+                        .clear_value = daxa::DepthValue{1.0f, 0},
+                    }},
+                    .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
+                });
+
+                pass_list.set_pipeline(this->pipelines.g_buffer_gather);
+                draw();
+
+                pass_list.end_renderpass();
+            }, [&](daxa::CommandList& pass_list, u32 bucket) {
+                pass_list.set_pipeline(this->pipelines.g_buffer_gather_buckets[bucket]);
+            });
+        };
 
-        cmd_list.begin_renderpass({
-            .color_attachments = {
-                {
-                    .image_view = this->albedo_image.default_view(),
-                    .load_op = daxa::AttachmentLoadOp::CLEAR,
-                    .clear_value = std::array<f32, 4>{0.0f, 0.0f, 0.0f, 1.0f},
-                },
-                {
-                    .image_view = this->normal_image.default_view(),
-                    .load_op = daxa::AttachmentLoadOp::CLEAR,
-                    .clear_value = std::array<f32, 4>{0.0f, 0.0f, 0.0f, 1.0f},
-                },
-                {
-                    .image_view = this->position_image.default_view(),
-                    .load_op = daxa::AttachmentLoadOp::CLEAR,
-                    .clear_value = std::array<f32, 4>{0.0f, 0.0f, 0.0f, 1.0f},
-                },
-            },
-            .depth_attachment = {{
-                .image_view = this->depth_image.default_view(),
-                .load_op = daxa::AttachmentLoadOp::CLEAR,
-                .clear_value = daxa::DepthValue{1.0f, 0},
-            }},
-            .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
-        });
+        auto prepass = [&](daxa::AttachmentLoadOp load_op, u32 phase) {
+            record_pass({ phase }, [&](daxa::CommandList& pass_list, u32 chunk, const std::function<void()>& draw) {
+                this->depth_prepass->render(pass_list, this->depth_image, static_cast<u32>(size.x), static_cast<u32>(size.y), chunk == 0 ? load_op : daxa::AttachmentLoadOp::LOAD, draw);
+            }, [&](daxa::CommandList& pass_list, u32 bucket) {
+                this->depth_prepass->bind_pipeline(pass_list, bucket);
+            });
+        };
+
+        // the depth of everything visible last frame occludes the rest, which is culled against it afterwards
+        auto cull_late_phase = [&]() {
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+                .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH | daxa::ImageAspectFlagBits::STENCIL},
+                .image_id = this->depth_image,
+            });
+
+            this->depth_pyramid->build(cmd_list);
+
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+                .waiting_pipeline_access = daxa::AccessConsts::EARLY_FRAGMENT_TESTS_READ_WRITE,
+                .before_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH | daxa::ImageAspectFlagBits::STENCIL},
+                .image_id = this->depth_image,
+            });
+
+            this->gpu_driven->cull(cmd_list, camera_buffer, GPU_CULLING_PHASE_LATE, this->depth_pyramid.get());
+        };
+
+        u32 first_phase = occlusion_culling ? GPU_CULLING_PHASE_EARLY : GPU_CULLING_PHASE_ALL;
+
+        // depth pre-pass, with occlusion culling both phases run here so the G-buffer is written in a single pass
+
+        this->gpu_timer->begin(cmd_list, DEPTH_PREPASS_TIMER);
+
+        if(this->active_settings.pre_pass.depth) {
+            prepass(daxa::AttachmentLoadOp::CLEAR, first_phase);
+            if(occlusion_culling) {
+                cull_late_phase();
+                prepass(daxa::AttachmentLoadOp::LOAD, GPU_CULLING_PHASE_LATE);
+            }
+        }
 
-        cmd_list.set_pipeline(g_buffer_gather_pipeline);
+        this->gpu_timer->end(cmd_list, DEPTH_PREPASS_TIMER);
 
-        scene->iterate([&](Entity entity){
-            if(entity.has_component<ModelComponent>()) {
-                auto& model = entity.get_component<ModelComponent>().model;
+        // G-buffer gather
 
-                DrawPush push_constant;
-                push_constant.camera_buffer = camera_buffer;
-                push_constant.object_buffer = entity.get_component<TransformComponent>().object_info->buffer_address;
-                push_constant.lights_buffer = scene->lights_buffer->buffer_address;
+        this->gpu_timer->begin(cmd_list, G_BUFFER_TIMER);
 
-                model->bind_index_buffer(cmd_list);
-                model->draw(cmd_list, push_constant);
+        if(this->active_settings.pre_pass.depth) {
+            std::vector<u32> phases = { first_phase };
+            if(occlusion_culling) {
+                phases.push_back(GPU_CULLING_PHASE_LATE);
+            }
+            gather(daxa::AttachmentLoadOp::CLEAR, daxa::AttachmentLoadOp::LOAD, phases);
+        } else {
+            gather(daxa::AttachmentLoadOp::CLEAR, daxa::AttachmentLoadOp::CLEAR, { first_phase });
+            if(occlusion_culling) {
+                cull_late_phase();
+                gather(daxa::AttachmentLoadOp::LOAD, daxa::AttachmentLoadOp::LOAD, { GPU_CULLING_PHASE_LATE });
             }
+        }
+
+        for(auto image : { this->albedo_image, this->normal_image }) {
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::FRAGMENT_SHADER_READ | daxa::AccessConsts::COMPUTE_SHADER_READ,
+                .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .image_id = image,
+            });
+        }
+
+        // read only from here on, the light volumes still depth test against it
+        cmd_list.pipeline_barrier_image_transition({
+            .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::READ,
+            .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+            .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+            .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH | daxa::ImageAspectFlagBits::STENCIL},
+            .image_id = this->depth_image,
         });
 
-        cmd_list.end_renderpass();
+        this->gpu_timer->end(cmd_list, G_BUFFER_TIMER);
 
         // SSAO generation
-        /*if(this->settings.ambient_occlusion.ssao) {
+        /*if(this->active_settings.ambient_occlusion.ssao) {
             cmd_list.begin_renderpass({
                 .color_attachments = {
                     {
@@ -226,7 +349,7 @@ namespace dare {
 
             cmd_list.push_constant(SSAOGenerationPush {
                 .normal = { .image_view_id = normal_image.default_view(), .sampler_id = sampler },
-                .position = { .image_view_id = position_image.default_view(), .sampler_id = sampler },
+                .depth = { .image_view_id = depth_view, .sampler_id = sampler },
                 .ssao_noise = { .image_view_id = this->ssao_data.ssao_noise.default_view(), .sampler_id = sampler },
                 .camera_buffer = camera_buffer,
                 .ssao_kernel_buffer = this->context.device.get_device_address(this->ssao_data.ssao_kernel)
@@ -237,7 +360,7 @@ namespace dare {
         }
 
         // SSAO blur
-        if(this->settings.ambient_occlusion.ssao_blur) {
+        if(this->active_settings.ambient_occlusion.ssao_blur) {
             cmd_list.begin_renderpass({
                 .color_attachments = {
                     {
@@ -261,6 +384,41 @@ namespace dare {
 
         // Composition
 
+        this->gpu_timer->begin(cmd_list, COMPOSITION_TIMER);
+
+        if(tiled_composition) {
+            cmd_list.set_pipeline(this->pipelines.tiled_composition);
+            cmd_list.push_constant(TiledCompositionPush {
+                .albedo = { .image_view_id = albedo_image.default_view(), .sampler_id = sampler },
+                .normal = { .image_view_id = normal_image.default_view(), .sampler_id = sampler },
+                .depth = { .image_view_id = depth_view, .sampler_id = sampler },
+                .output_image = color_image.default_view(),
+                .screen_size = { static_cast<u32>(size.x), static_cast<u32>(size.y) },
+                .camera_buffer = camera_buffer,
+                .lights_buffer = scene->lights_buffer->buffer_address,
+            });
+            cmd_list.dispatch(
+                (static_cast<u32>(size.x) + TILED_COMPOSITION_TILE_SIZE - 1) / TILED_COMPOSITION_TILE_SIZE,
+                (static_cast<u32>(size.y) + TILED_COMPOSITION_TILE_SIZE - 1) / TILED_COMPOSITION_TILE_SIZE,
+                1
+            );
+
+            this->gpu_timer->end(cmd_list, COMPOSITION_TIMER);
+
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::READ,
+                .before_layout = daxa::ImageLayout::GENERAL,
+                .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .image_id = this->color_image,
+            });
+            return;
+        }
+
+        if(!light_volumes) {
+            this->light_clustering->cull_lights(cmd_list, scene, camera_buffer, this->size);
+        }
+
         cmd_list.begin_renderpass({
             .color_attachments = {
                 {
@@ -272,20 +430,65 @@ namespace dare {
             .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
         });
 
-        cmd_list.set_pipeline(composition_pipeline);
+        cmd_list.set_pipeline(this->pipelines.composition);
 
         cmd_list.push_constant(CompositionPush {
             .albedo = { .image_view_id = albedo_image.default_view(), .sampler_id = sampler },
             .normal = { .image_view_id = normal_image.default_view(), .sampler_id = sampler },
-            .position = { .image_view_id = position_image.default_view(), .sampler_id = sampler },
-            //.ssao = { .image_view_id = this->settings.ambient_occlusion.ssao_blur ? ssao_blur_image.default_view() : ssao_image.default_view(), .sampler_id = sampler },
+            .depth = { .image_view_id = depth_view, .sampler_id = sampler },
+            //.ssao = { .image_view_id = this->active_settings.ambient_occlusion.ssao_blur ? ssao_blur_image.default_view() : ssao_image.default_view(), .sampler_id = sampler },
             .camera_buffer = camera_buffer,
-            .lights_buffer = scene->lights_buffer->buffer_address
+            .lights_buffer = scene->lights_buffer->buffer_address,
+            .clusters_buffer = this->light_clustering->clusters_buffer_address,
         });
         cmd_list.draw({ .vertex_count = 3 });
 
         cmd_list.end_renderpass();
 
+        // local lights as additive volumes, the G-buffer depth rejects pixels that lie behind a volume's far side
+        if(light_volumes) {
+            cmd_list.begin_renderpass({
+                .color_attachments = {
+                    {
+                        .image_view = this->color_image.default_view(),
+                        .load_op = daxa::AttachmentLoadOp::LOAD,
+                    },
+                },
+                .depth_attachment = {{
+                    .image_view = this->depth_image.default_view(),
+                    .layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                    .load_op = daxa::AttachmentLoadOp::LOAD,
+                }},
+                .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
+            });
+
+            cmd_list.set_pipeline(this->pipelines.light_volumes);
+
+            LightVolumePush push_constant = {
+                .albedo = { .image_view_id = albedo_image.default_view(), .sampler_id = sampler },
+                .normal = { .image_view_id = normal_image.default_view(), .sampler_id = sampler },
+                .depth = { .image_view_id = depth_view, .sampler_id = sampler },
+                .camera_buffer = camera_buffer,
+                .lights_buffer = scene->lights_buffer->buffer_address,
+                .light_type = LIGHT_VOLUME_POINT,
+            };
+
+            if(scene->lights_info.num_point_lights > 0) {
+                cmd_list.push_constant(push_constant);
+                cmd_list.draw({ .vertex_count = LIGHT_VOLUME_SPHERE_VERTEX_COUNT, .instance_count = scene->lights_info.num_point_lights });
+            }
+
+            if(scene->lights_info.num_spot_lights > 0) {
+                push_constant.light_type = LIGHT_VOLUME_SPOT;
+                cmd_list.push_constant(push_constant);
+                cmd_list.draw({ .vertex_count = LIGHT_VOLUME_CONE_VERTEX_COUNT, .instance_count = scene->lights_info.num_spot_lights });
+            }
+
+            cmd_list.end_renderpass();
+        }
+
+        this->gpu_timer->end(cmd_list, COMPOSITION_TIMER);
+
         cmd_list.pipeline_barrier_image_transition({
             .waiting_pipeline_access = daxa::AccessConsts::READ,
             .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
@@ -297,31 +500,46 @@ namespace dare {
     void BasicDeffered::resize(u32 sx, u32 sy) {
         this->size = { static_cast<f32>(sx), static_cast<f32>(sy) };
 
+        this->context.device.destroy_image_view(this->depth_view);
         this->context.device.destroy_image(this->depth_image);
         this->depth_image = this->context.device.create_image({
             .format = daxa::Format::D24_UNORM_S8_UINT,
             .aspect = daxa::ImageAspectFlagBits::DEPTH | daxa::ImageAspectFlagBits::STENCIL,
             .size = { sx, sy, 1},
-            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT,
+            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
+        });
+        this->depth_view = this->context.device.create_image_view({
+            .type = daxa::ImageViewType::REGULAR_2D,
+            .format = daxa::Format::D24_UNORM_S8_UINT,
+            .image = this->depth_image,
+            .slice = {
+                .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                .base_mip_level = 0,
+                .level_count = 1,
+                .base_array_layer = 0,
+                .layer_count = 1
+            },
+            .debug_name = APPNAME_PREFIX("g_buffer_depth_view"),
         });
+        this->depth_pyramid->resize(this->depth_image, sx, sy);
 
         this->context.device.destroy_image(this->color_image);
         this->color_image = this->context.device.create_image({
             .dimensions = 2,
-            .format = this->context.swapchain.get_format(),
+            .format = daxa::Format::R16G16B16A16_SFLOAT,
             .aspect = daxa::ImageAspectFlagBits::COLOR,
             .size = { sx, sy, 1},
             .mip_level_count = 1,
             .array_layer_count = 1,
             .sample_count = 1,
-            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
+            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY | daxa::ImageUsageFlagBits::SHADER_READ_WRITE,
             .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
         });
 
         this->context.device.destroy_image(this->albedo_image);
         this->albedo_image = this->context.device.create_image({
             .dimensions = 2,
-            .format = this->context.swapchain.get_format(),
+            .format = daxa::Format::R8G8B8A8_SRGB,
             .aspect = daxa::ImageAspectFlagBits::COLOR,
             .size = { sx, sy, 1},
             .mip_level_count = 1,
@@ -334,20 +552,7 @@ namespace dare {
         this->context.device.destroy_image(this->normal_image);
         this->normal_image = this->context.device.create_image({
             .dimensions = 2,
-            .format = daxa::Format::R16G16B16A16_SFLOAT,
-            .aspect = daxa::ImageAspectFlagBits::COLOR,
-            .size = { sx, sy, 1},
-            .mip_level_count = 1,
-            .array_layer_count = 1,
-            .sample_count = 1,
-            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
-            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
-        });
-
-        this->context.device.destroy_image(this->position_image);
-        this->position_image = this->context.device.create_image({
-            .dimensions = 2,
-            .format = daxa::Format::R16G16B16A16_SFLOAT,
+            .format = daxa::Format::R16G16_SFLOAT,
             .aspect = daxa::ImageAspectFlagBits::COLOR,
             .size = { sx, sy, 1},
             .mip_level_count = 1,
@@ -489,6 +694,63 @@ namespace dare {
             ImGui::TreePop();
         }
 
+        if(ImGui::TreeNodeEx("Draw Submission")) {
+            if(ImGui::Checkbox("CPU", &this->settings.draw_submission.cpu)) {
+                this->settings.draw_submission.gpu_driven = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("GPU Driven", &this->settings.draw_submission.gpu_driven)) {
+                this->settings.draw_submission.cpu = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            ImGui::Checkbox("GPU Frustum Culling", &this->gpu_driven->frustum_culling);
+            ImGui::Checkbox("GPU Occlusion Culling", &this->gpu_driven->occlusion_culling);
+
+            ImGui::TreePop();
+        }
+
+        if(ImGui::TreeNodeEx("Pre-Pass")) {
+            if(ImGui::Checkbox("None", &this->settings.pre_pass.none)) {
+                this->settings.pre_pass.depth = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Depth", &this->settings.pre_pass.depth)) {
+                this->settings.pre_pass.none = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            ImGui::TreePop();
+        }
+
+        if(ImGui::TreeNodeEx("Composition")) {
+            if(ImGui::Checkbox("Full Screen Clustered", &this->settings.composition.full_screen)) {
+                this->settings.composition.tiled_compute = false;
+                this->settings.composition.light_volumes = false;
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Tiled Compute", &this->settings.composition.tiled_compute)) {
+                this->settings.composition.full_screen = false;
+                this->settings.composition.light_volumes = false;
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Light Volumes", &this->settings.composition.light_volumes)) {
+                this->settings.composition.full_screen = false;
+                this->settings.composition.tiled_compute = false;
+                this->has_rebuild_pipeline = true;
+            }
+
+            ImGui::TreePop();
+        }
+
         if(ImGui::TreeNodeEx("Visualize Attachments")) {
             if(ImGui::Checkbox("None", &this->settings.visualize_attachments.none)) {
                 this->settings.visualize_attachments.albedo = false;
@@ -577,94 +839,82 @@ namespace dare {
             ImGui::TreePop();
         }*/
 
+        ImGui::Separator();
+        ImGui::Text("Depth Pre-Pass: %.3f ms", this->gpu_timer->get_time_ms(DEPTH_PREPASS_TIMER));
+        ImGui::Text("G-Buffer: %.3f ms", this->gpu_timer->get_time_ms(G_BUFFER_TIMER));
+        ImGui::Text("Composition: %.3f ms", this->gpu_timer->get_time_ms(COMPOSITION_TIMER));
+        ImGui::Text("Overflowing Light Clusters: %u", this->light_clustering->get_overflow_count());
+        if(this->pipeline_builder->is_building()) {
+            ImGui::Text("Compiling pipelines, rendering with the previous settings");
+        }
+
         ImGui::End();
     }
 
     auto BasicDeffered::settings_to_string()-> std::string {
-        std::string string = {};
-
-        if(this->settings.texturing.none) {
-            string += "#define SETTINGS_TEXTURING_NONE\n";
-        }
-
-        if(this->settings.texturing.vertex_color) {
-            string += "#define SETTINGS_TEXTURING_VERTEX_COLOR\n";
-        }
-
-        if(this->settings.texturing.albedo) {
-            string += "#define SETTINGS_TEXTURING_ALBEDO\n";
-        }
-
-
-        if(this->settings.shading_model.none) {
-            string += "#define SETTINGS_SHADING_MODEL_NONE\n";
-        }
-
-        if(this->settings.shading_model.lambertian) {
-            string += "#define SETTINGS_SHADING_MODEL_LAMBERTIAN\n";
-        }
+        return settings_to_string(this->settings);
+    }
 
-        if(this->settings.shading_model.phong) {
-            string += "#define SETTINGS_SHADING_MODEL_PHONG\n";
-        }
+    auto BasicDeffered::settings_to_string(const Settings& settings) -> std::string {
+        std::string string = {};
 
-        if(this->settings.shading_model.blinn_phong) {
-            string += "#define SETTINGS_SHADING_MODEL_BLINN_PHONG\n";
+        if(settings.draw_submission.gpu_driven) {
+            string += "#define SETTINGS_GPU_DRIVEN\n";
         }
 
-        if(this->settings.shading_model.gaussian) {
-            string += "#define SETTINGS_SHADING_MODEL_GAUSSIAN\n";
+        if(settings.pre_pass.none) {
+            string += "#define SETTINGS_PRE_PASS_NONE\n";
         }
 
-        if(this->settings.normal_mappings.none) {
-            string += "#define SETTINGS_NORMAL_MAPPING_NONE\n";
+        if(settings.pre_pass.depth) {
+            string += "#define SETTINGS_PRE_PASS_DEPTH\n";
         }
 
-        if(this->settings.normal_mappings.using_tangents) {
-            string += "#define SETTINGS_NORMAL_MAPPING_USING_TANGENTS\n";
+        if(settings.composition.full_screen) {
+            string += "#define SETTINGS_COMPOSITION_FULL_SCREEN\n";
         }
 
-        if(this->settings.normal_mappings.calculating_TBN_vectors) {
-            string += "#define SETTINGS_NORMAL_MAPPING_CALCULATING_TBN_VECTORS\n";
+        if(settings.composition.tiled_compute) {
+            string += "#define SETTINGS_COMPOSITION_TILED_COMPUTE\n";
         }
 
-        if(this->settings.normal_mappings.reorthogonalize_TBN_vectors) {
-            string += "#define SETTINGS_NORMAL_MAPPING_REORTHOGONALIZE_TBN_VECTORS\n";
+        if(settings.composition.light_volumes) {
+            string += "#define SETTINGS_COMPOSITION_LIGHT_VOLUMES\n";
         }
 
-        if(this->settings.visualize_attachments.none) {
+        if(settings.visualize_attachments.none) {
             string += "#define SETTINGS_VISUALIZE_ATTACHMENT_NONE\n";
         }
 
-        if(this->settings.visualize_attachments.albedo) {
+        if(settings.visualize_attachments.albedo) {
             string += "#define SETTINGS_VISUALIZE_ATTACHMENT_ALBEDO\n";
         }
 
-        if(this->settings.visualize_attachments.normal) {
+        if(settings.visualize_attachments.normal) {
             string += "#define SETTINGS_VISUALIZE_ATTACHMENT_NORMAL\n";
         }
 
-        if(this->settings.visualize_attachments.position) {
+        if(settings.visualize_attachments.position) {
             string += "#define SETTINGS_VISUALIZE_ATTACHMENT_POSITION\n";
         }
 
-        if(this->settings.visualize_attachments.depth) {
+        if(settings.visualize_attachments.depth) {
             string += "#define SETTINGS_VISUALIZE_ATTACHMENT_DEPTH\n";
         }
 
-        if(this->settings.visualize_attachments.ao) {
+        if(settings.visualize_attachments.ao) {
             string += "#define SETTINGS_VISUALIZE_ATTACHMENT_AO\n";
         }
 
-        if(this->settings.ambient_occlusion.none) {
+        if(settings.ambient_occlusion.none) {
             string += "#define SETTINGS_AMBIENT_OCCLUSION_NONE\n";
         }
 
-        if(this->settings.ambient_occlusion.ssao) {
+        if(settings.ambient_occlusion.ssao) {
             string += "#define SETTINGS_AMBIENT_OCCLUSION_SSAO\n";
         }
 
-        if(this->settings.ambient_occlusion.ssao_blur) {
+        if(settings.ambient_occlusion.ssao_blur) {
             string += "#define SETTINGS_AMBIENT_OCCLUSION_SSAO_BLUR\n";
         }
 
@@ -673,8 +923,50 @@ namespace dare {
 
     void BasicDeffered::rebuild_pipeline() {
         if(this->has_rebuild_pipeline) {
-            std::string g_buffer_gather_code = this->settings_to_string() + file_to_string("./shaders/basic_deffered/g_buffer_gather.glsl");
-            this->g_buffer_gather_pipeline = this->context.pipeline_compiler.create_raster_pipeline({
+            this->pipeline_builder->request(this->settings);
+            this->has_rebuild_pipeline = false;
+        }
+
+        if(this->pipeline_builder->poll(this->pipelines, this->active_settings)) {
+            this->depth_prepass->depth_prepass_pipeline = this->pipelines.depth_prepass;
+            this->depth_prepass->alpha_masked_pipelines = this->pipelines.depth_prepass_alpha_masked;
+            std::cout << "pipeline reloaded" << std::endl;
+        }
+    }
+
+    auto BasicDeffered::common_permutations() const -> std::vector<Settings> {
+        std::vector<Settings> permutations;
+        for(u32 texturing = 0; texturing < 3; texturing++) {
+            for(u32 shading_model = 0; shading_model < 5; shading_model++) {
+                Settings permutation = this->settings;
+                permutation.texturing = {
+                    .none = texturing == 0,
+                    .vertex_color = texturing == 1,
+                    .albedo = texturing == 2,
+                };
+                permutation.shading_model = {
+                    .none = shading_model == 0,
+                    .lambertian = shading_model == 1,
+                    .phong = shading_model == 2,
+                    .blinn_phong = shading_model == 3,
+                    .gaussian = shading_model == 4,
+                };
+                permutations.push_back(permutation);
+            }
+        }
+        return permutations;
+    }
+
+    auto BasicDeffered::build_pipelines(const Settings& settings) const -> Pipelines {
+        Pipelines pipelines;
+        std::string settings_string = settings_to_string(settings);
+        std::vector<ShaderCache::SpecializationConstant> specialization = settings_to_specialization(settings);
+
+        std::string g_buffer_gather_code = settings_string + file_to_string("./shaders/basic_deffered/g_buffer_gather.glsl");
+        auto create_g_buffer_gather_pipeline = [&](u32 material_features) {
+            std::vector<ShaderCache::SpecializationConstant> gather_specialization = specialization;
+            gather_specialization.push_back({ .id = SPECIALIZATION_MATERIAL_FEATURES, .value = material_features });
+            return this->context.shader_cache->create_raster_pipeline({
                 .vertex_shader_info = {
                     .source = daxa::ShaderCode{ g_buffer_gather_code }, 
                     .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
@@ -684,14 +976,15 @@ namespace dare {
                     .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
                 },
                 .color_attachments = {
-                    { .format = this->context.swapchain.get_format(), },
-                    { .format = daxa::Format::R16G16B16A16_SFLOAT },
-                    { .format = daxa::Format::R16G16B16A16_SFLOAT, }
+                    { .format = daxa::Format::R8G8B8A8_SRGB },
+                    { .format = daxa::Format::R16G16_SFLOAT },
                 },
+                // with the pre-pass the depth is final already, every G-buffer texel is written once
                 .depth_test = {
                     .depth_attachment_format = daxa::Format::D24_UNORM_S8_UINT,
                     .enable_depth_test = true,
-                    .enable_depth_write = true,
+                    .enable_depth_write = !settings.pre_pass.depth,
+                    .depth_test_compare_op = settings.pre_pass.depth ? daxa::CompareOp::EQUAL : daxa::CompareOp::LESS_OR_EQUAL,
                 },
                 .raster = {
                     .polygon_mode = daxa::PolygonMode::FILL,
@@ -699,76 +992,130 @@ namespace dare {
                 },
                 .push_constant_size = sizeof(DrawPush),
                 .debug_name = APPNAME_PREFIX("g_buffer_gather_pipeline"),
-            }).value();
+            }, gather_specialization).value();
+        };
 
-            std::string composition_code = this->settings_to_string() + file_to_string("./shaders/basic_deffered/composition.glsl");
-            this->composition_pipeline = this->context.pipeline_compiler.create_raster_pipeline({
-                .vertex_shader_info = {
-                    .source = daxa::ShaderCode{ composition_code }, 
-                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
-                },
-                .fragment_shader_info = {
-                    .source = daxa::ShaderCode{ composition_code }, 
-                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
-                },
-                .color_attachments = {
-                    {
-                        .format = this->context.swapchain.get_format(), 
-                    }
-                },
-                .raster = {
-                    .polygon_mode = daxa::PolygonMode::FILL,
-                },
-                .push_constant_size = sizeof(CompositionPush),
-                .debug_name = APPNAME_PREFIX("composition_pipeline"),
-            }).value();
+        pipelines.g_buffer_gather = create_g_buffer_gather_pipeline(MATERIAL_FEATURES_DYNAMIC);
+        if(!settings.draw_submission.gpu_driven) {
+            for(u32 bucket = 0; bucket < MATERIAL_BUCKET_COUNT; bucket++) {
+                pipelines.g_buffer_gather_buckets[bucket] = create_g_buffer_gather_pipeline(bucket);
+            }
+        }
 
-            /*std::string ssao_generation_code = this->settings_to_string() + file_to_string("./shaders/basic_deffered/ssao_generation.glsl");
-            this->ssao_generation_pipeline = this->context.pipeline_compiler.create_raster_pipeline({
-                .vertex_shader_info = {
-                    .source = daxa::ShaderCode{ ssao_generation_code }, 
-                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
-                },
-                .fragment_shader_info = {
-                    .source = daxa::ShaderCode{ ssao_generation_code }, 
-                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
-                },
-                .color_attachments = {
-                    {
-                        .format = daxa::Format::R8_UNORM, 
-                    }
-                },
-                .raster = {
-                    .polygon_mode = daxa::PolygonMode::FILL,
-                },
-                .push_constant_size = sizeof(SSAOGenerationPush),
-                .debug_name = APPNAME_PREFIX("ssao_generation_code"),
-            }).value();
+        std::string composition_code = settings_string + file_to_string("./shaders/basic_deffered/composition.glsl");
+        pipelines.composition = this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ composition_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ composition_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .color_attachments = {
+                {
+                    .format = daxa::Format::R16G16B16A16_SFLOAT, 
+                }
+            },
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+            },
+            .push_constant_size = sizeof(CompositionPush),
+            .debug_name = APPNAME_PREFIX("composition_pipeline"),
+        }, specialization).value();
+
+        std::string tiled_composition_code = settings_string + file_to_string("./shaders/basic_deffered/tiled_composition.glsl");
+        pipelines.tiled_composition = this->context.shader_cache->create_compute_pipeline({
+            .shader_info = { .source = daxa::ShaderCode{ tiled_composition_code } },
+            .push_constant_size = sizeof(TiledCompositionPush),
+            .debug_name = APPNAME_PREFIX("tiled_composition_pipeline"),
+        }, specialization).value();
+
+        std::string light_volumes_code = settings_string + file_to_string("./shaders/basic_deffered/light_volumes.glsl");
+        pipelines.light_volumes = this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ light_volumes_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ light_volumes_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .color_attachments = {
+                {
+                    .format = daxa::Format::R16G16B16A16_SFLOAT,
+                    .blend = {
+                        .blend_enable = true,
+                        .src_color_blend_factor = daxa::BlendFactor::ONE,
+                        .dst_color_blend_factor = daxa::BlendFactor::ONE,
+                        .src_alpha_blend_factor = daxa::BlendFactor::ZERO,
+                        .dst_alpha_blend_factor = daxa::BlendFactor::ONE,
+                    },
+                }
+            },
+            // only the far side of a volume passes where the scene lies in front of it, which also keeps working with the camera inside
+            .depth_test = {
+                .depth_attachment_format = daxa::Format::D24_UNORM_S8_UINT,
+                .enable_depth_test = true,
+                .enable_depth_write = false,
+                .depth_test_compare_op = daxa::CompareOp::GREATER_OR_EQUAL,
+            },
+            // meshes cull FRONT_BIT to drop their hidden side, culling the opposite keeps only the far side of a volume
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+                .face_culling = daxa::FaceCullFlagBits::BACK_BIT,
+            },
+            .push_constant_size = sizeof(LightVolumePush),
+            .debug_name = APPNAME_PREFIX("light_volumes_pipeline"),
+        }, specialization).value();
+
+        /*std::string ssao_generation_code = settings_string + file_to_string("./shaders/basic_deffered/ssao_generation.glsl");
+        this->ssao_generation_pipeline = this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ ssao_generation_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ ssao_generation_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .color_attachments = {
+                {
+                    .format = daxa::Format::R8_UNORM, 
+                }
+            },
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+            },
+            .push_constant_size = sizeof(SSAOGenerationPush),
+            .debug_name = APPNAME_PREFIX("ssao_generation_code"),
+        }).value();
+
+        std::string ssao_blur_code = settings_string + file_to_string("./shaders/basic_deffered/ssao_blur.glsl");
+        this->ssao_blur_pipeline = this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ ssao_blur_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ ssao_blur_code }, 
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .color_attachments = {
+                {
+                    .format = daxa::Format::R8_UNORM, 
+                }
+            },
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+            },
+            .push_constant_size = sizeof(SSAOBlurPush),
+            .debug_name = APPNAME_PREFIX("ssao_blur_pipeline"),
+        }).value();*/
 
-            std::string ssao_blur_code = this->settings_to_string() + file_to_string("./shaders/basic_deffered/ssao_blur.glsl");
-            this->ssao_blur_pipeline = this->context.pipeline_compiler.create_raster_pipeline({
-                .vertex_shader_info = {
-                    .source = daxa::ShaderCode{ ssao_blur_code }, 
-                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
-                },
-                .fragment_shader_info = {
-                    .source = daxa::ShaderCode{ ssao_blur_code }, 
-                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
-                },
-                .color_attachments = {
-                    {
-                        .format = daxa::Format::R8_UNORM, 
-                    }
-                },
-                .raster = {
-                    .polygon_mode = daxa::PolygonMode::FILL,
-                },
-                .push_constant_size = sizeof(SSAOBlurPush),
-                .debug_name = APPNAME_PREFIX("ssao_blur_pipeline"),
-            }).value();*/
+        pipelines.depth_prepass = this->depth_prepass->create_pipeline(settings_string);
+        pipelines.depth_prepass_alpha_masked = this->depth_prepass->create_alpha_masked_pipelines(settings_string);
 
-            this->has_rebuild_pipeline = false;
-            std::cout << "pipeline reloaded" << std::endl;
-        }
+        return pipelines;
     }
 }
\ No newline at end of file
@@ -1,9 +1,17 @@
 #pragma once
 
 #include "task.hpp"
+#include "light_clustering.hpp"
+#include "gpu_driven.hpp"
+#include "depth_pyramid.hpp"
+#include "depth_prepass.hpp"
+#include "gpu_timer.hpp"
+#include "pipeline_builder.hpp"
 
 #include "generate_ssao.hpp"
 
+#include <array>
+
 namespace dare {
     struct BasicDeffered : public Task {
         struct Settings {
@@ -28,12 +36,28 @@ namespace dare {
                 bool reorthogonalize_TBN_vectors  = false;
             } normal_mappings;
 
+            struct DrawSubmission {
+                bool cpu = true;
+                bool gpu_driven = false;
+            } draw_submission;
+
+            struct PrePass {
+                bool none = true;
+                bool depth = false;
+            } pre_pass;
+
             struct AmbientOcclussion {
                 bool none = true;
                 bool ssao = false;
                 bool ssao_blur = false;
             } ambient_occlusion;
 
+            struct Composition {
+                bool full_screen = true;
+                bool tiled_compute = false;
+                bool light_volumes = false;
+            } composition;
+
             struct VisualizeAttachments {
                 bool none = true;
                 bool albedo = false;
@@ -44,15 +68,33 @@ namespace dare {
             } visualize_attachments;
         } settings;
 
+        struct Pipelines {
+            // reads the material features at runtime, draws gpu driven submission where every bucket is mixed
+            daxa::RasterPipeline g_buffer_gather;
+            // cpu submission binds the pipeline of each draw's material bucket, only built for it
+            std::array<daxa::RasterPipeline, MATERIAL_BUCKET_COUNT> g_buffer_gather_buckets;
+            daxa::RasterPipeline composition;
+            daxa::ComputePipeline tiled_composition;
+            daxa::RasterPipeline light_volumes;
+            daxa::RasterPipeline depth_prepass;
+            std::array<daxa::RasterPipeline, DepthPrepass::ALPHA_MASKED_VARIANTS> depth_prepass_alpha_masked;
+        };
+
         BasicDeffered(RenderContext& context);
         virtual ~BasicDeffered() override;
 
-        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer) override;
+        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) override;
         virtual void resize(u32 sx, u32 sy) override;
 
         virtual void render_settings_ui() override;
         virtual auto settings_to_string()-> std::string override;
+        static auto settings_to_string(const Settings& settings) -> std::string;
+        // starts a background build once the settings changed and swaps in a finished one
         virtual void rebuild_pipeline() override;
+        virtual auto uses_draw_list() -> bool override { return !this->active_settings.draw_submission.gpu_driven; }
+        auto build_pipelines(const Settings& settings) const -> Pipelines;
+        // every texturing and shading model combination on top of the current settings
+        auto common_permutations() const -> std::vector<Settings>;
 
         virtual auto get_color_image() -> daxa::ImageId override { return this->color_image; }
         virtual auto get_depth_image() -> daxa::ImageId override { return this->depth_image; }
@@ -62,19 +104,35 @@ namespace dare {
         daxa::ImageId color_image;
         daxa::ImageId albedo_image;
         daxa::ImageId normal_image;
-        daxa::ImageId position_image;
         daxa::ImageId depth_image;
+        // positions are rebuilt from depth, sampling needs a view of the depth aspect alone
+        daxa::ImageViewId depth_view;
 
         //daxa::ImageId ssao_image;
         //daxa::ImageId ssao_blur_image;
 
         daxa::SamplerId sampler;
 
-        daxa::RasterPipeline g_buffer_gather_pipeline;
-        daxa::RasterPipeline composition_pipeline;
+        Pipelines pipelines;
+        // what the pipelines were built with, render follows these while settings may hold a permutation still compiling
+        Settings active_settings;
 
         /*daxa::RasterPipeline ssao_generation_pipeline;
         daxa::RasterPipeline ssao_blur_pipeline;*/
+        std::unique_ptr<LightClustering> light_clustering;
+        std::unique_ptr<GPUDriven> gpu_driven;
+        std::unique_ptr<DepthPyramid> depth_pyramid;
+        std::unique_ptr<DepthPrepass> depth_prepass;
+
+        enum Timers : u32 {
+            DEPTH_PREPASS_TIMER = 0,
+            G_BUFFER_TIMER,
+            COMPOSITION_TIMER,
+            TIMER_COUNT
+        };
+        std::unique_ptr<GPUTimer> gpu_timer;
+
         bool has_rebuild_pipeline = true;        
+        std::unique_ptr<PipelineBuilder<Settings, Pipelines>> pipeline_builder;
     };
 }
\ No newline at end of file
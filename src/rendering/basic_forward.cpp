@@ -31,7 +31,21 @@ namespace dare {
             .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
         });
 
-        rebuild_pipeline();
+        this->light_clustering = std::make_unique<LightClustering>(context);
+        this->gpu_driven = std::make_unique<GPUDriven>(context);
+        this->depth_prepass = std::make_unique<DepthPrepass>(context, daxa::Format::D24_UNORM_S8_UINT);
+        this->gpu_timer = std::make_unique<GPUTimer>(this->context.device, TIMER_COUNT);
+
+        // the first permutation is needed right away, every later one is built in the background
+        this->pipeline_builder = std::make_unique<PipelineBuilder<Settings, Pipelines>>([this](const Settings& settings) { return this->build_pipelines(settings); });
+        this->pipelines = this->pipeline_builder->build_now(this->settings);
+        this->depth_prepass->depth_prepass_pipeline = this->pipelines.depth_prepass;
+        this->depth_prepass->alpha_masked_pipelines = this->pipelines.depth_prepass_alpha_masked;
+        this->active_settings = this->settings;
+        this->has_rebuild_pipeline = false;
+#ifdef DARE_WARM_PIPELINES
+        this->pipeline_builder->warm_up(this->common_permutations());
+#endif
     }
 
     BasicForward::~BasicForward() {
@@ -39,7 +53,16 @@ namespace dare {
         this->context.device.destroy_image(depth_image);
     }
 
-    void BasicForward::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer) {
+    void BasicForward::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) {
+        this->gpu_timer->reset(cmd_list);
+
+        this->light_clustering->cull_lights(cmd_list, scene, camera_buffer, this->size);
+
+        if(this->active_settings.draw_submission.gpu_driven) {
+            this->gpu_driven->update(cmd_list, scene);
+            this->gpu_driven->cull(cmd_list, camera_buffer);
+        }
+
         cmd_list.pipeline_barrier_image_transition({
             .waiting_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
             .before_layout = daxa::ImageLayout::UNDEFINED,
@@ -55,46 +78,66 @@ namespace dare {
             .image_id = this->depth_image,
         });
 
-        cmd_list.begin_renderpass({
-            .color_attachments = {{
-                .image_view = this->color_image.default_view(),
-                .load_op = daxa::AttachmentLoadOp::CLEAR,
-                .clear_value = std::array<f32, 4>{0.2f, 0.4f, 1.0f, 1.0f},
-            }},
-            .depth_attachment = {{
-                .image_view = this->depth_image.default_view(),
-                .load_op = daxa::AttachmentLoadOp::CLEAR,
-                .clear_value = daxa::DepthValue{1.0f, 0},
-            }},
-            .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
-        });
-
-        /*cmd_list.set_viewport({
-            .x = 0.0f,
-            .y = size.y,
-            .width = size.x,
-            .height = -size.y,
-            .min_depth = 0.0f,
-            .max_depth = 1.0f 
-        });*/
-
-        cmd_list.set_pipeline(draw_pipeline);
-
-        scene->iterate([&](Entity entity){
-            if(entity.has_component<ModelComponent>()) {
-                auto& model = entity.get_component<ModelComponent>().model;
-
-                DrawPush push_constant;
-                push_constant.camera_buffer = camera_buffer;
-                push_constant.object_buffer = entity.get_component<TransformComponent>().object_info->buffer_address;
-                push_constant.lights_buffer = scene->lights_buffer->buffer_address;
-
-                model->bind_index_buffer(cmd_list);
-                model->draw(cmd_list, push_constant);
+        DrawPush push_constant;
+        push_constant.camera_buffer = camera_buffer;
+        push_constant.lights_buffer = scene->lights_buffer->buffer_address;
+        push_constant.clusters_buffer = this->light_clustering->clusters_buffer_address;
+
+        // cpu submitted draws are recorded in chunks on the recording threads, pass records the renderpass around
+        // each chunk into that chunk's command list, bind_pipeline switches between the material buckets
+        auto record_pass = [&](const ParallelRecorder::PassFunction& pass, const ParallelRecorder::BindFunction& bind_pipeline = nullptr) {
+            if(this->active_settings.draw_submission.gpu_driven) {
+                pass(cmd_list, 0, [&]() { this->gpu_driven->draw(cmd_list, push_constant); });
+            } else {
+                this->context.parallel_recorder->record(cmd_list, draw_list, push_constant, pass, bind_pipeline);
             }
+        };
+
+        this->gpu_timer->begin(cmd_list, DEPTH_PREPASS_TIMER);
+        if(this->active_settings.pre_pass.depth) {
+            record_pass([&](daxa::CommandList& pass_list, u32 chunk, const std::function<void()>& draw) {
+                this->depth_prepass->render(pass_list, this->depth_image, static_cast<u32>(size.x), static_cast<u32>(size.y), chunk == 0 ? daxa::AttachmentLoadOp::CLEAR : daxa::AttachmentLoadOp::LOAD, draw);
+            }, [&](daxa::CommandList& pass_list, u32 bucket) {
+                this->depth_prepass->bind_pipeline(pass_list, bucket);
+            });
+        }
+        this->gpu_timer->end(cmd_list, DEPTH_PREPASS_TIMER);
+
+        this->gpu_timer->begin(cmd_list, SHADING_TIMER);
+
+        record_pass([&](daxa::CommandList& pass_list, u32 chunk, const std::function<void()>& draw) {
+            pass_list.begin_renderpass({
+                .color_attachments = {{
+                    .image_view = this->color_image.default_view(),
+                    .load_op = chunk == 0 ? daxa::AttachmentLoadOp::CLEAR : daxa::AttachmentLoadOp::LOAD,
+                    .clear_value = std::array<f32, 4>{0.2f, 0.4f, 1.0f, 1.0f},
+                }},
+                .depth_attachment = {{
+                    .image_view = this->depth_image.default_view(),
+                    .load_op = this->active_settings.pre_pass.depth || chunk != 0 ? daxa::AttachmentLoadOp::LOAD : daxa::AttachmentLoadOp::CLEAR,
+                    .clear_value = daxa::DepthValue{1.0f, 0},
+                }},
+                .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
+            });
+
+            /*pass_list.set_viewport({
+                .x = 0.0f,
+                .y = size.y,
+                .width = size.x,
+                .height = -size.y,
+                .min_depth = 0.0f,
+                .max_depth = 1.0f 
+            });*/
+
+            pass_list.set_pipeline(this->pipelines.draw);
+            draw();
+
+            pass_list.end_renderpass();
+        }, [&](daxa::CommandList& pass_list, u32 bucket) {
+            pass_list.set_pipeline(this->pipelines.draw_buckets[bucket]);
         });
 
-        cmd_list.end_renderpass();
+        this->gpu_timer->end(cmd_list, SHADING_TIMER);
 
         cmd_list.pipeline_barrier_image_transition({
             .waiting_pipeline_access = daxa::AccessConsts::READ,
@@ -234,59 +277,68 @@ namespace dare {
             ImGui::TreePop();
         }
 
-        ImGui::End();
-    }
+        if(ImGui::TreeNodeEx("Draw Submission")) {
+            if(ImGui::Checkbox("CPU", &this->settings.draw_submission.cpu)) {
+                this->settings.draw_submission.gpu_driven = false;
 
-    auto BasicForward::settings_to_string()-> std::string {
-        std::string string = {};
+                this->has_rebuild_pipeline = true;
+            }
 
-        if(this->settings.texturing.none) {
-            string += "#define SETTINGS_TEXTURING_NONE\n";
-        }
+            if(ImGui::Checkbox("GPU Driven", &this->settings.draw_submission.gpu_driven)) {
+                this->settings.draw_submission.cpu = false;
 
-        if(this->settings.texturing.vertex_color) {
-            string += "#define SETTINGS_TEXTURING_VERTEX_COLOR\n";
-        }
+                this->has_rebuild_pipeline = true;
+            }
 
-        if(this->settings.texturing.albedo) {
-            string += "#define SETTINGS_TEXTURING_ALBEDO\n";
+            ImGui::Checkbox("GPU Frustum Culling", &this->gpu_driven->frustum_culling);
+
+            ImGui::TreePop();
         }
 
+        if(ImGui::TreeNodeEx("Pre-Pass")) {
+            if(ImGui::Checkbox("None", &this->settings.pre_pass.none)) {
+                this->settings.pre_pass.depth = false;
 
-        if(this->settings.shading_model.none) {
-            string += "#define SETTINGS_SHADING_MODEL_NONE\n";
-        }
+                this->has_rebuild_pipeline = true;
+            }
 
-        if(this->settings.shading_model.lambertian) {
-            string += "#define SETTINGS_SHADING_MODEL_LAMBERTIAN\n";
-        }
+            if(ImGui::Checkbox("Depth", &this->settings.pre_pass.depth)) {
+                this->settings.pre_pass.none = false;
 
-        if(this->settings.shading_model.phong) {
-            string += "#define SETTINGS_SHADING_MODEL_PHONG\n";
-        }
+                this->has_rebuild_pipeline = true;
+            }
 
-        if(this->settings.shading_model.blinn_phong) {
-            string += "#define SETTINGS_SHADING_MODEL_BLINN_PHONG\n";
+            ImGui::TreePop();
         }
 
-        if(this->settings.shading_model.gaussian) {
-            string += "#define SETTINGS_SHADING_MODEL_GAUSSIAN\n";
+        ImGui::Separator();
+        ImGui::Text("Depth Pre-Pass: %.3f ms", this->gpu_timer->get_time_ms(DEPTH_PREPASS_TIMER));
+        ImGui::Text("Shading: %.3f ms", this->gpu_timer->get_time_ms(SHADING_TIMER));
+        ImGui::Text("Overflowing Light Clusters: %u", this->light_clustering->get_overflow_count());
+        if(this->pipeline_builder->is_building()) {
+            ImGui::Text("Compiling pipelines, rendering with the previous settings");
         }
 
-        if(this->settings.normal_mappings.none) {
-            string += "#define SETTINGS_NORMAL_MAPPING_NONE\n";
-        }
+        ImGui::End();
+    }
+
+    auto BasicForward::settings_to_string()-> std::string {
+        return settings_to_string(this->settings);
+    }
+
+    auto BasicForward::settings_to_string(const Settings& settings) -> std::string {
+        std::string string = {};
 
-        if(this->settings.normal_mappings.using_tangents) {
-            string += "#define SETTINGS_NORMAL_MAPPING_USING_TANGENTS\n";
+        if(settings.draw_submission.gpu_driven) {
+            string += "#define SETTINGS_GPU_DRIVEN\n";
         }
 
-        if(this->settings.normal_mappings.calculating_TBN_vectors) {
-            string += "#define SETTINGS_NORMAL_MAPPING_CALCULATING_TBN_VECTORS\n";
+        if(settings.pre_pass.none) {
+            string += "#define SETTINGS_PRE_PASS_NONE\n";
         }
 
-        if(this->settings.normal_mappings.reorthogonalize_TBN_vectors) {
-            string += "#define SETTINGS_NORMAL_MAPPING_REORTHOGONALIZE_TBN_VECTORS\n";
+        if(settings.pre_pass.depth) {
+            string += "#define SETTINGS_PRE_PASS_DEPTH\n";
         }
 
         return std::move(string);
@@ -294,8 +346,50 @@ namespace dare {
 
     void BasicForward::rebuild_pipeline() {
         if(this->has_rebuild_pipeline) {
-            std::string shader_code = this->settings_to_string() + file_to_string("./shaders/basic_forward/draw.glsl");
-            this->draw_pipeline = this->context.pipeline_compiler.create_raster_pipeline({
+            this->pipeline_builder->request(this->settings);
+            this->has_rebuild_pipeline = false;
+        }
+
+        if(this->pipeline_builder->poll(this->pipelines, this->active_settings)) {
+            this->depth_prepass->depth_prepass_pipeline = this->pipelines.depth_prepass;
+            this->depth_prepass->alpha_masked_pipelines = this->pipelines.depth_prepass_alpha_masked;
+            std::cout << "pipeline reloaded" << std::endl;
+        }
+    }
+
+    auto BasicForward::common_permutations() const -> std::vector<Settings> {
+        std::vector<Settings> permutations;
+        for(u32 texturing = 0; texturing < 3; texturing++) {
+            for(u32 shading_model = 0; shading_model < 5; shading_model++) {
+                Settings permutation = this->settings;
+                permutation.texturing = {
+                    .none = texturing == 0,
+                    .vertex_color = texturing == 1,
+                    .albedo = texturing == 2,
+                };
+                permutation.shading_model = {
+                    .none = shading_model == 0,
+                    .lambertian = shading_model == 1,
+                    .phong = shading_model == 2,
+                    .blinn_phong = shading_model == 3,
+                    .gaussian = shading_model == 4,
+                };
+                permutations.push_back(permutation);
+            }
+        }
+        return permutations;
+    }
+
+    auto BasicForward::build_pipelines(const Settings& settings) const -> Pipelines {
+        Pipelines pipelines;
+        std::string settings_string = settings_to_string(settings);
+        std::vector<ShaderCache::SpecializationConstant> specialization = settings_to_specialization(settings);
+
+        std::string shader_code = settings_string + file_to_string("./shaders/basic_forward/draw.glsl");
+        auto create_draw_pipeline = [&](u32 material_features) {
+            std::vector<ShaderCache::SpecializationConstant> draw_specialization = specialization;
+            draw_specialization.push_back({ .id = SPECIALIZATION_MATERIAL_FEATURES, .value = material_features });
+            return this->context.shader_cache->create_raster_pipeline({
                 .vertex_shader_info = {
                     .source = daxa::ShaderCode{ shader_code }, 
                     .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
@@ -305,10 +399,12 @@ namespace dare {
                     .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
                 },
                 .color_attachments = {{.format = this->context.swapchain.get_format(), .blend = {.blend_enable = true, .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA, .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA}}},
+                // with the pre-pass the depth is final already, only the closest surface is shaded
                 .depth_test = {
                     .depth_attachment_format = daxa::Format::D24_UNORM_S8_UINT,
                     .enable_depth_test = true,
-                    .enable_depth_write = true,
+                    .enable_depth_write = !settings.pre_pass.depth,
+                    .depth_test_compare_op = settings.pre_pass.depth ? daxa::CompareOp::EQUAL : daxa::CompareOp::LESS_OR_EQUAL,
                 },
                 .raster = {
                     .polygon_mode = daxa::PolygonMode::FILL,
@@ -316,10 +412,19 @@ namespace dare {
                 },
                 .push_constant_size = sizeof(DrawPush),
                 .debug_name = APPNAME_PREFIX("raster_pipeline"),
-            }).value();
+            }, draw_specialization).value();
+        };
 
-            this->has_rebuild_pipeline = false;
-            std::cout << "pipeline reloaded" << std::endl;
+        pipelines.draw = create_draw_pipeline(MATERIAL_FEATURES_DYNAMIC);
+        if(!settings.draw_submission.gpu_driven) {
+            for(u32 bucket = 0; bucket < MATERIAL_BUCKET_COUNT; bucket++) {
+                pipelines.draw_buckets[bucket] = create_draw_pipeline(bucket);
+            }
         }
+
+        pipelines.depth_prepass = this->depth_prepass->create_pipeline(settings_string);
+        pipelines.depth_prepass_alpha_masked = this->depth_prepass->create_alpha_masked_pipelines(settings_string);
+
+        return pipelines;
     }
 }
\ No newline at end of file
@@ -1,6 +1,13 @@
 #pragma once
 
 #include "task.hpp"
+#include "light_clustering.hpp"
+#include "gpu_driven.hpp"
+#include "depth_prepass.hpp"
+#include "gpu_timer.hpp"
+#include "pipeline_builder.hpp"
+
+#include <array>
 
 namespace dare {
     struct BasicForward: public Task {
@@ -25,17 +32,42 @@ namespace dare {
                 bool calculating_TBN_vectors = false;
                 bool reorthogonalize_TBN_vectors  = false;
             } normal_mappings;
+
+            struct DrawSubmission {
+                bool cpu = true;
+                bool gpu_driven = false;
+            } draw_submission;
+
+            struct PrePass {
+                bool none = true;
+                bool depth = false;
+            } pre_pass;
         } settings;
 
+        struct Pipelines {
+            // reads the material features at runtime, draws gpu driven submission where every bucket is mixed
+            daxa::RasterPipeline draw;
+            // cpu submission binds the pipeline of each draw's material bucket, only built for it
+            std::array<daxa::RasterPipeline, MATERIAL_BUCKET_COUNT> draw_buckets;
+            daxa::RasterPipeline depth_prepass;
+            std::array<daxa::RasterPipeline, DepthPrepass::ALPHA_MASKED_VARIANTS> depth_prepass_alpha_masked;
+        };
+
         BasicForward(RenderContext& context);
         virtual ~BasicForward() override;
 
-        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer) override;
+        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) override;
         virtual void resize(u32 sx, u32 sy) override;
 
         virtual void render_settings_ui() override;
         virtual auto settings_to_string()-> std::string override;
+        static auto settings_to_string(const Settings& settings) -> std::string;
+        // starts a background build once the settings changed and swaps in a finished one
         virtual void rebuild_pipeline() override;
+        virtual auto uses_draw_list() -> bool override { return !this->active_settings.draw_submission.gpu_driven; }
+        auto build_pipelines(const Settings& settings) const -> Pipelines;
+        // every texturing and shading model combination on top of the current settings
+        auto common_permutations() const -> std::vector<Settings>;
 
         virtual auto get_color_image() -> daxa::ImageId override { return this->color_image; }
         virtual auto get_depth_image() -> daxa::ImageId override { return this->depth_image; }
@@ -43,7 +75,21 @@ namespace dare {
         daxa::ImageId color_image;
         daxa::ImageId depth_image;
 
-        daxa::RasterPipeline draw_pipeline;
+        Pipelines pipelines;
+        // what the pipelines were built with, render follows these while settings may hold a permutation still compiling
+        Settings active_settings;
+        std::unique_ptr<LightClustering> light_clustering;
+        std::unique_ptr<GPUDriven> gpu_driven;
+        std::unique_ptr<DepthPrepass> depth_prepass;
+
+        enum Timers : u32 {
+            DEPTH_PREPASS_TIMER = 0,
+            SHADING_TIMER,
+            TIMER_COUNT
+        };
+        std::unique_ptr<GPUTimer> gpu_timer;
+
         bool has_rebuild_pipeline = true;
+        std::unique_ptr<PipelineBuilder<Settings, Pipelines>> pipeline_builder;
     };
 }
\ No newline at end of file
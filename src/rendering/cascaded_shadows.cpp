@@ -0,0 +1,550 @@
+#include "cascaded_shadows.hpp"
+
+#include "frustum_culling.hpp"
+#include "../data/entity.hpp"
+#include "../data/components.hpp"
+#include "../utils/utils.hpp"
+
+#include <imgui.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace dare {
+    // same box against planes test as the culling passes, boxes are given as min and max here
+    static auto aabb_intersects(const std::array<glm::vec4, 6>& planes, const glm::vec3& aabb_min, const glm::vec3& aabb_max) -> bool {
+        glm::vec3 center = (aabb_min + aabb_max) * 0.5f;
+        glm::vec3 extent = (aabb_max - aabb_min) * 0.5f;
+        for(auto& plane : planes) {
+            f32 distance = glm::dot(glm::vec3(plane), center) + plane.w;
+            f32 radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if(distance + radius < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    CascadedShadows::CascadedShadows(RenderContext& context, const std::shared_ptr<BufferPool>& buffer_pool) : context{context} {
+        this->sampler = this->context.device.create_sampler({
+            .magnification_filter = daxa::Filter::NEAREST,
+            .minification_filter = daxa::Filter::NEAREST,
+            .mipmap_filter = daxa::Filter::NEAREST,
+            .address_mode_u = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .address_mode_v = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .address_mode_w = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .mip_lod_bias = 0.0f,
+            .enable_anisotropy = false,
+            .max_anisotropy = 0.0f,
+            .enable_compare = false,
+            .compare_op = daxa::CompareOp::ALWAYS,
+            .min_lod = 0.0f,
+            .max_lod = 0.0f,
+            .enable_unnormalized_coordinates = false,
+        });
+
+        // the cache is only ever rendered to and copied from, the shadow image is what the shading passes sample
+        this->static_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::D32_SFLOAT,
+            .aspect = daxa::ImageAspectFlagBits::DEPTH,
+            .size = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 },
+            .mip_level_count = 1,
+            .array_layer_count = SHADOW_CASCADE_COUNT,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT | daxa::ImageUsageFlagBits::TRANSFER_SRC,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .debug_name = APPNAME_PREFIX("shadow_static_image"),
+        });
+
+        this->shadow_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::D32_SFLOAT,
+            .aspect = daxa::ImageAspectFlagBits::DEPTH,
+            .size = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 },
+            .mip_level_count = 1,
+            .array_layer_count = SHADOW_CASCADE_COUNT,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT | daxa::ImageUsageFlagBits::TRANSFER_DST | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .debug_name = APPNAME_PREFIX("shadow_image"),
+        });
+
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            this->static_layer_views[i] = this->context.device.create_image_view({
+                .type = daxa::ImageViewType::REGULAR_2D,
+                .format = daxa::Format::D32_SFLOAT,
+                .image = this->static_image,
+                .slice = {
+                    .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                    .base_mip_level = 0,
+                    .level_count = 1,
+                    .base_array_layer = i,
+                    .layer_count = 1
+                },
+                .debug_name = APPNAME_PREFIX("shadow_static_layer_view"),
+            });
+
+            this->shadow_layer_views[i] = this->context.device.create_image_view({
+                .type = daxa::ImageViewType::REGULAR_2D,
+                .format = daxa::Format::D32_SFLOAT,
+                .image = this->shadow_image,
+                .slice = {
+                    .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                    .base_mip_level = 0,
+                    .level_count = 1,
+                    .base_array_layer = i,
+                    .layer_count = 1
+                },
+                .debug_name = APPNAME_PREFIX("shadow_layer_view"),
+            });
+        }
+
+        this->shadow_array_view = this->context.device.create_image_view({
+            .type = daxa::ImageViewType::REGULAR_2D_ARRAY,
+            .format = daxa::Format::D32_SFLOAT,
+            .image = this->shadow_image,
+            .slice = {
+                .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                .base_mip_level = 0,
+                .level_count = 1,
+                .base_array_layer = 0,
+                .layer_count = SHADOW_CASCADE_COUNT
+            },
+            .debug_name = APPNAME_PREFIX("shadow_array_view"),
+        });
+
+        std::string shadow_map_code = file_to_string("./shaders/common/shadow_map.glsl");
+        this->shadow_pipeline = this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ shadow_map_code },
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ shadow_map_code },
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .depth_test = {
+                .depth_attachment_format = daxa::Format::D32_SFLOAT,
+                .enable_depth_test = true,
+                .enable_depth_write = true,
+            },
+            // casters are drawn double sided, open meshes would leak light otherwise
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+                .face_culling = daxa::FaceCullFlagBits::NONE,
+            },
+            .push_constant_size = sizeof(ShadowDrawPush),
+            .debug_name = APPNAME_PREFIX("shadow_pipeline"),
+        }).value();
+
+        this->shadow_buffer = std::make_unique<Buffer<ShadowInfo>>(buffer_pool);
+        this->gpu_timer = std::make_unique<GPUTimer>(this->context.device, TIMER_COUNT);
+    }
+
+    CascadedShadows::~CascadedShadows() {
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            this->context.device.destroy_image_view(this->static_layer_views[i]);
+            this->context.device.destroy_image_view(this->shadow_layer_views[i]);
+        }
+        this->context.device.destroy_image_view(this->shadow_array_view);
+        this->context.device.destroy_image(this->static_image);
+        this->context.device.destroy_image(this->shadow_image);
+        this->context.device.destroy_sampler(this->sampler);
+    }
+
+    void CascadedShadows::update_cascades(const Camera3D& camera, const glm::mat4& view, const glm::vec3& light_direction) {
+        f32 near_plane = camera.near_clip;
+        f32 far_plane = std::min(this->shadow_distance, camera.far_clip);
+        glm::mat4 inverse_view = glm::inverse(view);
+        f32 tan_half_fov = std::tan(glm::radians(camera.fov) * 0.5f);
+
+        // practical split scheme, logarithmic near the camera and uniform further out
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            f32 p = static_cast<f32>(i + 1) / static_cast<f32>(SHADOW_CASCADE_COUNT);
+            f32 log_split = near_plane * std::pow(far_plane / near_plane, p);
+            f32 uniform_split = near_plane + (far_plane - near_plane) * p;
+            this->splits[i] = this->split_lambda * log_split + (1.0f - this->split_lambda) * uniform_split;
+        }
+
+        // the light's orientation only depends on its direction, so moving the camera never rotates the cascades
+        glm::vec3 direction = glm::normalize(light_direction);
+        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 light_view = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+        f32 slice_near = near_plane;
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            f32 slice_far = this->splits[i];
+
+            std::array<glm::vec3, 8> corners;
+            glm::vec3 center = glm::vec3(0.0f);
+            for(u32 c = 0; c < 8; c++) {
+                f32 depth = (c & 4) ? slice_far : slice_near;
+                f32 x = ((c & 1) ? 1.0f : -1.0f) * depth * tan_half_fov * camera.aspect;
+                f32 y = ((c & 2) ? 1.0f : -1.0f) * depth * tan_half_fov;
+                corners[c] = glm::vec3(inverse_view * glm::vec4(x, y, -depth, 1.0f));
+                center += corners[c] * 0.125f;
+            }
+
+            // the sphere radius does not change with the camera's orientation, rounding it up keeps float
+            // noise from changing the matrix
+            f32 radius = 0.0f;
+            for(auto& corner : corners) {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // the grid cell is a whole number of texels of the projection, moving by a cell then shifts the
+            // rasterized texels exactly and the edges don't shimmer, the margin is never below the cell it has to
+            // cover and at least one texel once the snap fraction is tiny
+            f32 margin = std::max(radius * this->snap_fraction, 4.0f * radius / static_cast<f32>(SHADOW_MAP_SIZE));
+            f32 extent = radius + margin;
+            f32 texel = 2.0f * extent / static_cast<f32>(SHADOW_MAP_SIZE);
+            f32 cell = std::max(std::floor(margin / texel), 1.0f) * texel;
+            glm::vec3 light_center = glm::vec3(light_view * glm::vec4(center, 1.0f));
+            light_center = glm::floor(light_center / cell) * cell;
+
+            glm::mat4 projection = glm::orthoRH_ZO(
+                light_center.x - extent, light_center.x + extent,
+                light_center.y - extent, light_center.y + extent,
+                -light_center.z - extent - this->caster_distance, -light_center.z + extent
+            );
+
+            this->view_projections[i] = projection * light_view;
+            this->planes[i] = FrustumCulling::extract_planes(this->view_projections[i]);
+            this->texel_sizes[i] = texel;
+            if(this->view_projections[i] != this->cached_view_projections[i]) {
+                this->cache_dirty[i] = true;
+            }
+
+            slice_near = slice_far;
+        }
+    }
+
+    void CascadedShadows::invalidate(const glm::vec3& aabb_min, const glm::vec3& aabb_max) {
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            if(!this->cache_dirty[i] && aabb_intersects(this->planes[i], aabb_min, aabb_max)) {
+                this->cache_dirty[i] = true;
+            }
+        }
+    }
+
+    void CascadedShadows::update_casters(const std::shared_ptr<Scene>& scene) {
+        this->stats.static_casters = 0;
+        this->stats.dynamic_casters = 0;
+
+        scene->iterate([&](Entity entity) {
+            if(!entity.has_component<ModelComponent>()) {
+                return;
+            }
+
+            auto& model = entity.get_component<ModelComponent>().model;
+            auto& transform = entity.get_component<TransformComponent>();
+            auto [it, inserted] = this->casters.try_emplace(entity.get_handle());
+            Caster& caster = it->second;
+
+            // a caster leaving the cache has to be erased from where it was drawn, so the old bounds go first
+            if(transform.has_changed && caster.is_static) {
+                this->invalidate(caster.aabb_min, caster.aabb_max);
+                caster.is_static = false;
+            }
+
+            if(inserted || transform.has_changed) {
+                glm::vec3 local_min = glm::vec3(std::numeric_limits<f32>::max());
+                glm::vec3 local_max = glm::vec3(std::numeric_limits<f32>::lowest());
+                for(auto& primitive : model->primitives) {
+                    local_min = glm::min(local_min, primitive.aabb_min);
+                    local_max = glm::max(local_max, primitive.aabb_max);
+                }
+                if(model->primitives.empty()) {
+                    local_min = local_max = glm::vec3(0.0f);
+                }
+
+                glm::mat3 absolute = glm::mat3(transform.model_matrix);
+                for(u32 i = 0; i < 3; i++) {
+                    absolute[i] = glm::abs(absolute[i]);
+                }
+                glm::vec3 center = glm::vec3(transform.model_matrix * glm::vec4((local_min + local_max) * 0.5f, 1.0f));
+                glm::vec3 extent = absolute * ((local_max - local_min) * 0.5f);
+                caster.aabb_min = center - extent;
+                caster.aabb_max = center + extent;
+            }
+
+            // entities that show up already at rest go straight into the cache
+            if(transform.has_changed) {
+                caster.still_frames = 0;
+            } else if(inserted) {
+                caster.still_frames = this->settle_frames;
+            } else {
+                caster.still_frames = std::min(caster.still_frames + 1, this->settle_frames);
+            }
+
+            if(!caster.is_static && caster.still_frames >= this->settle_frames) {
+                caster.is_static = true;
+                this->invalidate(caster.aabb_min, caster.aabb_max);
+            }
+
+            caster.last_seen = this->frame_index;
+            if(caster.is_static) {
+                this->stats.static_casters++;
+            } else {
+                this->stats.dynamic_casters++;
+            }
+        });
+
+        // destroyed entities and removed models
+        std::erase_if(this->casters, [&](const auto& entry) {
+            if(entry.second.last_seen == this->frame_index) {
+                return false;
+            }
+            if(entry.second.is_static) {
+                this->invalidate(entry.second.aabb_min, entry.second.aabb_max);
+            }
+            return true;
+        });
+    }
+
+    void CascadedShadows::draw_casters(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, u32 cascade, const std::vector<entt::entity>& casters) {
+        ShadowDrawPush push_constant = {
+            .view_projection = *reinterpret_cast<const f32mat4x4*>(&this->view_projections[cascade]),
+        };
+
+        for(entt::entity handle : casters) {
+            Entity entity = { handle, scene.get() };
+            auto& model = entity.get_component<ModelComponent>().model;
+            push_constant.object_buffer = entity.get_component<TransformComponent>().object_info->buffer_address;
+            push_constant.position_buffer = model->position_buffer_address;
+            cmd_list.push_constant(push_constant);
+
+            for(auto& primitive : model->primitives) {
+                model->draw_primitive(cmd_list, primitive);
+            }
+        }
+    }
+
+    void CascadedShadows::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const Camera3D& camera, const glm::mat4& view) {
+        this->frame_index++;
+        this->stats.cascades_rebuilt = 0;
+        this->stats.cascades_composited = 0;
+        this->stats.static_draws = 0;
+        this->stats.dynamic_draws = 0;
+        this->gpu_timer->reset(cmd_list);
+
+        // only the first directional light is shadowed, in the same order the scene uploads its lights
+        glm::vec3 light_direction = glm::vec3(0.0f);
+        this->has_light = false;
+        scene->iterate([&](Entity entity) {
+            if(!this->has_light && entity.has_component<DirectionalLightComponent>()) {
+                light_direction = entity.get_component<TransformComponent>().get_world_direction(entity.get_component<DirectionalLightComponent>().direction);
+                this->has_light = true;
+            }
+        });
+
+        bool active = this->enabled && this->has_light && glm::length(light_direction) > 0.0f;
+        if(!active) {
+            this->was_enabled = false;
+            this->shadow_buffer->update(cmd_list, *this->context.staging_ring, ShadowInfo { .enabled = 0 });
+            return;
+        }
+
+        // nothing was tracked while shadows were off
+        if(!this->was_enabled) {
+            this->cache_dirty.fill(true);
+            this->had_dynamic.fill(true);
+            this->casters.clear();
+            this->was_enabled = true;
+        }
+
+        this->update_cascades(camera, view, light_direction);
+        this->update_casters(scene);
+
+        std::array<std::vector<entt::entity>, SHADOW_CASCADE_COUNT> static_casters;
+        std::array<std::vector<entt::entity>, SHADOW_CASCADE_COUNT> dynamic_casters;
+        bool any_static = false;
+        bool any_composite = false;
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            scene->bvh.query_frustum(this->planes[i], [&](entt::entity entity) {
+                auto it = this->casters.find(entity);
+                if(it == this->casters.end()) {
+                    return;
+                }
+                if(it->second.is_static) {
+                    if(this->cache_dirty[i]) {
+                        static_casters[i].push_back(entity);
+                    }
+                } else {
+                    dynamic_casters[i].push_back(entity);
+                }
+            });
+
+            any_static = any_static || this->cache_dirty[i];
+            any_composite = any_composite || this->cache_dirty[i] || !dynamic_casters[i].empty() || this->had_dynamic[i];
+        }
+
+        this->shadow_buffer->update(cmd_list, *this->context.staging_ring, ShadowInfo {
+            .cascade_view_projections = {
+                *reinterpret_cast<const f32mat4x4*>(&this->view_projections[0]),
+                *reinterpret_cast<const f32mat4x4*>(&this->view_projections[1]),
+                *reinterpret_cast<const f32mat4x4*>(&this->view_projections[2]),
+                *reinterpret_cast<const f32mat4x4*>(&this->view_projections[3]),
+            },
+            .cascade_splits = *reinterpret_cast<const f32vec4*>(&this->splits),
+            .cascade_texel_sizes = *reinterpret_cast<const f32vec4*>(&this->texel_sizes),
+            .shadow_map = { .image_view_id = this->shadow_array_view, .sampler_id = this->sampler },
+            .depth_bias = this->depth_bias,
+            .normal_bias = this->normal_bias,
+            .enabled = 1,
+        });
+
+        if(!any_composite) {
+            return;
+        }
+
+        this->gpu_timer->begin(cmd_list, SHADOW_TIMER);
+
+        // cached layers of cascades that moved or whose static casters changed
+        if(any_static) {
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
+                .waiting_pipeline_access = daxa::AccessConsts::EARLY_FRAGMENT_TESTS_READ_WRITE,
+                .before_layout = this->images_initialized ? daxa::ImageLayout::TRANSFER_SRC_OPTIMAL : daxa::ImageLayout::UNDEFINED,
+                .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH, .layer_count = SHADOW_CASCADE_COUNT},
+                .image_id = this->static_image,
+            });
+
+            for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+                if(!this->cache_dirty[i]) {
+                    continue;
+                }
+
+                cmd_list.begin_renderpass({
+                    .depth_attachment = {{
+                        .image_view = this->static_layer_views[i],
+                        .load_op = daxa::AttachmentLoadOp::CLEAR,
+                        .clear_value = daxa::DepthValue{1.0f, 0},
+                    }},
+                    .render_area = {.x = 0, .y = 0, .width = SHADOW_MAP_SIZE, .height = SHADOW_MAP_SIZE},
+                });
+                cmd_list.set_pipeline(this->shadow_pipeline);
+                scene->geometry_pool->bind_index_buffer(cmd_list);
+                this->draw_casters(cmd_list, scene, i, static_casters[i]);
+                cmd_list.end_renderpass();
+
+                this->stats.cascades_rebuilt++;
+                this->stats.static_draws += static_cast<u32>(static_casters[i].size());
+            }
+
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_READ,
+                .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .after_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+                .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH, .layer_count = SHADOW_CASCADE_COUNT},
+                .image_id = this->static_image,
+            });
+        }
+
+        // the sampled layers start as a copy of the cache, dynamic casters are drawn on top of that
+        cmd_list.pipeline_barrier_image_transition({
+            .awaited_pipeline_access = daxa::AccessConsts::READ,
+            .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .before_layout = this->images_initialized ? daxa::ImageLayout::READ_ONLY_OPTIMAL : daxa::ImageLayout::UNDEFINED,
+            .after_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH, .layer_count = SHADOW_CASCADE_COUNT},
+            .image_id = this->shadow_image,
+        });
+
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            if(!this->cache_dirty[i] && dynamic_casters[i].empty() && !this->had_dynamic[i]) {
+                continue;
+            }
+
+            cmd_list.copy_image_to_image({
+                .src_image = this->static_image,
+                .src_image_layout = daxa::ImageLayout::TRANSFER_SRC_OPTIMAL,
+                .dst_image = this->shadow_image,
+                .dst_image_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+                .src_slice = {
+                    .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                    .mip_level = 0,
+                    .base_array_layer = i,
+                    .layer_count = 1
+                },
+                .src_offset = { 0, 0, 0 },
+                .dst_slice = {
+                    .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                    .mip_level = 0,
+                    .base_array_layer = i,
+                    .layer_count = 1
+                },
+                .dst_offset = { 0, 0, 0 },
+                .extent = { SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 1 },
+            });
+
+            this->stats.cascades_composited++;
+        }
+
+        cmd_list.pipeline_barrier_image_transition({
+            .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::EARLY_FRAGMENT_TESTS_READ_WRITE,
+            .before_layout = daxa::ImageLayout::TRANSFER_DST_OPTIMAL,
+            .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+            .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH, .layer_count = SHADOW_CASCADE_COUNT},
+            .image_id = this->shadow_image,
+        });
+
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            if(dynamic_casters[i].empty()) {
+                continue;
+            }
+
+            cmd_list.begin_renderpass({
+                .depth_attachment = {{
+                    .image_view = this->shadow_layer_views[i],
+                    .load_op = daxa::AttachmentLoadOp::LOAD,
+                }},
+                .render_area = {.x = 0, .y = 0, .width = SHADOW_MAP_SIZE, .height = SHADOW_MAP_SIZE},
+            });
+            cmd_list.set_pipeline(this->shadow_pipeline);
+            scene->geometry_pool->bind_index_buffer(cmd_list);
+            this->draw_casters(cmd_list, scene, i, dynamic_casters[i]);
+            cmd_list.end_renderpass();
+
+            this->stats.dynamic_draws += static_cast<u32>(dynamic_casters[i].size());
+        }
+
+        cmd_list.pipeline_barrier_image_transition({
+            .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::READ,
+            .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+            .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+            .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH, .layer_count = SHADOW_CASCADE_COUNT},
+            .image_id = this->shadow_image,
+        });
+
+        this->gpu_timer->end(cmd_list, SHADOW_TIMER);
+
+        for(u32 i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            this->had_dynamic[i] = !dynamic_casters[i].empty();
+            this->cached_view_projections[i] = this->view_projections[i];
+            this->cache_dirty[i] = false;
+        }
+        this->images_initialized = true;
+    }
+
+    void CascadedShadows::render_settings_ui() {
+        if(ImGui::TreeNode("Shadows")) {
+            ImGui::Checkbox("Cascaded Shadow Maps", &this->enabled);
+            ImGui::SliderFloat("Shadow Distance", &this->shadow_distance, 4.0f, 256.0f);
+            ImGui::SliderFloat("Split Lambda", &this->split_lambda, 0.0f, 1.0f);
+            ImGui::SliderFloat("Depth Bias", &this->depth_bias, 0.0f, 0.01f, "%.5f");
+            ImGui::SliderFloat("Normal Bias", &this->normal_bias, 0.0f, 4.0f);
+            ImGui::Text("Casters: %u static, %u dynamic", this->stats.static_casters, this->stats.dynamic_casters);
+            ImGui::Text("Cascades: %u rebuilt, %u composited", this->stats.cascades_rebuilt, this->stats.cascades_composited);
+            ImGui::Text("Caster Draws: %u static, %u dynamic", this->stats.static_draws, this->stats.dynamic_draws);
+            ImGui::Text("Shadows: %.3f ms", this->gpu_timer->get_time_ms(SHADOW_TIMER));
+            ImGui::TreePop();
+        }
+    }
+}
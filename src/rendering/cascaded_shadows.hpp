@@ -0,0 +1,107 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <entt/entt.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+#include "gpu_timer.hpp"
+#include "../data/scene.hpp"
+#include "../graphics/camera.hpp"
+#include "../graphics/buffer.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+namespace dare {
+    // cascaded shadow maps for the first directional light of the scene
+    //
+    // every cascade keeps a cached depth layer with only the static casters in it, a caster counts as static once
+    // its transform has not changed for a few frames, a cached layer is only redrawn when its matrix changes or a
+    // static caster inside it appears, disappears or starts moving
+    //
+    // cascades are fit to bounding spheres of the view frustum slices and snapped to a coarse grid in light space,
+    // so their matrices stay the same while the camera moves inside a grid cell and the cache survives
+    //
+    // cascades with dynamic casters in them get the cached layer copied into the sampled map every frame and the
+    // dynamic casters drawn on top, everything else costs nothing on the gpu
+    struct CascadedShadows {
+        struct Stats {
+            u32 static_casters = 0;
+            u32 dynamic_casters = 0;
+            u32 cascades_rebuilt = 0;
+            u32 cascades_composited = 0;
+            u32 static_draws = 0;
+            u32 dynamic_draws = 0;
+        };
+
+        bool enabled = true;
+        f32 shadow_distance = 48.0f;
+        // blend between uniform and logarithmic split distances
+        f32 split_lambda = 0.75f;
+        // casters this far behind a cascade towards the light still throw shadows into it
+        f32 caster_distance = 64.0f;
+        // share of a cascade's radius its center is snapped to, rounded down to whole texels, bigger values keep the
+        // cache longer but waste resolution
+        f32 snap_fraction = 0.125f;
+        // frames a transform has to stay unchanged before its entity moves into the cache
+        u32 settle_frames = 8;
+        f32 depth_bias = 0.0005f;
+        f32 normal_bias = 1.5f;
+        Stats stats = {};
+
+        CascadedShadows(RenderContext& context, const std::shared_ptr<BufferPool>& buffer_pool);
+        ~CascadedShadows();
+
+        // records the cascade updates into cmd_list, the map is left in READ_ONLY_OPTIMAL for the shading passes
+        void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const Camera3D& camera, const glm::mat4& view);
+        void render_settings_ui();
+
+        std::unique_ptr<Buffer<ShadowInfo>> shadow_buffer;
+
+    private:
+        struct Caster {
+            glm::vec3 aabb_min;
+            glm::vec3 aabb_max;
+            u32 still_frames = 0;
+            bool is_static = false;
+            u64 last_seen = 0;
+        };
+
+        void update_cascades(const Camera3D& camera, const glm::mat4& view, const glm::vec3& light_direction);
+        void update_casters(const std::shared_ptr<Scene>& scene);
+        void invalidate(const glm::vec3& aabb_min, const glm::vec3& aabb_max);
+        void draw_casters(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, u32 cascade, const std::vector<entt::entity>& casters);
+
+        std::array<glm::mat4, SHADOW_CASCADE_COUNT> view_projections = {};
+        std::array<glm::mat4, SHADOW_CASCADE_COUNT> cached_view_projections = {};
+        std::array<std::array<glm::vec4, 6>, SHADOW_CASCADE_COUNT> planes = {};
+        std::array<bool, SHADOW_CASCADE_COUNT> cache_dirty = {};
+        std::array<bool, SHADOW_CASCADE_COUNT> had_dynamic = {};
+        glm::vec4 splits = glm::vec4(0.0f);
+        glm::vec4 texel_sizes = glm::vec4(0.0f);
+
+        std::unordered_map<entt::entity, Caster> casters;
+        u64 frame_index = 0;
+        bool was_enabled = false;
+        bool has_light = false;
+
+        daxa::ImageId static_image = {};
+        daxa::ImageId shadow_image = {};
+        std::array<daxa::ImageViewId, SHADOW_CASCADE_COUNT> static_layer_views = {};
+        std::array<daxa::ImageViewId, SHADOW_CASCADE_COUNT> shadow_layer_views = {};
+        daxa::ImageViewId shadow_array_view = {};
+        daxa::SamplerId sampler;
+        bool images_initialized = false;
+
+        enum Timers : u32 {
+            SHADOW_TIMER,
+            TIMER_COUNT
+        };
+
+        daxa::RasterPipeline shadow_pipeline;
+        std::unique_ptr<GPUTimer> gpu_timer;
+        RenderContext& context;
+    };
+}
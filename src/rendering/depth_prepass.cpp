@@ -0,0 +1,77 @@
+#include "depth_prepass.hpp"
+
+#include "../utils/utils.hpp"
+
+namespace dare {
+    DepthPrepass::DepthPrepass(RenderContext& context, daxa::Format depth_format) : depth_format{depth_format}, context{context} {
+        rebuild_pipeline("");
+    }
+
+    void DepthPrepass::rebuild_pipeline(const std::string& settings) {
+        this->depth_prepass_pipeline = this->create_pipeline(settings);
+        this->alpha_masked_pipelines = this->create_alpha_masked_pipelines(settings);
+    }
+
+    auto DepthPrepass::create_alpha_masked_pipelines(const std::string& settings) const -> std::array<daxa::RasterPipeline, ALPHA_MASKED_VARIANTS> {
+        return {
+            this->create_pipeline(settings, MATERIAL_FEATURE_ALPHA_MASK),
+            this->create_pipeline(settings, MATERIAL_FEATURE_ALPHA_MASK | MATERIAL_FEATURE_ALBEDO),
+        };
+    }
+
+    auto DepthPrepass::create_pipeline(const std::string& settings, u32 material_features) const -> daxa::RasterPipeline {
+        std::string depth_prepass_code = settings + file_to_string("./shaders/common/depth_prepass.glsl");
+        return this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ depth_prepass_code },
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ depth_prepass_code },
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .depth_test = {
+                .depth_attachment_format = this->depth_format,
+                .enable_depth_test = true,
+                .enable_depth_write = true,
+            },
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+                .face_culling = daxa::FaceCullFlagBits::FRONT_BIT,
+            },
+            .push_constant_size = sizeof(DrawPush),
+            .debug_name = material_features != 0 ? APPNAME_PREFIX("depth_prepass_alpha_masked_pipeline") : APPNAME_PREFIX("depth_prepass_pipeline"),
+        }, {
+            { .id = SPECIALIZATION_MATERIAL_FEATURES, .value = material_features },
+        }).value();
+    }
+
+    void DepthPrepass::render(daxa::CommandList& cmd_list, daxa::ImageId depth_image, u32 sx, u32 sy, daxa::AttachmentLoadOp load_op, const std::function<void()>& draw) {
+        cmd_list.begin_renderpass({
+            .depth_attachment = {{
+                .image_view = depth_image.default_view(),
+                .load_op = load_op,
+                .clear_value = daxa::DepthValue{1.0f, 0},
+            }},
+            .render_area = {.x = 0, .y = 0, .width = sx, .height = sy},
+        });
+
+        cmd_list.set_pipeline(this->depth_prepass_pipeline);
+        draw();
+
+        cmd_list.end_renderpass();
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::EARLY_FRAGMENT_TESTS_READ_WRITE,
+        });
+    }
+
+    void DepthPrepass::bind_pipeline(daxa::CommandList& cmd_list, u32 material_bucket) {
+        if((material_bucket & MATERIAL_FEATURE_ALPHA_MASK) == 0) {
+            cmd_list.set_pipeline(this->depth_prepass_pipeline);
+            return;
+        }
+        cmd_list.set_pipeline(this->alpha_masked_pipelines[(material_bucket & MATERIAL_FEATURE_ALBEDO) != 0 ? 1 : 0]);
+    }
+}
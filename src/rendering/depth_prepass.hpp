@@ -0,0 +1,40 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+#include "../../shaders/shared.inl"
+
+#include <array>
+#include <functional>
+
+namespace dare {
+    // depth only pass that only fetches vertex positions, the shading pass after it tests with EQUAL and
+    // writes no depth so every pixel is shaded exactly once, alpha masked draws also fetch their uv and albedo
+    struct DepthPrepass {
+        // masked buckets only differ in whether the alpha comes from the albedo texture, variant 1 samples it
+        static constexpr u32 ALPHA_MASKED_VARIANTS = 2;
+
+        DepthPrepass(RenderContext& context, daxa::Format depth_format);
+        ~DepthPrepass() = default;
+
+        // settings are the owning task's defines, the shader only cares about SETTINGS_GPU_DRIVEN
+        void rebuild_pipeline(const std::string& settings);
+        // only builds, safe to call from a background build while the current pipeline is still in use, material
+        // features other than 0 give an alpha masked pipeline that fetches the uv and discards the same way the
+        // shading pass of that bucket does, it only works with cpu submission
+        auto create_pipeline(const std::string& settings, u32 material_features = 0) const -> daxa::RasterPipeline;
+        auto create_alpha_masked_pipelines(const std::string& settings) const -> std::array<daxa::RasterPipeline, ALPHA_MASKED_VARIANTS>;
+        // the depth image has to be in ATTACHMENT_OPTIMAL, draw records the geometry with the pipeline bound
+        void render(daxa::CommandList& cmd_list, daxa::ImageId depth_image, u32 sx, u32 sy, daxa::AttachmentLoadOp load_op, const std::function<void()>& draw);
+        // for the draws of a material bucket, only masked buckets pay for the texture fetch
+        void bind_pipeline(daxa::CommandList& cmd_list, u32 material_bucket);
+
+        daxa::RasterPipeline depth_prepass_pipeline;
+        std::array<daxa::RasterPipeline, ALPHA_MASKED_VARIANTS> alpha_masked_pipelines;
+
+    private:
+        daxa::Format depth_format;
+        RenderContext& context;
+    };
+}
@@ -0,0 +1,173 @@
+#include "depth_pyramid.hpp"
+
+#include "../utils/utils.hpp"
+
+namespace dare {
+    DepthPyramid::DepthPyramid(RenderContext& context) : context{context} {
+        this->sampler = this->context.device.create_sampler({
+            .magnification_filter = daxa::Filter::NEAREST,
+            .minification_filter = daxa::Filter::NEAREST,
+            .mipmap_filter = daxa::Filter::NEAREST,
+            .address_mode_u = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .address_mode_v = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .address_mode_w = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .mip_lod_bias = 0.0f,
+            .enable_anisotropy = false,
+            .max_anisotropy = 0.0f,
+            .enable_compare = false,
+            .compare_op = daxa::CompareOp::ALWAYS,
+            .min_lod = 0.0f,
+            .max_lod = static_cast<f32>(DEPTH_PYRAMID_MAX_MIPS),
+            .enable_unnormalized_coordinates = false,
+        });
+
+        // counts finished workgroups so the last one can reduce the tail of the chain
+        this->counter_buffer = this->context.device.create_buffer({
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .size = sizeof(DrawCount),
+            .debug_name = APPNAME_PREFIX("depth_pyramid_counter_buffer"),
+        });
+        this->counter_buffer_address = this->context.device.get_device_address(this->counter_buffer);
+
+        std::string depth_pyramid_code = file_to_string("./shaders/common/depth_pyramid.glsl");
+        this->depth_pyramid_pipeline = this->context.shader_cache->create_compute_pipeline({
+            .shader_info = { .source = daxa::ShaderCode{ depth_pyramid_code } },
+            .push_constant_size = sizeof(DepthPyramidPush),
+            .debug_name = APPNAME_PREFIX("depth_pyramid_pipeline"),
+        }).value();
+    }
+
+    DepthPyramid::~DepthPyramid() {
+        this->destroy_images();
+        this->context.device.destroy_buffer(this->counter_buffer);
+        this->context.device.destroy_sampler(this->sampler);
+    }
+
+    void DepthPyramid::destroy_images() {
+        if(this->mip_count == 0) {
+            return;
+        }
+
+        for(u32 i = 0; i < this->mip_count; i++) {
+            this->context.device.destroy_image_view(this->mip_views[i]);
+        }
+        this->context.device.destroy_image_view(this->depth_view);
+        this->context.device.destroy_image(this->pyramid_image);
+        this->pyramid_image = {};
+        this->mip_count = 0;
+    }
+
+    void DepthPyramid::resize(daxa::ImageId depth_image, u32 sx, u32 sy) {
+        this->destroy_images();
+
+        // a power of two pyramid keeps every level an exact 2x2 reduction of the previous one
+        auto previous_power_of_two = [](u32 value) -> u32 {
+            u32 result = 1;
+            while(result * 2 <= value) {
+                result *= 2;
+            }
+            return result;
+        };
+
+        u32 max_size = 1u << (DEPTH_PYRAMID_MAX_MIPS - 1);
+        this->depth_size = { sx, sy };
+        this->pyramid_size = { std::min(previous_power_of_two(sx), max_size), std::min(previous_power_of_two(sy), max_size) };
+        this->mip_count = 1;
+        while((std::max(this->pyramid_size.x, this->pyramid_size.y) >> this->mip_count) > 0) {
+            this->mip_count++;
+        }
+
+        this->pyramid_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::R32_SFLOAT,
+            .aspect = daxa::ImageAspectFlagBits::COLOR,
+            .size = { this->pyramid_size.x, this->pyramid_size.y, 1 },
+            .mip_level_count = this->mip_count,
+            .array_layer_count = 1,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::SHADER_READ_ONLY | daxa::ImageUsageFlagBits::SHADER_READ_WRITE,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .debug_name = APPNAME_PREFIX("depth_pyramid_image"),
+        });
+
+        for(u32 i = 0; i < this->mip_count; i++) {
+            this->mip_views[i] = this->context.device.create_image_view({
+                .type = daxa::ImageViewType::REGULAR_2D,
+                .format = daxa::Format::R32_SFLOAT,
+                .image = this->pyramid_image,
+                .slice = {
+                    .image_aspect = daxa::ImageAspectFlagBits::COLOR,
+                    .base_mip_level = i,
+                    .level_count = 1,
+                    .base_array_layer = 0,
+                    .layer_count = 1
+                },
+                .debug_name = APPNAME_PREFIX("depth_pyramid_mip_view"),
+            });
+        }
+
+        // sampling a combined depth stencil image needs a view of the depth aspect alone
+        this->depth_view = this->context.device.create_image_view({
+            .type = daxa::ImageViewType::REGULAR_2D,
+            .format = daxa::Format::D24_UNORM_S8_UINT,
+            .image = depth_image,
+            .slice = {
+                .image_aspect = daxa::ImageAspectFlagBits::DEPTH,
+                .base_mip_level = 0,
+                .level_count = 1,
+                .base_array_layer = 0,
+                .layer_count = 1
+            },
+            .debug_name = APPNAME_PREFIX("depth_pyramid_depth_view"),
+        });
+    }
+
+    void DepthPyramid::build(daxa::CommandList& cmd_list) {
+        // every level is rewritten, the previous contents can be discarded
+        cmd_list.pipeline_barrier_image_transition({
+            .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+            .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ_WRITE,
+            .before_layout = daxa::ImageLayout::UNDEFINED,
+            .after_layout = daxa::ImageLayout::GENERAL,
+            .image_slice = { .level_count = this->mip_count },
+            .image_id = this->pyramid_image,
+        });
+
+        DepthPyramidPush push = {
+            .depth = { .image_view_id = this->depth_view, .sampler_id = this->sampler },
+            .depth_size = { this->depth_size.x, this->depth_size.y },
+            .pyramid_size = { this->pyramid_size.x, this->pyramid_size.y },
+            .mip_count = this->mip_count,
+            .counter_buffer = this->counter_buffer_address,
+        };
+        for(u32 i = 0; i < DEPTH_PYRAMID_MAX_MIPS; i++) {
+            // unused levels alias the last one, the shader never touches them
+            push.mips[i] = this->mip_views[std::min(i, this->mip_count - 1)];
+        }
+
+        u32 groups_x = (this->pyramid_size.x + DEPTH_PYRAMID_TILE_SIZE - 1) / DEPTH_PYRAMID_TILE_SIZE;
+        u32 groups_y = (this->pyramid_size.y + DEPTH_PYRAMID_TILE_SIZE - 1) / DEPTH_PYRAMID_TILE_SIZE;
+        push.group_count = groups_x * groups_y;
+
+        cmd_list.clear_buffer({
+            .buffer = this->counter_buffer,
+            .offset = 0,
+            .size = sizeof(DrawCount),
+            .clear_value = 0,
+        });
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ_WRITE,
+        });
+
+        cmd_list.set_pipeline(this->depth_pyramid_pipeline);
+        cmd_list.push_constant(push);
+        cmd_list.dispatch(groups_x, groups_y, 1);
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+        });
+    }
+}
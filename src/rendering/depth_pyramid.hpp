@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+
+#include <array>
+
+namespace dare {
+    // hierarchical max depth of a depth image, every mip texel holds the farthest depth of the texels it covers,
+    // the whole chain is written by a single compute dispatch
+    struct DepthPyramid {
+        DepthPyramid(RenderContext& context);
+        ~DepthPyramid();
+
+        // recreates the pyramid to match a new depth image, must be called before the first build
+        void resize(daxa::ImageId depth_image, u32 sx, u32 sy);
+        // the depth image has to be in READ_ONLY_OPTIMAL, the pyramid is left in GENERAL for sampling
+        void build(daxa::CommandList& cmd_list);
+
+        daxa::ImageId pyramid_image = {};
+        daxa::ImageViewId depth_view = {};
+        std::array<daxa::ImageViewId, DEPTH_PYRAMID_MAX_MIPS> mip_views = {};
+        daxa::SamplerId sampler;
+
+        glm::uvec2 depth_size = { 0, 0 };
+        glm::uvec2 pyramid_size = { 0, 0 };
+        u32 mip_count = 0;
+
+        daxa::BufferId counter_buffer;
+        daxa::BufferDeviceAddress counter_buffer_address;
+        daxa::ComputePipeline depth_pyramid_pipeline;
+
+    private:
+        void destroy_images();
+
+        RenderContext& context;
+    };
+}
@@ -0,0 +1,126 @@
+#include "draw_list.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <unordered_map>
+
+namespace dare {
+    void DrawList::clear() {
+        this->items.clear();
+        this->visible_count = 0;
+        this->culled_count = 0;
+        this->occluded_count = 0;
+        this->stats = {};
+    }
+
+    void DrawList::sort(const glm::mat4& view, f32 far_plane) {
+        usize count = this->items.size();
+        if(count < 2) {
+            return;
+        }
+
+        // index buffers and materials get dense ids in order of first appearance, which keeps the keys stable between frames,
+        // materials go by their buffer since material indices are only unique within a model
+        std::unordered_map<daxa::BufferDeviceAddress, u32> index_buffer_ids;
+        std::unordered_map<daxa::BufferDeviceAddress, u32> material_ids;
+        this->keys.resize(count);
+        this->order.resize(count);
+
+        constexpr u64 depth_max = (1ull << DRAW_KEY_DEPTH_BITS) - 1;
+        constexpr u64 material_max = (1ull << DRAW_KEY_MATERIAL_BITS) - 1;
+        constexpr u64 index_buffer_max = (1ull << DRAW_KEY_INDEX_BUFFER_BITS) - 1;
+        constexpr u64 pipeline_max = (1ull << DRAW_KEY_PIPELINE_BITS) - 1;
+
+        for(u32 i = 0; i < count; i++) {
+            const DrawItem& item = this->items[i];
+            auto [index_buffer_id, index_buffer_inserted] = index_buffer_ids.try_emplace(item.model->index_buffer_address, static_cast<u32>(index_buffer_ids.size()));
+            auto [material_id, material_inserted] = material_ids.try_emplace(item.model->material_buffers[item.primitive->material_index]->buffer_address, static_cast<u32>(material_ids.size()));
+
+            f32 distance = -(view * glm::vec4(item.aabb_center, 1.0f)).z;
+            u64 depth = static_cast<u64>(std::clamp(distance / far_plane, 0.0f, 1.0f) * static_cast<f32>(depth_max));
+
+            this->keys[i] = (std::min<u64>(item.pipeline, pipeline_max) << (DRAW_KEY_INDEX_BUFFER_BITS + DRAW_KEY_MATERIAL_BITS + DRAW_KEY_DEPTH_BITS))
+                | (std::min<u64>(index_buffer_id->second, index_buffer_max) << (DRAW_KEY_MATERIAL_BITS + DRAW_KEY_DEPTH_BITS))
+                | (std::min<u64>(material_id->second, material_max) << DRAW_KEY_DEPTH_BITS)
+                | depth;
+            this->order[i] = i;
+        }
+
+        // least significant digit radix sort, 8 bits per pass, passes where every key has the same digit are skipped
+        this->scratch_keys.resize(count);
+        this->scratch_order.resize(count);
+        for(u32 shift = 0; shift < 64; shift += 8) {
+            std::array<u32, 256> histogram = {};
+            for(usize i = 0; i < count; i++) {
+                histogram[(this->keys[i] >> shift) & 0xFF]++;
+            }
+
+            if(histogram[(this->keys[0] >> shift) & 0xFF] == count) {
+                continue;
+            }
+
+            u32 offset = 0;
+            for(auto& bucket : histogram) {
+                u32 bucket_count = bucket;
+                bucket = offset;
+                offset += bucket_count;
+            }
+
+            for(usize i = 0; i < count; i++) {
+                u32 destination = histogram[(this->keys[i] >> shift) & 0xFF]++;
+                this->scratch_keys[destination] = this->keys[i];
+                this->scratch_order[destination] = this->order[i];
+            }
+
+            std::swap(this->keys, this->scratch_keys);
+            std::swap(this->order, this->scratch_order);
+        }
+
+        this->scratch_items.resize(count);
+        for(usize i = 0; i < count; i++) {
+            this->scratch_items[i] = this->items[this->order[i]];
+        }
+        std::swap(this->items, this->scratch_items);
+    }
+
+    void DrawList::partition_masked() {
+        std::stable_partition(this->items.begin(), this->items.end(), [](const DrawItem& item) {
+            return (item.pipeline & MATERIAL_FEATURE_ALPHA_MASK) == 0;
+        });
+    }
+
+    void DrawList::record(daxa::CommandList& cmd_list, DrawPush& push_constant, const std::function<void(u32)>& bind_pipeline) const {
+        this->record_range(cmd_list, push_constant, 0, this->items.size(), this->stats, bind_pipeline);
+    }
+
+    void DrawList::record_range(daxa::CommandList& cmd_list, DrawPush& push_constant, usize first, usize count, Stats& stats, const std::function<void(u32)>& bind_pipeline) const {
+        daxa::BufferDeviceAddress bound_index_buffer = 0;
+        u32 bound_pipeline = std::numeric_limits<u32>::max();
+
+        for(usize i = first; i < first + count; i++) {
+            const DrawItem& item = this->items[i];
+            if(bind_pipeline && item.pipeline != bound_pipeline) {
+                bind_pipeline(item.pipeline);
+                bound_pipeline = item.pipeline;
+                stats.pipeline_binds++;
+            }
+
+            if(item.model->index_buffer_address != bound_index_buffer) {
+                item.model->bind_index_buffer(cmd_list);
+                bound_index_buffer = item.model->index_buffer_address;
+                stats.index_buffer_binds++;
+            }
+
+            push_constant.object_buffer = item.object_buffer;
+            push_constant.face_buffer = item.model->vertex_buffer_address;
+            push_constant.position_buffer = item.model->position_buffer_address;
+            push_constant.material_info_buffer = item.model->material_buffers[item.primitive->material_index]->buffer_address;
+            // every item has its own object buffer, so the constants change with every draw anyway
+            cmd_list.push_constant(push_constant);
+
+            item.model->draw_primitive(cmd_list, *item.primitive);
+            stats.draws++;
+        }
+    }
+}
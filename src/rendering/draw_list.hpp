@@ -0,0 +1,65 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "../../shaders/shared.inl"
+#include "../graphics/model.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace dare {
+    // sort keys, most significant first: | pipeline 8 | index buffer 16 | material 16 | depth 24 |
+    // draws sharing state end up next to each other and every run of equal state is drawn front to back
+    static constexpr u32 DRAW_KEY_DEPTH_BITS = 24;
+    static constexpr u32 DRAW_KEY_MATERIAL_BITS = 16;
+    static constexpr u32 DRAW_KEY_INDEX_BUFFER_BITS = 16;
+    static constexpr u32 DRAW_KEY_PIPELINE_BITS = 8;
+
+    struct DrawItem {
+        Model* model;
+        const Primitive* primitive;
+        daxa::BufferDeviceAddress object_buffer;
+        // world space bounds
+        glm::vec3 aabb_center;
+        glm::vec3 aabb_extent;
+        // which of the pass's pipelines draws this item, the material bucket of the primitive
+        u32 pipeline = 0;
+    };
+
+    // primitives that survived culling this frame, this is what the tasks record from
+    struct DrawList {
+        struct Stats {
+            u32 draws = 0;
+            u32 pipeline_binds = 0;
+            u32 index_buffer_binds = 0;
+        };
+
+        std::vector<DrawItem> items;
+        u32 visible_count = 0;
+        u32 culled_count = 0;
+        u32 occluded_count = 0;
+        // accumulated over every pass that records this frame
+        mutable Stats stats = {};
+
+        void clear();
+        // orders the items by their sort key, depth is the view space distance scaled by the far plane
+        void sort(const glm::mat4& view, f32 far_plane);
+        // moves alpha masked items behind the opaque ones and keeps the order within each group, sort already
+        // does this through the pipeline bits so this is only needed when sorting is off
+        void partition_masked();
+        // bind_pipeline is called whenever the pipeline of the next item differs from the previous one
+        void record(daxa::CommandList& cmd_list, DrawPush& push_constant, const std::function<void(u32)>& bind_pipeline = nullptr) const;
+        // records count items starting at first and counts them into stats, the list itself is only read so
+        // disjoint ranges can be recorded from different threads
+        void record_range(daxa::CommandList& cmd_list, DrawPush& push_constant, usize first, usize count, Stats& stats, const std::function<void(u32)>& bind_pipeline = nullptr) const;
+
+    private:
+        std::vector<u64> keys;
+        std::vector<u64> scratch_keys;
+        std::vector<u32> order;
+        std::vector<u32> scratch_order;
+        std::vector<DrawItem> scratch_items;
+    };
+}
@@ -0,0 +1,148 @@
+#include "frustum_culling.hpp"
+
+#include "../data/entity.hpp"
+#include "../data/components.hpp"
+
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dare {
+    auto FrustumCulling::extract_planes(const glm::mat4& view_projection) -> std::array<glm::vec4, 6> {
+        auto row = [&](u32 i) -> glm::vec4 {
+            return { view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i] };
+        };
+
+        // clip space depth goes from 0 to 1, so the near plane is the z row on its own
+        return {
+            row(3) + row(0),
+            row(3) - row(0),
+            row(3) + row(1),
+            row(3) - row(1),
+            row(2),
+            row(3) - row(2),
+        };
+    }
+
+    void FrustumCulling::cull(const std::shared_ptr<Scene>& scene, const glm::mat4& view_projection, DrawList& draw_list) {
+        draw_list.clear();
+        this->candidates.clear();
+        this->center_x.clear();
+        this->center_y.clear();
+        this->center_z.clear();
+        this->extent_x.clear();
+        this->extent_y.clear();
+        this->extent_z.clear();
+
+        auto gather = [&](Entity entity){
+            if(entity.has_component<ModelComponent>()) {
+                auto& model = entity.get_component<ModelComponent>().model;
+                auto& transform = entity.get_component<TransformComponent>();
+                glm::mat3 absolute = glm::mat3(transform.model_matrix);
+                for(u32 i = 0; i < 3; i++) {
+                    absolute[i] = glm::abs(absolute[i]);
+                }
+
+                for(auto& primitive : model->primitives) {
+                    // transformed center plus the extents projected onto the world axes gives the world space box
+                    glm::vec3 center = glm::vec3(transform.model_matrix * glm::vec4((primitive.aabb_min + primitive.aabb_max) * 0.5f, 1.0f));
+                    glm::vec3 extent = absolute * ((primitive.aabb_max - primitive.aabb_min) * 0.5f);
+
+                    this->candidates.push_back({ model.get(), &primitive, transform.object_info->buffer_address, center, extent, primitive.material_bucket });
+                    this->center_x.push_back(center.x);
+                    this->center_y.push_back(center.y);
+                    this->center_z.push_back(center.z);
+                    this->extent_x.push_back(extent.x);
+                    this->extent_y.push_back(extent.y);
+                    this->extent_z.push_back(extent.z);
+                }
+            }
+        };
+
+        // the hierarchy rejects whole groups of entities, only the primitives of the survivors are tested one by one
+        if(this->enabled) {
+            scene->bvh.query_frustum(extract_planes(view_projection), [&](entt::entity entity) {
+                gather({ entity, scene.get() });
+            });
+        } else {
+            scene->iterate(gather);
+        }
+
+        this->visible.assign(this->candidates.size(), 1);
+        if(this->enabled) {
+            test_boxes(extract_planes(view_projection));
+        }
+
+        for(usize i = 0; i < this->candidates.size(); i++) {
+            if(this->visible[i]) {
+                draw_list.items.push_back(this->candidates[i]);
+            }
+        }
+
+        draw_list.visible_count = static_cast<u32>(draw_list.items.size());
+        // measured against every primitive so entities the hierarchy rejected as a whole are counted too
+        draw_list.culled_count = count_primitives(scene) - draw_list.visible_count;
+    }
+
+    auto FrustumCulling::count_primitives(const std::shared_ptr<Scene>& scene) -> u32 {
+        if(scene.get() == this->scene && scene->structure_version == this->scene_version) {
+            return this->primitive_count;
+        }
+        this->scene = scene.get();
+        this->scene_version = scene->structure_version;
+
+        this->primitive_count = 0;
+        scene->iterate([&](Entity entity){
+            if(entity.has_component<ModelComponent>()) {
+                this->primitive_count += static_cast<u32>(entity.get_component<ModelComponent>().model->primitives.size());
+            }
+        });
+        return this->primitive_count;
+    }
+
+    void FrustumCulling::test_boxes(const std::array<glm::vec4, 6>& planes) {
+        usize count = this->candidates.size();
+        usize i = 0;
+
+#if defined(__AVX2__)
+        for(; i + 8 <= count; i += 8) {
+            __m256 cx = _mm256_loadu_ps(&this->center_x[i]);
+            __m256 cy = _mm256_loadu_ps(&this->center_y[i]);
+            __m256 cz = _mm256_loadu_ps(&this->center_z[i]);
+            __m256 ex = _mm256_loadu_ps(&this->extent_x[i]);
+            __m256 ey = _mm256_loadu_ps(&this->extent_y[i]);
+            __m256 ez = _mm256_loadu_ps(&this->extent_z[i]);
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for(auto& plane : planes) {
+                __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(plane.x)), _mm256_mul_ps(cy, _mm256_set1_ps(plane.y))),
+                    _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(plane.z)), _mm256_set1_ps(plane.w))
+                );
+                __m256 radius = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(ex, _mm256_set1_ps(std::abs(plane.x))), _mm256_mul_ps(ey, _mm256_set1_ps(std::abs(plane.y)))),
+                    _mm256_mul_ps(ez, _mm256_set1_ps(std::abs(plane.z)))
+                );
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+
+            i32 mask = _mm256_movemask_ps(inside);
+            for(u32 lane = 0; lane < 8; lane++) {
+                this->visible[i + lane] = static_cast<u8>((mask >> lane) & 1);
+            }
+        }
+#endif
+
+        for(; i < count; i++) {
+            bool inside = true;
+            for(auto& plane : planes) {
+                f32 distance = this->center_x[i] * plane.x + this->center_y[i] * plane.y + this->center_z[i] * plane.z + plane.w;
+                f32 radius = this->extent_x[i] * std::abs(plane.x) + this->extent_y[i] * std::abs(plane.y) + this->extent_z[i] * std::abs(plane.z);
+                inside = inside && (distance + radius >= 0.0f);
+            }
+            this->visible[i] = static_cast<u8>(inside);
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "../data/scene.hpp"
+#include "draw_list.hpp"
+
+#include <array>
+
+namespace dare {
+    // world space bounds are kept as structure of arrays so eight boxes can be tested per AVX2 iteration
+    struct FrustumCulling {
+        bool enabled = true;
+
+        void cull(const std::shared_ptr<Scene>& scene, const glm::mat4& view_projection, DrawList& draw_list);
+
+        static auto extract_planes(const glm::mat4& view_projection) -> std::array<glm::vec4, 6>;
+
+    private:
+        void test_boxes(const std::array<glm::vec4, 6>& planes);
+        auto count_primitives(const std::shared_ptr<Scene>& scene) -> u32;
+
+        std::vector<DrawItem> candidates;
+        std::vector<f32> center_x;
+        std::vector<f32> center_y;
+        std::vector<f32> center_z;
+        std::vector<f32> extent_x;
+        std::vector<f32> extent_y;
+        std::vector<f32> extent_z;
+        std::vector<u8> visible;
+
+        // primitives of every model in the scene, recounted only when the scene changes shape
+        const Scene* scene = nullptr;
+        u64 scene_version = 0;
+        u32 primitive_count = 0;
+    };
+}
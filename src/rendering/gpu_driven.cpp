@@ -0,0 +1,228 @@
+#include "gpu_driven.hpp"
+
+#include "../utils/utils.hpp"
+#include "../data/entity.hpp"
+#include "../data/components.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+
+namespace dare {
+    GPUDriven::GPUDriven(RenderContext& context) : context{context} {
+        this->instance_buffer = std::make_unique<GrowableBuffer<DrawInstance>>(this->context.device, 256, APPNAME_PREFIX("gpu_driven_instance_buffer"));
+        this->command_buffer = std::make_unique<GrowableBuffer<DrawIndexedIndirectCommand>>(this->context.device, 256, APPNAME_PREFIX("gpu_driven_command_buffer"));
+        this->count_buffer = std::make_unique<GrowableBuffer<DrawCount>>(this->context.device, 16, APPNAME_PREFIX("gpu_driven_count_buffer"));
+        this->visibility_buffer = std::make_unique<GrowableBuffer<DrawCount>>(this->context.device, 256, APPNAME_PREFIX("gpu_driven_visibility_buffer"));
+
+        std::string culling_code = file_to_string("./shaders/common/gpu_culling.glsl");
+        this->culling_pipeline = this->context.shader_cache->create_compute_pipeline({
+            .shader_info = { .source = daxa::ShaderCode{ culling_code } },
+            .push_constant_size = sizeof(GPUCullingPush),
+            .debug_name = APPNAME_PREFIX("gpu_culling_pipeline"),
+        }).value();
+    }
+
+    void GPUDriven::update(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene) {
+        // instances only hold addresses and model space bounds, transforms are read through the object buffers,
+        // so the uploaded instances stay valid until the scene changes shape
+        if(scene.get() == this->scene && scene->structure_version == this->scene_version) {
+            return;
+        }
+        this->scene = scene.get();
+        this->scene_version = scene->structure_version;
+
+        std::vector<DrawInstance> instances;
+        // models loaded into the same geometry pool share an index buffer and therefore a batch
+        std::unordered_map<daxa::BufferDeviceAddress, u32> batch_lookup;
+        this->batches.clear();
+
+        scene->iterate([&](Entity entity){
+            if(entity.has_component<ModelComponent>()) {
+                auto& model = entity.get_component<ModelComponent>().model;
+                daxa::BufferDeviceAddress object_buffer = entity.get_component<TransformComponent>().object_info->buffer_address;
+
+                auto [it, inserted] = batch_lookup.try_emplace(model->index_buffer_address, static_cast<u32>(this->batches.size()));
+                if(inserted) {
+                    this->batches.push_back({ model.get(), 0, 0 });
+                }
+                Batch& batch = this->batches[it->second];
+
+                for(auto& primitive : model->primitives) {
+                    // indirect commands are indexed only, glTF primitives practically always come with indices
+                    if(primitive.index_count == 0) {
+                        continue;
+                    }
+
+                    glm::vec3 center = (primitive.aabb_min + primitive.aabb_max) * 0.5f;
+                    glm::vec3 extent = (primitive.aabb_max - primitive.aabb_min) * 0.5f;
+                    instances.push_back(DrawInstance {
+                        .object_buffer = object_buffer,
+                        .vertex_buffer = model->vertex_buffer_address,
+                        .position_buffer = model->position_buffer_address,
+                        .material_info_buffer = model->material_buffers[primitive.material_index]->buffer_address,
+                        .aabb_center = { center.x, center.y, center.z },
+                        .aabb_extent = { extent.x, extent.y, extent.z },
+                        .index_count = primitive.index_count,
+                        .first_index = primitive.first_index,
+                        .vertex_offset = static_cast<i32>(primitive.first_vertex),
+                        .batch_index = it->second,
+                        .first_command = 0,
+                    });
+                    batch.command_count++;
+                }
+            }
+        });
+
+        // every batch owns a range of the command buffer big enough for all of its instances
+        u32 command_count = 0;
+        for(auto& batch : this->batches) {
+            batch.first_command = command_count;
+            command_count += batch.command_count;
+        }
+
+        for(auto& instance : instances) {
+            instance.first_command = this->batches[instance.batch_index].first_command;
+        }
+
+        this->command_count = command_count;
+        this->instance_count = static_cast<u32>(instances.size());
+
+        if(instances.size() > this->instance_buffer->capacity) {
+            this->instance_buffer->update(cmd_list, *this->context.staging_ring, instances);
+        } else {
+            // only runs of instances that differ from the previous upload are copied, short gaps between runs go
+            // along so scattered changes don't turn into a copy each, the compare stops before the tail padding
+            static constexpr usize UPLOAD_GAP = 16;
+            static constexpr usize COMPARED_BYTES = offsetof(DrawInstance, first_command) + sizeof(u32);
+
+            usize run_first = 0;
+            usize run_end = 0;
+            bool in_run = false;
+            for(usize i = 0; i < instances.size(); i++) {
+                if(i < this->instances.size() && std::memcmp(&instances[i], &this->instances[i], COMPARED_BYTES) == 0) {
+                    continue;
+                }
+
+                if(in_run && i - run_end > UPLOAD_GAP) {
+                    this->instance_buffer->update(cmd_list, *this->context.staging_ring, instances, run_first, run_end - run_first);
+                    in_run = false;
+                }
+
+                if(!in_run) {
+                    run_first = i;
+                    in_run = true;
+                }
+                run_end = i + 1;
+            }
+
+            if(in_run) {
+                this->instance_buffer->update(cmd_list, *this->context.staging_ring, instances, run_first, run_end - run_first);
+            }
+        }
+        this->instances = std::move(instances);
+
+        this->command_buffer->reserve(cmd_list, command_count * 2);
+        this->count_buffer->reserve(cmd_list, this->batches.size() * 2);
+        this->visibility_buffer->reserve(cmd_list, this->instance_count);
+
+        // instances are only stable while the scene keeps its shape, an instance can be replaced by another one
+        // without the count changing, so after any structural change everything counts as visible once
+        if(this->instance_count > 0) {
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::READ_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            });
+
+            cmd_list.clear_buffer({
+                .buffer = this->visibility_buffer->buffer_id,
+                .offset = 0,
+                .size = static_cast<u32>(this->instance_count * sizeof(DrawCount)),
+                .clear_value = 1,
+            });
+
+            cmd_list.pipeline_barrier({
+                .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ_WRITE,
+            });
+        }
+    }
+
+    void GPUDriven::cull(daxa::CommandList& cmd_list, daxa::BufferDeviceAddress camera_buffer, u32 phase, const DepthPyramid* depth_pyramid) {
+        if(this->batches.empty()) {
+            return;
+        }
+
+        u32 slot = this->phase_slot(phase);
+        u32 batch_count = static_cast<u32>(this->batches.size());
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::READ,
+            .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+        });
+
+        cmd_list.clear_buffer({
+            .buffer = this->count_buffer->buffer_id,
+            .offset = slot * batch_count * sizeof(DrawCount),
+            .size = static_cast<u32>(batch_count * sizeof(DrawCount)),
+            .clear_value = 0,
+        });
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ_WRITE,
+        });
+
+        GPUCullingPush push = {
+            .camera_buffer = camera_buffer,
+            .instance_buffer = this->instance_buffer->buffer_address,
+            .command_buffer = this->command_buffer->buffer_address + slot * this->command_count * sizeof(DrawIndexedIndirectCommand),
+            .count_buffer = this->count_buffer->buffer_address + slot * batch_count * sizeof(DrawCount),
+            .visibility_buffer = this->visibility_buffer->buffer_address,
+            .instance_count = this->instance_count,
+            .frustum_culling = this->frustum_culling ? 1u : 0u,
+            .phase = phase,
+        };
+
+        if(depth_pyramid != nullptr) {
+            push.depth_pyramid = { .image_view_id = depth_pyramid->pyramid_image.default_view(), .sampler_id = depth_pyramid->sampler };
+            push.depth_pyramid_size = { depth_pyramid->pyramid_size.x, depth_pyramid->pyramid_size.y };
+            push.depth_pyramid_mip_count = depth_pyramid->mip_count;
+        }
+
+        cmd_list.set_pipeline(this->culling_pipeline);
+        cmd_list.push_constant(push);
+        cmd_list.dispatch((this->instance_count + GPU_CULLING_GROUP_SIZE - 1) / GPU_CULLING_GROUP_SIZE, 1, 1);
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::READ,
+        });
+    }
+
+    void GPUDriven::draw(daxa::CommandList& cmd_list, DrawPush& push_constant, u32 phase) {
+        push_constant.instance_buffer = this->instance_buffer->buffer_address;
+        cmd_list.push_constant(push_constant);
+
+        u32 slot = this->phase_slot(phase);
+        u32 batch_count = static_cast<u32>(this->batches.size());
+
+        for(u32 batch_index = 0; batch_index < batch_count; batch_index++) {
+            auto& batch = this->batches[batch_index];
+            if(batch.command_count == 0) {
+                continue;
+            }
+
+            batch.model->bind_index_buffer(cmd_list);
+            cmd_list.draw_indirect_count({
+                .draw_command_buffer = this->command_buffer->buffer_id,
+                .draw_command_buffer_read_offset = (slot * this->command_count + batch.first_command) * sizeof(DrawIndexedIndirectCommand),
+                .draw_count_buffer = this->count_buffer->buffer_id,
+                .draw_count_buffer_read_offset = (slot * batch_count + batch_index) * sizeof(DrawCount),
+                .max_draw_count = batch.command_count,
+                .draw_command_stride = sizeof(DrawIndexedIndirectCommand),
+                .is_indexed = true,
+            });
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+#include "../data/scene.hpp"
+#include "../graphics/model.hpp"
+#include "depth_pyramid.hpp"
+
+namespace dare {
+    // every primitive of the scene lives in gpu buffers, a compute pass culls them and writes the indirect
+    // commands, recording then costs one indirect call per index buffer no matter how many instances there are,
+    // with every model in the scene's geometry pool that is a single call
+    //
+    // with occlusion culling the frame is split in two phases, the early phase draws what was visible last
+    // frame, the late phase tests everything against a depth pyramid of that and draws what became visible
+    struct GPUDriven {
+        GPUDriven(RenderContext& context);
+        ~GPUDriven() = default;
+
+        void update(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene);
+        // phase is one of GPU_CULLING_PHASE_*, the late phase needs the pyramid built from the early phase's depth
+        void cull(daxa::CommandList& cmd_list, daxa::BufferDeviceAddress camera_buffer, u32 phase = GPU_CULLING_PHASE_ALL, const DepthPyramid* depth_pyramid = nullptr);
+        void draw(daxa::CommandList& cmd_list, DrawPush& push_constant, u32 phase = GPU_CULLING_PHASE_ALL);
+
+        struct Batch {
+            // any model of the batch, they all bind the same index buffer
+            Model* model;
+            u32 first_command;
+            u32 command_count;
+        };
+
+        bool frustum_culling = true;
+        bool occlusion_culling = false;
+        u32 instance_count = 0;
+        std::vector<Batch> batches;
+
+        std::unique_ptr<GrowableBuffer<DrawInstance>> instance_buffer;
+        std::unique_ptr<GrowableBuffer<DrawIndexedIndirectCommand>> command_buffer;
+        std::unique_ptr<GrowableBuffer<DrawCount>> count_buffer;
+        // one entry per instance, whether it passed the late phase of the previous frame
+        std::unique_ptr<GrowableBuffer<DrawCount>> visibility_buffer;
+        daxa::ComputePipeline culling_pipeline;
+
+    private:
+        // the late phase gets its own half of the command and count buffers so both phases can be drawn
+        auto phase_slot(u32 phase) -> u32 { return phase == GPU_CULLING_PHASE_LATE ? 1 : 0; }
+
+        u32 command_count = 0;
+        // host copy of the uploaded instances and the scene version they were built from
+        std::vector<DrawInstance> instances;
+        const Scene* scene = nullptr;
+        u64 scene_version = 0;
+        RenderContext& context;
+    };
+}
@@ -0,0 +1,61 @@
+#include "gpu_timer.hpp"
+
+#include "../../shaders/shared.inl"
+
+namespace dare {
+    GPUTimer::GPUTimer(daxa::Device& device, u32 timer_count) : device{device}, timer_count{timer_count}, times(timer_count, 0.0f) {
+        for(auto& query_pool : this->query_pools) {
+            query_pool = this->device.create_timeline_query_pool({
+                .query_count = timer_count * 2,
+                .debug_name = APPNAME_PREFIX("gpu_timer_query_pool"),
+            });
+        }
+        this->timestamp_period = this->device.properties().limits.timestamp_period;
+    }
+
+    void GPUTimer::reset(daxa::CommandList& cmd_list) {
+        this->current_pool = (this->current_pool + 1) % RenderContext::FRAMES_IN_FLIGHT;
+        daxa::TimelineQueryPool& query_pool = this->query_pools[this->current_pool];
+
+        if(this->has_written[this->current_pool]) {
+            // every query is a (value, availability) pair, unavailable timers keep their last value
+            std::vector<u64> results = query_pool.get_query_results(0, this->timer_count * 2);
+            for(u32 timer = 0; timer < this->timer_count; timer++) {
+                u64 begin_value = results[timer * 4 + 0];
+                u64 begin_available = results[timer * 4 + 1];
+                u64 end_value = results[timer * 4 + 2];
+                u64 end_available = results[timer * 4 + 3];
+                if(begin_available != 0 && end_available != 0 && end_value >= begin_value) {
+                    this->times[timer] = static_cast<f32>(end_value - begin_value) * this->timestamp_period / 1000000.0f;
+                }
+            }
+        }
+
+        cmd_list.reset_timestamps({
+            .query_pool = query_pool,
+            .start_index = 0,
+            .count = this->timer_count * 2,
+        });
+        this->has_written[this->current_pool] = true;
+    }
+
+    void GPUTimer::begin(daxa::CommandList& cmd_list, u32 timer) {
+        cmd_list.write_timestamp({
+            .query_pool = this->query_pools[this->current_pool],
+            .pipeline_stage = daxa::PipelineStageFlagBits::TOP_OF_PIPE,
+            .query_index = timer * 2,
+        });
+    }
+
+    void GPUTimer::end(daxa::CommandList& cmd_list, u32 timer) {
+        cmd_list.write_timestamp({
+            .query_pool = this->query_pools[this->current_pool],
+            .pipeline_stage = daxa::PipelineStageFlagBits::BOTTOM_OF_PIPE,
+            .query_index = timer * 2 + 1,
+        });
+    }
+
+    auto GPUTimer::get_time_ms(u32 timer) const -> f32 {
+        return this->times[timer];
+    }
+}
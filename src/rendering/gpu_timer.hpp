@@ -0,0 +1,34 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+
+#include <array>
+#include <vector>
+
+namespace dare {
+    // pairs of timestamps per timer, every frame in flight has a query pool of its own and reads back what that
+    // pool recorded FRAMES_IN_FLIGHT frames ago, which the gpu has finished by then
+    //
+    // reset has to run once per frame at most, it moves on to the next pool
+    struct GPUTimer {
+        GPUTimer(daxa::Device& device, u32 timer_count);
+        ~GPUTimer() = default;
+
+        void reset(daxa::CommandList& cmd_list);
+        void begin(daxa::CommandList& cmd_list, u32 timer);
+        void end(daxa::CommandList& cmd_list, u32 timer);
+
+        auto get_time_ms(u32 timer) const -> f32;
+
+    private:
+        daxa::Device& device;
+        std::array<daxa::TimelineQueryPool, RenderContext::FRAMES_IN_FLIGHT> query_pools;
+        std::array<bool, RenderContext::FRAMES_IN_FLIGHT> has_written = {};
+        usize current_pool = 0;
+        u32 timer_count;
+        f32 timestamp_period;
+        std::vector<f32> times;
+    };
+}
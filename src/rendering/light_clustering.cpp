@@ -0,0 +1,90 @@
+#include "light_clustering.hpp"
+
+#include "../utils/utils.hpp"
+
+#include <cstddef>
+
+namespace dare {
+    LightClustering::LightClustering(RenderContext& context) : context{context} {
+        this->clusters_buffer = this->context.device.create_buffer({
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .size = static_cast<u32>(sizeof(LightClusters)),
+            .debug_name = APPNAME_PREFIX("clusters_buffer"),
+        });
+        this->clusters_buffer_address = this->context.device.get_device_address(this->clusters_buffer);
+
+        for(auto& readback_buffer : this->readback_buffers) {
+            readback_buffer = this->context.device.create_buffer({
+                .memory_flags = daxa::MemoryFlagBits::HOST_ACCESS_RANDOM,
+                .size = static_cast<u32>(sizeof(u32)),
+                .debug_name = APPNAME_PREFIX("clusters_readback_buffer"),
+            });
+        }
+
+        std::string light_clustering_code = file_to_string("./shaders/common/light_clustering.glsl");
+        this->light_clustering_pipeline = this->context.shader_cache->create_compute_pipeline({
+            .shader_info = { .source = daxa::ShaderCode{ light_clustering_code } },
+            .push_constant_size = sizeof(LightClusteringPush),
+            .debug_name = APPNAME_PREFIX("light_clustering_pipeline"),
+        }).value();
+    }
+
+    LightClustering::~LightClustering() {
+        this->context.device.destroy_buffer(this->clusters_buffer);
+        for(auto& readback_buffer : this->readback_buffers) {
+            this->context.device.destroy_buffer(readback_buffer);
+        }
+    }
+
+    void LightClustering::cull_lights(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer, const glm::vec2& size) {
+        this->current_readback = (this->current_readback + 1) % RenderContext::FRAMES_IN_FLIGHT;
+        daxa::BufferId readback_buffer = this->readback_buffers[this->current_readback];
+        if(this->has_written[this->current_readback]) {
+            this->overflow_count = *this->context.device.get_host_address_as<u32>(readback_buffer);
+        }
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::FRAGMENT_SHADER_READ,
+            .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+        });
+
+        cmd_list.clear_buffer({
+            .buffer = this->clusters_buffer,
+            .offset = offsetof(LightClusters, overflow_count),
+            .size = static_cast<u32>(sizeof(u32)),
+            .clear_value = 0,
+        });
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ_WRITE,
+        });
+
+        cmd_list.set_pipeline(this->light_clustering_pipeline);
+        cmd_list.push_constant(LightClusteringPush {
+            .screen_size = { size.x, size.y },
+            .camera_buffer = camera_buffer,
+            .lights_buffer = scene->lights_buffer->buffer_address,
+            .clusters_buffer = this->clusters_buffer_address,
+        });
+        cmd_list.dispatch((CLUSTER_COUNT + LIGHT_CLUSTERING_GROUP_SIZE - 1) / LIGHT_CLUSTERING_GROUP_SIZE, 1, 1);
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::FRAGMENT_SHADER_READ | daxa::AccessConsts::TRANSFER_READ,
+        });
+
+        cmd_list.copy_buffer_to_buffer({
+            .src_buffer = this->clusters_buffer,
+            .src_offset = offsetof(LightClusters, overflow_count),
+            .dst_buffer = readback_buffer,
+            .size = sizeof(u32),
+        });
+
+        cmd_list.pipeline_barrier({
+            .awaited_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::HOST_READ,
+        });
+        this->has_written[this->current_readback] = true;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+#include "../data/scene.hpp"
+
+#include <array>
+
+namespace dare {
+    // every cluster keeps MAX_POINT_LIGHTS_PER_CLUSTER point and MAX_SPOT_LIGHTS_PER_CLUSTER spot lights, the number
+    // of clusters that had to drop one is copied into a readback buffer per frame in flight and read
+    // FRAMES_IN_FLIGHT dispatches later
+    struct LightClustering {
+        LightClustering(RenderContext& context);
+        ~LightClustering();
+
+        void cull_lights(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer, const glm::vec2& size);
+        auto get_overflow_count() const -> u32 { return this->overflow_count; }
+
+        daxa::BufferId clusters_buffer;
+        daxa::BufferDeviceAddress clusters_buffer_address;
+        daxa::ComputePipeline light_clustering_pipeline;
+
+    private:
+        RenderContext& context;
+        std::array<daxa::BufferId, RenderContext::FRAMES_IN_FLIGHT> readback_buffers;
+        std::array<bool, RenderContext::FRAMES_IN_FLIGHT> has_written = {};
+        usize current_readback = 0;
+        u32 overflow_count = 0;
+    };
+}
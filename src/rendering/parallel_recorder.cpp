@@ -0,0 +1,91 @@
+#include "parallel_recorder.hpp"
+
+#include "../utils/utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace dare {
+    ParallelRecorder::ParallelRecorder(daxa::Device& device, ThreadPool& thread_pool) : device{device}, thread_pool{thread_pool} {}
+
+    void ParallelRecorder::begin_frame() {
+        this->command_lists.clear();
+        this->stats = {};
+    }
+
+    void ParallelRecorder::record(daxa::CommandList& cmd_list, const DrawList& draw_list, const DrawPush& push_constant, const PassFunction& pass, const BindFunction& bind_pipeline) {
+        auto start = std::chrono::high_resolution_clock::now();
+        this->stats.passes++;
+
+        auto bind_into = [&](daxa::CommandList& list) -> std::function<void(u32)> {
+            if(!bind_pipeline) {
+                return nullptr;
+            }
+            return [&bind_pipeline, &list](u32 pipeline) { bind_pipeline(list, pipeline); };
+        };
+
+        u32 count = static_cast<u32>(draw_list.items.size());
+        u32 available = this->thread_pool.thread_count();
+        u32 threads = this->thread_count != 0 ? std::min(this->thread_count, available) : available;
+        threads = std::min(threads, std::max(count / std::max(this->min_draws_per_thread, 1u), 1u));
+
+        if(threads == 1) {
+            DrawPush push = push_constant;
+            pass(cmd_list, 0, [&]() { draw_list.record(cmd_list, push, bind_into(cmd_list)); });
+
+            this->stats.threads = std::max(this->stats.threads, 1u);
+            this->stats.record_ms += std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            return;
+        }
+
+        cmd_list.complete();
+        this->command_lists.push_back(std::move(cmd_list));
+
+        // the lists are created up front, workers only record into the list they own
+        u32 chunk = (count + threads - 1) / threads;
+        usize first_list = this->command_lists.size();
+        for(u32 begin = 0; begin < count; begin += chunk) {
+            this->command_lists.push_back(this->device.create_command_list({
+                .debug_name = APPNAME_PREFIX("parallel_cmd_list"),
+            }));
+        }
+
+        std::vector<DrawList::Stats> chunk_stats(this->command_lists.size() - first_list);
+        auto record_chunk = [&](u32 index) {
+            daxa::CommandList& chunk_list = this->command_lists[first_list + index];
+            u32 begin = index * chunk;
+            u32 end = std::min(begin + chunk, count);
+
+            if(index > 0) {
+                chunk_list.pipeline_barrier({
+                    .awaited_pipeline_access = daxa::AccessConsts::ALL_GRAPHICS_READ_WRITE,
+                    .waiting_pipeline_access = daxa::AccessConsts::ALL_GRAPHICS_READ_WRITE,
+                });
+            }
+
+            DrawPush push = push_constant;
+            pass(chunk_list, index, [&]() { draw_list.record_range(chunk_list, push, begin, end - begin, chunk_stats[index], bind_into(chunk_list)); });
+            chunk_list.complete();
+        };
+
+        this->thread_pool.run(static_cast<u32>(chunk_stats.size()), record_chunk);
+
+        for(auto& recorded : chunk_stats) {
+            draw_list.stats.draws += recorded.draws;
+            draw_list.stats.pipeline_binds += recorded.pipeline_binds;
+            draw_list.stats.index_buffer_binds += recorded.index_buffer_binds;
+        }
+
+        cmd_list = this->device.create_command_list({
+            .debug_name = APPNAME_PREFIX("cmd_list"),
+        });
+
+        this->stats.command_lists += static_cast<u32>(chunk_stats.size());
+        this->stats.threads = std::max(this->stats.threads, static_cast<u32>(chunk_stats.size()));
+        this->stats.record_ms += std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    auto ParallelRecorder::take_command_lists() -> std::vector<daxa::CommandList> {
+        return std::move(this->command_lists);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "../../shaders/shared.inl"
+#include "draw_list.hpp"
+#include "../utils/thread_pool.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace dare {
+    // records the draws of a pass on the shared worker threads, every chunk is a contiguous range of the draw list
+    // with its own command list
+    //
+    // a renderpass can not continue in another command list, so every chunk begins the pass again with its
+    // attachments loaded and waits for the attachment writes of the chunk before it, the lists are submitted in
+    // draw list order which keeps the result identical to recording everything on one thread
+    struct ParallelRecorder {
+        // records the pass into the given list and calls draw where the geometry goes, chunk 0 keeps the pass's
+        // own load ops and every later chunk has to load
+        using PassFunction = std::function<void(daxa::CommandList&, u32, const std::function<void()>&)>;
+        // binds the pass's pipeline for DrawItem::pipeline, called inside draw whenever it changes
+        using BindFunction = std::function<void(daxa::CommandList&, u32)>;
+
+        struct Stats {
+            u32 passes = 0;
+            u32 command_lists = 0;
+            u32 threads = 0;
+            f32 record_ms = 0.0f;
+        };
+
+        // 0 uses every thread of the pool, 1 records into the frame's command list
+        u32 thread_count = 0;
+        // chunks with fewer draws are not worth another command list and renderpass
+        u32 min_draws_per_thread = 512;
+        // of the frame recorded last
+        Stats stats = {};
+
+        ParallelRecorder(daxa::Device& device, ThreadPool& thread_pool);
+        ~ParallelRecorder() = default;
+
+        void begin_frame();
+        // cmd_list is completed in front of the chunks and replaced by a fresh list behind them, so everything the
+        // caller records after this ends up after the draws
+        void record(daxa::CommandList& cmd_list, const DrawList& draw_list, const DrawPush& push_constant, const PassFunction& pass, const BindFunction& bind_pipeline = nullptr);
+        // every list completed since begin_frame in submission order, the frame's current list goes behind them
+        auto take_command_lists() -> std::vector<daxa::CommandList>;
+
+    private:
+        daxa::Device& device;
+        ThreadPool& thread_pool;
+        std::vector<daxa::CommandList> command_lists;
+    };
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+namespace dare {
+    // builds the pipelines of a settings permutation on a background thread, the task keeps rendering with the
+    // pipelines it has and poll swaps a finished build in together with the settings it was built for, so render
+    // never mixes the pipelines of one permutation with the code paths of another
+    //
+    // has to be declared after everything build touches, the destructor waits for builds still running
+    template <typename Settings, typename Pipelines>
+    struct PipelineBuilder {
+        using BuildFunction = std::function<Pipelines(const Settings&)>;
+
+        explicit PipelineBuilder(BuildFunction build) : build{std::move(build)} {}
+
+        ~PipelineBuilder() {
+            if(this->pending.valid()) {
+                this->pending.wait();
+            }
+            for(auto& warming : this->warming) {
+                warming.wait();
+            }
+        }
+
+        PipelineBuilder(const PipelineBuilder&) = delete;
+        PipelineBuilder& operator=(const PipelineBuilder&) = delete;
+
+        // builds on the calling thread, for the pipelines a task starts with
+        auto build_now(const Settings& settings) -> Pipelines {
+            return this->build(settings);
+        }
+
+        // a build already running is finished first, of everything requested meanwhile only the latest is built
+        void request(const Settings& settings) {
+            this->queued = settings;
+            this->start_queued();
+        }
+
+        // returns true if a finished build was moved into pipelines and settings
+        auto poll(Pipelines& pipelines, Settings& settings) -> bool {
+            if(!this->pending.valid() || this->pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+
+            bool swapped = false;
+            try {
+                pipelines = this->pending.get();
+                settings = this->pending_settings;
+                swapped = true;
+            } catch(const std::exception& exception) {
+                // the old pipelines stay, the settings are free to be changed again
+                std::cout << "pipeline build failed: " << exception.what() << std::endl;
+            }
+
+            this->start_queued();
+            return swapped;
+        }
+
+        // builds every permutation at once in the background, the pipelines are thrown away and only the shader cache
+        // keeps their binaries, so switching to one of them later does not compile glsl
+        void warm_up(const std::vector<Settings>& permutations) {
+            for(auto& permutation : permutations) {
+                this->warming.push_back(std::async(std::launch::async, [build = this->build, permutation]() {
+                    try {
+                        build(permutation);
+                    } catch(const std::exception&) {}
+                }));
+            }
+        }
+
+        auto is_building() const -> bool {
+            return this->pending.valid() || this->queued.has_value();
+        }
+
+    private:
+        void start_queued() {
+            if(this->pending.valid() || !this->queued.has_value()) {
+                return;
+            }
+
+            this->pending_settings = this->queued.value();
+            this->queued.reset();
+            this->pending = std::async(std::launch::async, this->build, this->pending_settings);
+        }
+
+        BuildFunction build;
+        std::future<Pipelines> pending;
+        Settings pending_settings = {};
+        std::optional<Settings> queued;
+        std::vector<std::future<void>> warming;
+    };
+}
@@ -1,11 +1,34 @@
 #pragma once
 #include <daxa/daxa.hpp>
 
+#include "../graphics/staging_ring.hpp"
+#include "parallel_recorder.hpp"
+#include "shader_cache.hpp"
+#include "../utils/thread_pool.hpp"
+
+#include <memory>
+
+// frames the cpu may record ahead of the gpu, set through the DARE_FRAMES_IN_FLIGHT cache variable
+#ifndef DARE_FRAMES_IN_FLIGHT
+#define DARE_FRAMES_IN_FLIGHT 2
+#endif
+
 namespace dare {
     struct RenderContext {
+        static constexpr usize FRAMES_IN_FLIGHT = DARE_FRAMES_IN_FLIGHT;
+        static_assert(FRAMES_IN_FLIGHT == 2 || FRAMES_IN_FLIGHT == 3, "DARE_FRAMES_IN_FLIGHT has to be 2 or 3");
+
         daxa::Context context = {};
         daxa::Device device = {};
         daxa::Swapchain swapchain = {};
         daxa::PipelineCompiler pipeline_compiler = {};
+        // every pipeline of the renderer is created through this so compiled shaders survive restarts
+        std::unique_ptr<ShaderCache> shader_cache;
+        // workers shared by everything that splits cpu work of the frame
+        std::unique_ptr<ThreadPool> thread_pool;
+        // upload memory of the frame being recorded
+        std::unique_ptr<StagingRing> staging_ring;
+        // splits the cpu submitted draws of a pass over worker threads
+        std::unique_ptr<ParallelRecorder> parallel_recorder;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,371 @@
+#include "shader_cache.hpp"
+
+#include "../utils/utils.hpp"
+
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+namespace dare {
+    // bump whenever the preamble or the compile settings below change, old binaries are then never looked at again
+    static constexpr u32 SHADER_CACHE_VERSION = 1;
+    static constexpr u32 MAX_INCLUDE_DEPTH = 32;
+    static constexpr std::string_view UNSPECIALIZED_FALLBACK_ERROR = "shader cache: glsl fell back to the pipeline compiler, which can not apply specialization constants";
+
+    static auto hash_string(u64 hash, std::string_view string) -> u64 {
+        // fnv-1a
+        for(char c : string) {
+            hash ^= static_cast<u8>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // spir-v opcodes and decorations the specialization patch looks at
+    static constexpr u32 SPIRV_HEADER_WORDS = 5;
+    static constexpr u32 SPIRV_OP_SPEC_CONSTANT_TRUE = 48;
+    static constexpr u32 SPIRV_OP_SPEC_CONSTANT_FALSE = 49;
+    static constexpr u32 SPIRV_OP_SPEC_CONSTANT = 50;
+    static constexpr u32 SPIRV_OP_DECORATE = 71;
+    static constexpr u32 SPIRV_DECORATION_SPEC_ID = 1;
+
+    static auto trim_front(std::string_view line) -> std::string_view {
+        usize first = line.find_first_not_of(" \t");
+        return first == std::string_view::npos ? std::string_view{} : line.substr(first);
+    }
+
+    ShaderCache::ShaderCache(daxa::PipelineCompiler& pipeline_compiler, const std::vector<std::filesystem::path>& root_paths, const std::filesystem::path& cache_folder) : pipeline_compiler{pipeline_compiler}, root_paths{root_paths}, cache_folder{cache_folder} {
+        glslang::InitializeProcess();
+
+        // without the folder every shader is still compiled once per launch and kept in memory
+        std::error_code error;
+        std::filesystem::create_directories(this->cache_folder, error);
+    }
+
+    ShaderCache::~ShaderCache() {
+        glslang::FinalizeProcess();
+    }
+
+    // sets the default value of every spec constant that has an entry in specialization, the module is otherwise
+    // left as it is so the driver still sees regular spec constants
+    static void patch_specialization(std::vector<u32>& spirv, const std::vector<ShaderCache::SpecializationConstant>& specialization) {
+        // decorations come before any constant in a valid module, so one pass sees every spec id in time
+        std::unordered_map<u32, u32> values_by_result_id;
+        for(usize word = SPIRV_HEADER_WORDS; word < spirv.size();) {
+            u32 word_count = spirv[word] >> 16;
+            u32 opcode = spirv[word] & 0xffff;
+            if(word_count == 0 || word + word_count > spirv.size()) {
+                return;
+            }
+
+            if(opcode == SPIRV_OP_DECORATE && word_count >= 4 && spirv[word + 2] == SPIRV_DECORATION_SPEC_ID) {
+                for(auto& constant : specialization) {
+                    if(constant.id == spirv[word + 3]) {
+                        values_by_result_id[spirv[word + 1]] = constant.value;
+                    }
+                }
+            }
+
+            if((opcode == SPIRV_OP_SPEC_CONSTANT_TRUE || opcode == SPIRV_OP_SPEC_CONSTANT_FALSE) && word_count >= 3) {
+                auto it = values_by_result_id.find(spirv[word + 2]);
+                if(it != values_by_result_id.end()) {
+                    spirv[word] = (word_count << 16) | (it->second != 0 ? SPIRV_OP_SPEC_CONSTANT_TRUE : SPIRV_OP_SPEC_CONSTANT_FALSE);
+                }
+            } else if(opcode == SPIRV_OP_SPEC_CONSTANT && word_count >= 4) {
+                auto it = values_by_result_id.find(spirv[word + 2]);
+                if(it != values_by_result_id.end()) {
+                    spirv[word + 3] = it->second;
+                }
+            }
+
+            word += word_count;
+        }
+    }
+
+    auto ShaderCache::create_raster_pipeline(daxa::RasterPipelineInfo info, const std::vector<SpecializationConstant>& specialization) -> daxa::Result<daxa::RasterPipeline> {
+        bool vertex_resolved = this->resolve(info.vertex_shader_info, Stage::VERTEX, specialization);
+        bool fragment_resolved = this->resolve(info.fragment_shader_info, Stage::FRAGMENT, specialization);
+        std::lock_guard lock{this->compiler_mutex};
+        daxa::Result<daxa::RasterPipeline> result = this->pipeline_compiler.create_raster_pipeline(info);
+        if(result.is_ok() && !specialization.empty() && !(vertex_resolved && fragment_resolved)) {
+            return daxa::Result<daxa::RasterPipeline>(std::string_view{UNSPECIALIZED_FALLBACK_ERROR});
+        }
+        return result;
+    }
+
+    auto ShaderCache::create_compute_pipeline(daxa::ComputePipelineInfo info, const std::vector<SpecializationConstant>& specialization) -> daxa::Result<daxa::ComputePipeline> {
+        bool resolved = this->resolve(info.shader_info, Stage::COMPUTE, specialization);
+        std::lock_guard lock{this->compiler_mutex};
+        daxa::Result<daxa::ComputePipeline> result = this->pipeline_compiler.create_compute_pipeline(info);
+        if(result.is_ok() && !specialization.empty() && !resolved) {
+            return daxa::Result<daxa::ComputePipeline>(std::string_view{UNSPECIALIZED_FALLBACK_ERROR});
+        }
+        return result;
+    }
+
+    auto ShaderCache::get_stats() const -> Stats {
+        std::lock_guard lock{this->binaries_mutex};
+        return this->stats;
+    }
+
+    auto ShaderCache::resolve(daxa::ShaderInfo& info, Stage stage, const std::vector<SpecializationConstant>& specialization) -> bool {
+        std::string source;
+        std::filesystem::path directory = ".";
+        if(auto* code = std::get_if<daxa::ShaderCode>(&info.source)) {
+            source = code->string;
+        } else if(auto* file = std::get_if<daxa::ShaderFile>(&info.source)) {
+            std::optional<std::filesystem::path> path = this->find_file(".", file->path.string(), false);
+            if(!path.has_value()) {
+                return false;
+            }
+            source = file_to_string(path->string());
+            directory = path->parent_path();
+        } else {
+            return false;
+        }
+
+        // mirrors what the pipeline compiler puts in front of every shader
+        std::string preamble = "#define DAXA_SHADER 1\n#define DAXA_GLSL 1\n";
+        switch(stage) {
+            case Stage::VERTEX: preamble += "#define DAXA_SHADER_STAGE_VERTEX\n"; break;
+            case Stage::FRAGMENT: preamble += "#define DAXA_SHADER_STAGE_FRAGMENT\n"; break;
+            case Stage::COMPUTE: preamble += "#define DAXA_SHADER_STAGE_COMPUTE\n"; break;
+        }
+        for(auto& define : info.compile_options.defines) {
+            preamble += "#define " + define.name + " " + define.value + "\n";
+        }
+
+        std::unordered_set<std::string> once_files;
+        std::optional<std::string> expanded = this->expand_includes(directory, source, once_files, 0);
+        if(!expanded.has_value()) {
+            return false;
+        }
+
+        const glslang::Version version = glslang::GetVersion();
+        u64 key = 0xcbf29ce484222325ull;
+        key = hash_string(key, std::to_string(SHADER_CACHE_VERSION) + "." + std::to_string(version.major) + "." + std::to_string(version.minor) + "." + std::to_string(version.patch) + version.flavor);
+        key = hash_string(key, std::to_string(static_cast<u32>(stage)));
+        key = hash_string(key, preamble);
+        key = hash_string(key, expanded.value());
+
+        const std::vector<u32>* spirv = this->load_binary(key, preamble, expanded.value(), stage);
+        if(spirv == nullptr) {
+            return false;
+        }
+        if(!specialization.empty()) {
+            spirv = &this->specialize(key, *spirv, specialization);
+        }
+
+        info.source = daxa::ShaderSPIRV{
+            .data = spirv->data(),
+            .size = spirv->size(),
+        };
+        info.compile_options.defines.clear();
+        return true;
+    }
+
+    auto ShaderCache::load_binary(u64 key, const std::string& preamble, const std::string& source, Stage stage) -> const std::vector<u32>* {
+        {
+            std::lock_guard lock{this->binaries_mutex};
+            auto it = this->binaries.find(key);
+            if(it != this->binaries.end()) {
+                this->stats.memory_hits++;
+                return &it->second;
+            }
+        }
+
+        // disk and glslang run unlocked so several pipelines can compile at once, two threads missing the same key
+        // both compile it and the first binary stored wins
+        char file_name[32];
+        std::snprintf(file_name, sizeof(file_name), "%016llx.spv", static_cast<unsigned long long>(key));
+        std::filesystem::path cache_path = this->cache_folder / file_name;
+
+        std::vector<u32> spirv;
+        std::ifstream in(cache_path, std::ios::in | std::ios::binary | std::ios::ate);
+        if(in) {
+            usize size = static_cast<usize>(in.tellg());
+            spirv.resize(size / sizeof(u32));
+            in.seekg(0, std::ios::beg);
+            in.read(reinterpret_cast<char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(u32)));
+            if(!in || size % sizeof(u32) != 0) {
+                spirv.clear();
+            }
+        }
+
+        if(!spirv.empty()) {
+            std::lock_guard lock{this->binaries_mutex};
+            this->stats.disk_hits++;
+        } else {
+            auto start = std::chrono::high_resolution_clock::now();
+            std::optional<std::vector<u32>> compiled = this->compile(preamble, source, stage);
+            f32 compile_ms = std::chrono::duration<f32, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            {
+                std::lock_guard lock{this->binaries_mutex};
+                this->stats.compile_ms += compile_ms;
+                this->stats.compiles++;
+            }
+            if(!compiled.has_value()) {
+                return nullptr;
+            }
+            spirv = std::move(compiled.value());
+
+            // written under a name of this thread first so a crash or a second writer never leaves a truncated
+            // binary behind
+            std::filesystem::path temporary_path = cache_path;
+            temporary_path += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+            std::ofstream out(temporary_path, std::ios::out | std::ios::binary | std::ios::trunc);
+            if(out) {
+                out.write(reinterpret_cast<const char*>(spirv.data()), static_cast<std::streamsize>(spirv.size() * sizeof(u32)));
+                out.close();
+                std::error_code error;
+                std::filesystem::rename(temporary_path, cache_path, error);
+            }
+        }
+
+        std::lock_guard lock{this->binaries_mutex};
+        return &this->binaries.try_emplace(key, std::move(spirv)).first->second;
+    }
+
+    auto ShaderCache::specialize(u64 key, const std::vector<u32>& spirv, const std::vector<SpecializationConstant>& specialization) -> const std::vector<u32>& {
+        // patching is cheap next to a compile, the specialized copies only live in memory
+        for(auto& constant : specialization) {
+            key = hash_string(key, std::to_string(constant.id) + "=" + std::to_string(constant.value) + ";");
+        }
+
+        std::lock_guard lock{this->binaries_mutex};
+        auto it = this->binaries.find(key);
+        if(it != this->binaries.end()) {
+            return it->second;
+        }
+
+        std::vector<u32> specialized = spirv;
+        patch_specialization(specialized, specialization);
+        return this->binaries.try_emplace(key, std::move(specialized)).first->second;
+    }
+
+    auto ShaderCache::expand_includes(const std::filesystem::path& directory, const std::string& source, std::unordered_set<std::string>& once_files, u32 depth) -> std::optional<std::string> {
+        if(depth > MAX_INCLUDE_DEPTH) {
+            return std::nullopt;
+        }
+
+        std::string expanded;
+        expanded.reserve(source.size());
+
+        usize line_start = 0;
+        while(line_start < source.size()) {
+            usize line_end = source.find('\n', line_start);
+            if(line_end == std::string::npos) {
+                line_end = source.size();
+            }
+            std::string_view line = std::string_view{source}.substr(line_start, line_end - line_start);
+            line_start = line_end + 1;
+
+            std::string_view directive = trim_front(line);
+            bool is_directive = directive.starts_with("#");
+            directive = is_directive ? trim_front(directive.substr(1)) : directive;
+
+            // once files are tracked below, glslang does not know the pragma outside of its own includer
+            if(is_directive && directive.starts_with("pragma") && trim_front(directive.substr(6)).starts_with("once")) {
+                continue;
+            }
+
+            if(!is_directive || !directive.starts_with("include")) {
+                expanded += line;
+                expanded += '\n';
+                continue;
+            }
+
+            std::string_view name = trim_front(directive.substr(7));
+            if(name.size() < 2 || (name[0] != '<' && name[0] != '"')) {
+                return std::nullopt;
+            }
+            usize name_end = name.find(name[0] == '<' ? '>' : '"', 1);
+            if(name_end == std::string_view::npos) {
+                return std::nullopt;
+            }
+
+            std::optional<std::filesystem::path> path = this->find_file(directory, std::string{name.substr(1, name_end - 1)}, name[0] == '"');
+            if(!path.has_value()) {
+                return std::nullopt;
+            }
+
+            std::string canonical = std::filesystem::weakly_canonical(path.value()).string();
+            if(once_files.contains(canonical)) {
+                continue;
+            }
+
+            std::string included = file_to_string(path->string());
+            if(included.find("#pragma once") != std::string::npos) {
+                once_files.insert(canonical);
+            }
+
+            std::optional<std::string> expanded_include = this->expand_includes(path->parent_path(), included, once_files, depth + 1);
+            if(!expanded_include.has_value()) {
+                return std::nullopt;
+            }
+            expanded += expanded_include.value();
+            expanded += '\n';
+        }
+
+        return expanded;
+    }
+
+    auto ShaderCache::find_file(const std::filesystem::path& directory, const std::string& name, bool relative_first) const -> std::optional<std::filesystem::path> {
+        if(relative_first && std::filesystem::exists(directory / name)) {
+            return directory / name;
+        }
+
+        for(auto& root : this->root_paths) {
+            if(std::filesystem::exists(root / name)) {
+                return root / name;
+            }
+        }
+
+        if(std::filesystem::exists(name)) {
+            return std::filesystem::path{name};
+        }
+
+        return std::nullopt;
+    }
+
+    auto ShaderCache::compile(const std::string& preamble, const std::string& source, Stage stage) -> std::optional<std::vector<u32>> {
+        EShLanguage language = EShLangVertex;
+        switch(stage) {
+            case Stage::VERTEX: language = EShLangVertex; break;
+            case Stage::FRAGMENT: language = EShLangFragment; break;
+            case Stage::COMPUTE: language = EShLangCompute; break;
+        }
+
+        glslang::TShader shader{language};
+        const char* source_data = source.c_str();
+        shader.setStrings(&source_data, 1);
+        shader.setPreamble(preamble.c_str());
+        shader.setEntryPoint("main");
+        shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+        shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+        shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+        auto messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+        if(!shader.parse(GetDefaultResources(), 460, false, messages)) {
+            std::cout << "shader cache: glslang failed, falling back to the pipeline compiler\n" << shader.getInfoLog() << std::endl;
+            return std::nullopt;
+        }
+
+        glslang::TProgram program;
+        program.addShader(&shader);
+        if(!program.link(messages)) {
+            std::cout << "shader cache: glslang failed to link, falling back to the pipeline compiler\n" << program.getInfoLog() << std::endl;
+            return std::nullopt;
+        }
+
+        std::vector<u32> spirv;
+        glslang::GlslangToSpv(*program.getIntermediate(language), spirv);
+        return spirv;
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace dare {
+    // compiles glsl to spir-v once and keeps the result on disk, a shader is keyed by a hash of its source with every
+    // include expanded, its defines, its stage and the glslang version, so a launch or a permutation switch that hits
+    // the cache never compiles glsl
+    //
+    // shaders glslang rejects are handed to the pipeline compiler as they are, so errors are reported the usual way,
+    // a specialized pipeline fails even if the pipeline compiler accepts the shader since it would ignore the constants
+    //
+    // pipelines can be created from any thread, glsl compiles run in parallel while the pipeline compiler itself is
+    // only entered by one thread at a time
+    //
+    // daxa takes no specialization info, so specialization constants are written into a copy of the cached spir-v
+    // instead, every combination shares one compiled module and the driver folds the constants when creating the
+    // pipeline
+    struct ShaderCache {
+        // value of the layout(constant_id = id) constant, bools are 0 or 1
+        struct SpecializationConstant {
+            u32 id;
+            u32 value;
+        };
+
+        struct Stats {
+            u32 memory_hits = 0;
+            u32 disk_hits = 0;
+            u32 compiles = 0;
+            f32 compile_ms = 0.0f;
+        };
+
+        ShaderCache(daxa::PipelineCompiler& pipeline_compiler, const std::vector<std::filesystem::path>& root_paths, const std::filesystem::path& cache_folder = ".cache/shaders");
+        ~ShaderCache();
+
+        ShaderCache(const ShaderCache&) = delete;
+        ShaderCache& operator=(const ShaderCache&) = delete;
+
+        // the specialization applies to every stage of the pipeline
+        auto create_raster_pipeline(daxa::RasterPipelineInfo info, const std::vector<SpecializationConstant>& specialization = {}) -> daxa::Result<daxa::RasterPipeline>;
+        auto create_compute_pipeline(daxa::ComputePipelineInfo info, const std::vector<SpecializationConstant>& specialization = {}) -> daxa::Result<daxa::ComputePipeline>;
+
+        auto get_stats() const -> Stats;
+
+    private:
+        enum struct Stage {
+            VERTEX,
+            FRAGMENT,
+            COMPUTE,
+        };
+
+        // swaps the glsl source of info for cached spir-v, false leaves info alone when the shader does not compile
+        auto resolve(daxa::ShaderInfo& info, Stage stage, const std::vector<SpecializationConstant>& specialization) -> bool;
+        auto load_binary(u64 key, const std::string& preamble, const std::string& source, Stage stage) -> const std::vector<u32>*;
+        auto specialize(u64 key, const std::vector<u32>& spirv, const std::vector<SpecializationConstant>& specialization) -> const std::vector<u32>&;
+        auto expand_includes(const std::filesystem::path& directory, const std::string& source, std::unordered_set<std::string>& once_files, u32 depth) -> std::optional<std::string>;
+        auto find_file(const std::filesystem::path& directory, const std::string& name, bool relative_first) const -> std::optional<std::filesystem::path>;
+        auto compile(const std::string& preamble, const std::string& source, Stage stage) -> std::optional<std::vector<u32>>;
+
+        daxa::PipelineCompiler& pipeline_compiler;
+        std::vector<std::filesystem::path> root_paths;
+        std::filesystem::path cache_folder;
+        // the pipeline compiler only reads the spir-v while creating the pipeline, it stays here so later hits
+        // do not have to go to disk, entries are never removed so their data does not move
+        std::unordered_map<u64, std::vector<u32>> binaries;
+        Stats stats = {};
+        mutable std::mutex binaries_mutex;
+        std::mutex compiler_mutex;
+    };
+}
@@ -0,0 +1,548 @@
+#include "shadow_atlas.hpp"
+
+#include "frustum_culling.hpp"
+#include "../data/entity.hpp"
+#include "../data/components.hpp"
+#include "../utils/utils.hpp"
+
+#include <imgui.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace dare {
+    static auto aabb_intersects(const std::array<glm::vec4, 6>& planes, const glm::vec3& aabb_min, const glm::vec3& aabb_max) -> bool {
+        glm::vec3 center = (aabb_min + aabb_max) * 0.5f;
+        glm::vec3 extent = (aabb_max - aabb_min) * 0.5f;
+        for(auto& plane : planes) {
+            f32 distance = glm::dot(glm::vec3(plane), center) + plane.w;
+            f32 radius = glm::dot(glm::abs(glm::vec3(plane)), extent);
+            if(distance + radius < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void ShadowAtlas::TileAllocator::reset() {
+        for(auto& tiles : this->free_tiles) {
+            tiles.clear();
+        }
+        this->free_tiles[0].push_back({ 0, 0 });
+    }
+
+    auto ShadowAtlas::TileAllocator::allocate(u32 level, glm::uvec2& tile) -> bool {
+        // smallest free tile that is at least as big, split down to the requested size
+        i32 source = static_cast<i32>(level);
+        while(source >= 0 && this->free_tiles[source].empty()) {
+            source--;
+        }
+        if(source < 0) {
+            return false;
+        }
+
+        tile = this->free_tiles[source].back();
+        this->free_tiles[source].pop_back();
+
+        for(u32 current = static_cast<u32>(source) + 1; current <= level; current++) {
+            u32 size = tile_size(current);
+            this->free_tiles[current].push_back(tile + glm::uvec2(size, 0));
+            this->free_tiles[current].push_back(tile + glm::uvec2(0, size));
+            this->free_tiles[current].push_back(tile + glm::uvec2(size, size));
+        }
+
+        return true;
+    }
+
+    auto ShadowAtlas::TileAllocator::can_allocate(u32 level, u32 count) const -> bool {
+        // every free tile splits into four of the next level
+        u64 available = 0;
+        for(u32 source = 0; source <= level; source++) {
+            available += static_cast<u64>(this->free_tiles[source].size()) << (2 * (level - source));
+        }
+        return available >= count;
+    }
+
+    void ShadowAtlas::TileAllocator::free(u32 level, glm::uvec2 tile) {
+        while(level > 0) {
+            u32 size = tile_size(level);
+            glm::uvec2 parent = tile & glm::uvec2(~(size * 2 - 1));
+            std::array<glm::uvec2, 4> children = { parent, parent + glm::uvec2(size, 0), parent + glm::uvec2(0, size), parent + glm::uvec2(size, size) };
+
+            auto& tiles = this->free_tiles[level];
+            bool siblings_free = true;
+            for(auto& child : children) {
+                if(child != tile && std::find(tiles.begin(), tiles.end(), child) == tiles.end()) {
+                    siblings_free = false;
+                    break;
+                }
+            }
+
+            if(!siblings_free) {
+                break;
+            }
+
+            std::erase_if(tiles, [&](const glm::uvec2& t) { return t != tile && std::find(children.begin(), children.end(), t) != children.end(); });
+            tile = parent;
+            level--;
+        }
+
+        this->free_tiles[level].push_back(tile);
+    }
+
+    ShadowAtlas::ShadowAtlas(RenderContext& context, const std::shared_ptr<BufferPool>& buffer_pool) : context{context} {
+        this->sampler = this->context.device.create_sampler({
+            .magnification_filter = daxa::Filter::NEAREST,
+            .minification_filter = daxa::Filter::NEAREST,
+            .mipmap_filter = daxa::Filter::NEAREST,
+            .address_mode_u = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .address_mode_v = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .address_mode_w = daxa::SamplerAddressMode::CLAMP_TO_EDGE,
+            .mip_lod_bias = 0.0f,
+            .enable_anisotropy = false,
+            .max_anisotropy = 0.0f,
+            .enable_compare = false,
+            .compare_op = daxa::CompareOp::ALWAYS,
+            .min_lod = 0.0f,
+            .max_lod = 0.0f,
+            .enable_unnormalized_coordinates = false,
+        });
+
+        this->atlas_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::D32_SFLOAT,
+            .aspect = daxa::ImageAspectFlagBits::DEPTH,
+            .size = { SHADOW_ATLAS_SIZE, SHADOW_ATLAS_SIZE, 1 },
+            .mip_level_count = 1,
+            .array_layer_count = 1,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY,
+            .debug_name = APPNAME_PREFIX("shadow_atlas_image"),
+        });
+
+        std::string shadow_map_code = file_to_string("./shaders/common/shadow_map.glsl");
+        this->shadow_pipeline = this->context.shader_cache->create_raster_pipeline({
+            .vertex_shader_info = {
+                .source = daxa::ShaderCode{ shadow_map_code },
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+            },
+            .fragment_shader_info = {
+                .source = daxa::ShaderCode{ shadow_map_code },
+                .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+            },
+            .depth_test = {
+                .depth_attachment_format = daxa::Format::D32_SFLOAT,
+                .enable_depth_test = true,
+                .enable_depth_write = true,
+            },
+            .raster = {
+                .polygon_mode = daxa::PolygonMode::FILL,
+                .face_culling = daxa::FaceCullFlagBits::NONE,
+            },
+            .push_constant_size = sizeof(ShadowDrawPush),
+            .debug_name = APPNAME_PREFIX("shadow_atlas_pipeline"),
+        }).value();
+
+        this->shadow_atlas_buffer = std::make_unique<Buffer<ShadowAtlasInfo>>(buffer_pool);
+        this->point_light_views_buffer = std::make_unique<GrowableBuffer<ShadowViewIndex>>(this->context.device, 16, APPNAME_PREFIX("shadow_atlas_point_light_views"));
+        this->spot_light_views_buffer = std::make_unique<GrowableBuffer<ShadowViewIndex>>(this->context.device, 16, APPNAME_PREFIX("shadow_atlas_spot_light_views"));
+        this->gpu_timer = std::make_unique<GPUTimer>(this->context.device, TIMER_COUNT);
+        this->tile_allocator.reset();
+    }
+
+    ShadowAtlas::~ShadowAtlas() {
+        this->context.device.destroy_image(this->atlas_image);
+        this->context.device.destroy_sampler(this->sampler);
+    }
+
+    auto ShadowAtlas::allocate_light(LightShadow& light, u32 level) -> bool {
+        u32 count = light.is_point ? 6 : 1;
+        u64 run = (1ull << count) - 1;
+        u32 first_view = SHADOW_ATLAS_NO_VIEW;
+        for(u32 start = 0; start + count <= SHADOW_ATLAS_MAX_VIEWS; start++) {
+            if((this->view_mask & (run << start)) == 0) {
+                first_view = start;
+                break;
+            }
+        }
+        if(first_view == SHADOW_ATLAS_NO_VIEW) {
+            return false;
+        }
+
+        std::array<glm::uvec2, 6> tiles;
+        for(u32 i = 0; i < count; i++) {
+            if(!this->tile_allocator.allocate(level, tiles[i])) {
+                for(u32 j = 0; j < i; j++) {
+                    this->tile_allocator.free(level, tiles[j]);
+                }
+                return false;
+            }
+        }
+
+        this->view_mask |= run << first_view;
+        light.level = level;
+        light.first_view = first_view;
+        light.view_count = count;
+        light.views = {};
+        for(u32 i = 0; i < count; i++) {
+            light.views[i].tile = tiles[i];
+        }
+        return true;
+    }
+
+    void ShadowAtlas::free_light(LightShadow& light) {
+        if(light.level == INVALID_LEVEL) {
+            return;
+        }
+
+        for(u32 i = 0; i < light.view_count; i++) {
+            this->tile_allocator.free(light.level, light.views[i].tile);
+        }
+        this->view_mask &= ~(((1ull << light.view_count) - 1) << light.first_view);
+
+        light.level = INVALID_LEVEL;
+        light.first_view = SHADOW_ATLAS_NO_VIEW;
+        light.view_count = 0;
+        light.views = {};
+    }
+
+    void ShadowAtlas::update_views(LightShadow& light) {
+        // the near plane scales with the range so the depth precision does not depend on the light's size
+        f32 near_plane = std::max(light.range * 0.01f, 0.05f);
+
+        std::array<glm::mat4, 6> views;
+        glm::mat4 projection;
+        if(light.is_point) {
+            projection = glm::perspectiveRH_ZO(glm::radians(90.0f), 1.0f, near_plane, light.range);
+            // same face order as calculate_point_shadow picks them in
+            views = {
+                glm::lookAt(light.position, light.position + glm::vec3( 1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+                glm::lookAt(light.position, light.position + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+                glm::lookAt(light.position, light.position + glm::vec3(0.0f,  1.0f, 0.0f), glm::vec3(0.0f, 0.0f,  1.0f)),
+                glm::lookAt(light.position, light.position + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
+                glm::lookAt(light.position, light.position + glm::vec3(0.0f, 0.0f,  1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+                glm::lookAt(light.position, light.position + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
+            };
+        } else {
+            projection = glm::perspectiveRH_ZO(light.fov, 1.0f, near_plane, light.range);
+            glm::vec3 up = std::abs(light.direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            views[0] = glm::lookAt(light.position, light.position + light.direction, up);
+        }
+
+        for(u32 i = 0; i < light.view_count; i++) {
+            View& view = light.views[i];
+            view.view_projection = projection * views[i];
+            view.planes = FrustumCulling::extract_planes(view.view_projection);
+            if(view.rendered && view.view_projection != view.rendered_view_projection) {
+                view.stale = true;
+            }
+        }
+    }
+
+    void ShadowAtlas::draw_view(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const LightShadow& light, View& view) {
+        u32 size = tile_size(light.level);
+        cmd_list.begin_renderpass({
+            .depth_attachment = {{
+                .image_view = this->atlas_image.default_view(),
+                .load_op = daxa::AttachmentLoadOp::CLEAR,
+                .clear_value = daxa::DepthValue{1.0f, 0},
+            }},
+            // the render area also limits the clear to the tile
+            .render_area = {.x = static_cast<i32>(view.tile.x), .y = static_cast<i32>(view.tile.y), .width = size, .height = size},
+        });
+        cmd_list.set_pipeline(this->shadow_pipeline);
+        scene->geometry_pool->bind_index_buffer(cmd_list);
+
+        ShadowDrawPush push_constant = {
+            .view_projection = *reinterpret_cast<const f32mat4x4*>(&view.view_projection),
+        };
+
+        scene->bvh.query_frustum(view.planes, [&](entt::entity handle) {
+            Entity entity = { handle, scene.get() };
+            auto& model = entity.get_component<ModelComponent>().model;
+            push_constant.object_buffer = entity.get_component<TransformComponent>().object_info->buffer_address;
+            push_constant.position_buffer = model->position_buffer_address;
+            cmd_list.push_constant(push_constant);
+
+            for(auto& primitive : model->primitives) {
+                model->draw_primitive(cmd_list, primitive);
+            }
+            this->stats.caster_draws++;
+        });
+
+        cmd_list.end_renderpass();
+
+        view.rendered = true;
+        view.stale = false;
+        view.rendered_view_projection = view.view_projection;
+        view.last_render = this->frame_index;
+    }
+
+    void ShadowAtlas::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const Camera3D& camera, const glm::mat4& view) {
+        this->frame_index++;
+        this->stats = {};
+        this->gpu_timer->reset(cmd_list);
+
+        if(!this->enabled) {
+            if(!this->lights.empty()) {
+                this->lights.clear();
+                this->tile_allocator.reset();
+                this->view_mask = 0;
+            }
+            this->shadow_atlas_buffer->update(cmd_list, *this->context.staging_ring, ShadowAtlasInfo { .enabled = 0 });
+            return;
+        }
+
+        glm::vec3 camera_position = glm::vec3(glm::inverse(view)[3]);
+        std::array<glm::vec4, 6> camera_planes = FrustumCulling::extract_planes(camera.proj_mat * view);
+        f32 tan_half_fov = std::tan(glm::radians(camera.fov) * 0.5f);
+
+        auto visit = [&](entt::entity entity, bool is_point, const glm::vec3& position, const glm::vec3& direction, f32 range, f32 fov) {
+            auto [it, inserted] = this->lights.try_emplace(entity);
+            LightShadow& light = it->second;
+            if(!inserted && light.is_point != is_point) {
+                this->free_light(light);
+            }
+
+            light.is_point = is_point;
+            light.position = position;
+            light.direction = glm::length(direction) > 0.0f ? glm::normalize(direction) : glm::vec3(0.0f, -1.0f, 0.0f);
+            light.range = std::max(range, 0.1f);
+            light.fov = fov;
+            light.last_seen = this->frame_index;
+
+            bool visible = true;
+            for(auto& plane : camera_planes) {
+                visible = visible && glm::dot(glm::vec3(plane), position) + plane.w >= -range * glm::length(glm::vec3(plane));
+            }
+
+            // roughly the share of the screen height the light's range covers
+            f32 distance = glm::length(position - camera_position);
+            light.importance = !visible ? 0.0f : distance <= range ? 1.0f : range / (distance * tan_half_fov);
+        };
+
+        for(usize i = 0; i < scene->point_lights.size(); i++) {
+            const PointLight& light = scene->point_lights[i];
+            visit(scene->point_light_entities[i], true, *reinterpret_cast<const glm::vec3*>(&light.position), glm::vec3(0.0f), light.range, 0.0f);
+        }
+
+        for(usize i = 0; i < scene->spot_lights.size(); i++) {
+            const SpotLight& light = scene->spot_lights[i];
+            f32 fov = std::clamp(2.0f * std::acos(std::clamp(light.outer_cut_off, -1.0f, 1.0f)), glm::radians(1.0f), glm::radians(170.0f));
+            visit(scene->spot_light_entities[i], false, *reinterpret_cast<const glm::vec3*>(&light.position), *reinterpret_cast<const glm::vec3*>(&light.direction), light.range, fov);
+        }
+
+        // lights that were destroyed or lost their light component
+        std::erase_if(this->lights, [&](auto& entry) {
+            if(entry.second.last_seen == this->frame_index) {
+                return false;
+            }
+            this->free_light(entry.second);
+            return true;
+        });
+
+        // the most important lights pick their tiles first and may take them from less important ones
+        std::vector<LightShadow*> order;
+        order.reserve(this->lights.size());
+        for(auto& [entity, light] : this->lights) {
+            order.push_back(&light);
+        }
+        std::sort(order.begin(), order.end(), [](const LightShadow* a, const LightShadow* b) { return a->importance > b->importance; });
+
+        for(LightShadow* light : order) {
+            if(light->importance < this->min_importance) {
+                this->free_light(*light);
+                continue;
+            }
+
+            // halving the importance halves the tile, one level of slack keeps tiles from flickering between sizes
+            u32 desired = std::min(this->min_level + static_cast<u32>(std::ceil(std::log2(1.0f / std::min(light->importance, 1.0f)))), TILE_LEVELS - 1);
+            if(light->level != INVALID_LEVEL) {
+                if(std::abs(static_cast<i32>(desired) - static_cast<i32>(light->level)) <= 1) {
+                    continue;
+                }
+                // a light that had to settle for a smaller tile keeps it until a bigger one is actually free,
+                // reallocating clears its views so retrying blindly would redraw them every frame
+                if(light->level > desired && !this->tile_allocator.can_allocate(light->level - 1, light->view_count)) {
+                    continue;
+                }
+            }
+
+            this->free_light(*light);
+            bool placed = false;
+            for(u32 level = desired; level < TILE_LEVELS && !placed; level++) {
+                placed = this->allocate_light(*light, level);
+            }
+            for(auto victim = order.rbegin(); !placed && victim != order.rend() && (*victim)->importance < light->importance; ++victim) {
+                if((*victim)->level != INVALID_LEVEL) {
+                    this->free_light(**victim);
+                    placed = this->allocate_light(*light, desired);
+                }
+            }
+        }
+
+        for(LightShadow* light : order) {
+            if(light->level != INVALID_LEVEL) {
+                this->update_views(*light);
+            }
+        }
+
+        // views a moved caster was or is in have to be redrawn, casters that were added or removed change the
+        // bvh's structure version and every view is redrawn
+        std::vector<std::pair<glm::vec3, glm::vec3>> moved_bounds;
+        bool casters_changed = scene->bvh.get_structure_version() != this->caster_version;
+        this->caster_version = scene->bvh.get_structure_version();
+        if(casters_changed) {
+            std::erase_if(this->caster_bounds, [&](const auto& entry) { return !scene->bvh.contains(entry.first); });
+        }
+
+        scene->iterate([&](Entity entity) {
+            if(!entity.has_component<ModelComponent>() || !entity.get_component<TransformComponent>().has_changed) {
+                return;
+            }
+
+            glm::vec3 aabb_min, aabb_max;
+            if(!scene->bvh.get_bounds(entity.get_handle(), aabb_min, aabb_max)) {
+                return;
+            }
+
+            auto it = this->caster_bounds.find(entity.get_handle());
+            if(it != this->caster_bounds.end()) {
+                moved_bounds.push_back(it->second);
+            }
+            moved_bounds.push_back({ aabb_min, aabb_max });
+            this->caster_bounds[entity.get_handle()] = { aabb_min, aabb_max };
+        });
+
+        struct Candidate {
+            LightShadow* light;
+            View* view;
+            f32 score;
+        };
+        std::vector<Candidate> candidates;
+
+        for(LightShadow* light : order) {
+            for(u32 i = 0; i < light->view_count; i++) {
+                View& view = light->views[i];
+                if(casters_changed) {
+                    view.stale = true;
+                }
+                for(usize b = 0; b < moved_bounds.size() && !view.stale; b++) {
+                    view.stale = aabb_intersects(view.planes, moved_bounds[b].first, moved_bounds[b].second);
+                }
+
+                // empty tiles come first, stale ones gain priority the longer they wait
+                if(!view.rendered) {
+                    candidates.push_back({ light, &view, 1000.0f + light->importance });
+                } else if(view.stale) {
+                    candidates.push_back({ light, &view, light->importance * static_cast<f32>(this->frame_index - view.last_render) });
+                }
+            }
+        }
+
+        usize render_count = std::min<usize>(candidates.size(), this->view_budget);
+        std::partial_sort(candidates.begin(), candidates.begin() + render_count, candidates.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+
+        if(render_count > 0) {
+            this->gpu_timer->begin(cmd_list, ATLAS_TIMER);
+
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::READ,
+                .waiting_pipeline_access = daxa::AccessConsts::EARLY_FRAGMENT_TESTS_READ_WRITE,
+                .before_layout = this->image_initialized ? daxa::ImageLayout::READ_ONLY_OPTIMAL : daxa::ImageLayout::UNDEFINED,
+                .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH},
+                .image_id = this->atlas_image,
+            });
+
+            for(usize i = 0; i < render_count; i++) {
+                this->draw_view(cmd_list, scene, *candidates[i].light, *candidates[i].view);
+            }
+
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::READ,
+                .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH},
+                .image_id = this->atlas_image,
+            });
+
+            this->gpu_timer->end(cmd_list, ATLAS_TIMER);
+            this->image_initialized = true;
+        }
+
+        this->stats.rendered_views = static_cast<u32>(render_count);
+        this->stats.pending_views = static_cast<u32>(candidates.size() - render_count);
+
+        ShadowAtlasInfo info = {
+            .atlas = { .image_view_id = this->atlas_image.default_view(), .sampler_id = this->sampler },
+            .depth_bias = this->depth_bias,
+            .normal_bias = this->normal_bias,
+            .enabled = 1,
+        };
+
+        f32 atlas_size = static_cast<f32>(SHADOW_ATLAS_SIZE);
+        for(LightShadow* light : order) {
+            if(light->level == INVALID_LEVEL) {
+                continue;
+            }
+
+            this->stats.shadowed_lights++;
+            f32 size = static_cast<f32>(tile_size(light->level));
+            f32 fov = light->is_point ? glm::radians(90.0f) : light->fov;
+            for(u32 i = 0; i < light->view_count; i++) {
+                View& view = light->views[i];
+                this->stats.atlas_usage += (size * size) / (atlas_size * atlas_size);
+                if(!view.rendered) {
+                    continue;
+                }
+
+                info.views[light->first_view + i] = ShadowView {
+                    .view_projection = *reinterpret_cast<const f32mat4x4*>(&view.rendered_view_projection),
+                    .atlas_rect = { static_cast<f32>(view.tile.x) / atlas_size, static_cast<f32>(view.tile.y) / atlas_size, size / atlas_size, 0.0f },
+                    .texel_scale = 2.0f * std::tan(fov * 0.5f) / size,
+                };
+            }
+        }
+        this->stats.allocated_views = static_cast<u32>(std::popcount(this->view_mask));
+
+        auto light_views = [&](const std::vector<entt::entity>& entities) {
+            std::vector<ShadowViewIndex> indices(entities.size(), ShadowViewIndex { .value = SHADOW_ATLAS_NO_VIEW });
+            for(usize i = 0; i < entities.size(); i++) {
+                auto it = this->lights.find(entities[i]);
+                if(it != this->lights.end()) {
+                    indices[i].value = it->second.first_view;
+                }
+            }
+            return indices;
+        };
+
+        this->point_light_views_buffer->update(cmd_list, *this->context.staging_ring, light_views(scene->point_light_entities));
+        this->spot_light_views_buffer->update(cmd_list, *this->context.staging_ring, light_views(scene->spot_light_entities));
+        info.point_light_views = this->point_light_views_buffer->buffer_address;
+        info.spot_light_views = this->spot_light_views_buffer->buffer_address;
+
+        this->shadow_atlas_buffer->update(cmd_list, *this->context.staging_ring, info);
+    }
+
+    void ShadowAtlas::render_settings_ui() {
+        if(ImGui::TreeNode("Shadow Atlas")) {
+            ImGui::Checkbox("Point And Spot Light Shadows", &this->enabled);
+            i32 budget = static_cast<i32>(this->view_budget);
+            if(ImGui::SliderInt("Views Per Frame", &budget, 1, SHADOW_ATLAS_MAX_VIEWS)) {
+                this->view_budget = static_cast<u32>(budget);
+            }
+            ImGui::SliderFloat("Min Importance", &this->min_importance, 0.0f, 0.5f);
+            ImGui::SliderFloat("Atlas Depth Bias", &this->depth_bias, 0.0f, 0.001f, "%.6f");
+            ImGui::SliderFloat("Atlas Normal Bias", &this->normal_bias, 0.0f, 4.0f);
+            ImGui::Text("Shadowed Lights: %u, views %u / %u", this->stats.shadowed_lights, this->stats.allocated_views, SHADOW_ATLAS_MAX_VIEWS);
+            ImGui::Text("Views: %u rendered, %u waiting", this->stats.rendered_views, this->stats.pending_views);
+            ImGui::Text("Caster Draws: %u", this->stats.caster_draws);
+            ImGui::Text("Atlas Usage: %.1f%%", this->stats.atlas_usage * 100.0f);
+            ImGui::Text("Shadow Atlas: %.3f ms", this->gpu_timer->get_time_ms(ATLAS_TIMER));
+            ImGui::TreePop();
+        }
+    }
+}
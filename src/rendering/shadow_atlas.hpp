@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <entt/entt.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "render_context.hpp"
+#include "gpu_timer.hpp"
+#include "../data/scene.hpp"
+#include "../graphics/camera.hpp"
+#include "../graphics/buffer.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace dare {
+    // shadows of point and spot lights, every light view gets a square tile of one shared depth atlas
+    //
+    // tiles come from a quadtree so different sizes can be mixed, a light's tile size follows how big its range
+    // looks on screen and lights outside the view frustum give their tiles back
+    //
+    // a view keeps its depth until its light changes or a caster inside it moves, views that need a redraw are
+    // ranked by importance and how long they have waited and only the best few are rendered each frame, until then
+    // the shading passes keep sampling the old depth with the old matrix
+    struct ShadowAtlas {
+        // 4096 down to 128 texels
+        static constexpr u32 TILE_LEVELS = 6;
+        static constexpr u32 INVALID_LEVEL = TILE_LEVELS;
+
+        struct Stats {
+            u32 shadowed_lights = 0;
+            u32 allocated_views = 0;
+            u32 rendered_views = 0;
+            u32 pending_views = 0;
+            u32 caster_draws = 0;
+            // share of the atlas covered by tiles
+            f32 atlas_usage = 0.0f;
+        };
+
+        bool enabled = true;
+        // view renders per frame, everything else waits for a later frame
+        u32 view_budget = 6;
+        // level of the biggest tile a single light can get
+        u32 min_level = 2;
+        // lights whose range covers less of the screen than this get no shadow
+        f32 min_importance = 0.02f;
+        f32 depth_bias = 0.00002f;
+        f32 normal_bias = 1.5f;
+        Stats stats = {};
+
+        ShadowAtlas(RenderContext& context, const std::shared_ptr<BufferPool>& buffer_pool);
+        ~ShadowAtlas();
+
+        // has to run after the scene uploaded its lights this frame, the atlas is left in READ_ONLY_OPTIMAL
+        void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const Camera3D& camera, const glm::mat4& view);
+        void render_settings_ui();
+
+        std::unique_ptr<Buffer<ShadowAtlasInfo>> shadow_atlas_buffer;
+
+    private:
+        struct View {
+            glm::mat4 view_projection = glm::mat4(1.0f);
+            // what the tile currently holds, the shading passes keep using it until the next render
+            glm::mat4 rendered_view_projection = glm::mat4(1.0f);
+            std::array<glm::vec4, 6> planes = {};
+            glm::uvec2 tile = { 0, 0 };
+            bool rendered = false;
+            bool stale = false;
+            u64 last_render = 0;
+        };
+
+        struct LightShadow {
+            bool is_point = false;
+            glm::vec3 position = glm::vec3(0.0f);
+            glm::vec3 direction = glm::vec3(0.0f);
+            f32 range = 0.0f;
+            f32 fov = 0.0f;
+            f32 importance = 0.0f;
+            u32 level = INVALID_LEVEL;
+            u32 first_view = SHADOW_ATLAS_NO_VIEW;
+            u32 view_count = 0;
+            std::array<View, 6> views = {};
+            u64 last_seen = 0;
+        };
+
+        // quadtree of free tiles per level, four free siblings merge back into their parent
+        struct TileAllocator {
+            std::array<std::vector<glm::uvec2>, TILE_LEVELS> free_tiles;
+
+            void reset();
+            auto allocate(u32 level, glm::uvec2& tile) -> bool;
+            // whether count tiles of the level are free right now, split or not
+            auto can_allocate(u32 level, u32 count) const -> bool;
+            void free(u32 level, glm::uvec2 tile);
+        };
+
+        auto allocate_light(LightShadow& light, u32 level) -> bool;
+        void free_light(LightShadow& light);
+        void update_views(LightShadow& light);
+        void draw_view(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const LightShadow& light, View& view);
+
+        static auto tile_size(u32 level) -> u32 { return SHADOW_ATLAS_SIZE >> level; }
+
+        std::unordered_map<entt::entity, LightShadow> lights;
+        TileAllocator tile_allocator;
+        // one bit per entry of ShadowAtlasInfo::views
+        u64 view_mask = 0;
+        u64 frame_index = 0;
+        // bounds every moved caster had when it was last seen moving, so the views it left are redrawn as well
+        std::unordered_map<entt::entity, std::pair<glm::vec3, glm::vec3>> caster_bounds;
+        // structure version of the scene's bvh the views were last checked against
+        u64 caster_version = 0;
+
+        std::unique_ptr<GrowableBuffer<ShadowViewIndex>> point_light_views_buffer;
+        std::unique_ptr<GrowableBuffer<ShadowViewIndex>> spot_light_views_buffer;
+
+        daxa::ImageId atlas_image = {};
+        daxa::SamplerId sampler;
+        bool image_initialized = false;
+
+        enum Timers : u32 {
+            ATLAS_TIMER,
+            TIMER_COUNT
+        };
+
+        daxa::RasterPipeline shadow_pipeline;
+        std::unique_ptr<GPUTimer> gpu_timer;
+        RenderContext& context;
+    };
+}
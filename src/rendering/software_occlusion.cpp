@@ -0,0 +1,275 @@
+#include "software_occlusion.hpp"
+
+#include "../data/entity.hpp"
+#include "../data/components.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dare {
+    SoftwareOcclusion::SoftwareOcclusion() {
+        this->depth.assign(WIDTH * HEIGHT, 1.0f);
+        this->tile_max_depth.assign(TILES_X * TILES_Y, 1.0f);
+    }
+
+    void SoftwareOcclusion::cull(const std::shared_ptr<Scene>& scene, const glm::mat4& view_projection, DrawList& draw_list) {
+        draw_list.occluded_count = 0;
+        if(!this->enabled) {
+            return;
+        }
+
+        this->begin(view_projection);
+
+        scene->iterate([&](Entity entity){
+            if(entity.has_component<OccluderComponent>()) {
+                auto& occluder = entity.get_component<OccluderComponent>();
+                auto& transform = entity.get_component<TransformComponent>();
+
+                if(!occluder.vertices.empty()) {
+                    this->add_occluder(occluder.vertices, occluder.indices, transform.model_matrix);
+                } else if(entity.has_component<ModelComponent>()) {
+                    auto& model = entity.get_component<ModelComponent>().model;
+                    this->add_occluder(model->cpu_positions, model->cpu_indices, transform.model_matrix);
+                }
+            }
+        });
+
+        if(this->triangles.empty()) {
+            return;
+        }
+
+        this->rasterize();
+
+        auto& items = draw_list.items;
+        this->visible.assign(items.size(), 1);
+        this->parallel_for(static_cast<u32>(items.size()), [&](u32 begin, u32 end) {
+            for(u32 i = begin; i < end; i++) {
+                this->visible[i] = static_cast<u8>(this->is_visible(items[i].aabb_center, items[i].aabb_extent));
+            }
+        });
+
+        usize visible_count = 0;
+        for(usize i = 0; i < items.size(); i++) {
+            if(this->visible[i]) {
+                items[visible_count++] = items[i];
+            }
+        }
+
+        draw_list.occluded_count = static_cast<u32>(items.size() - visible_count);
+        draw_list.visible_count = static_cast<u32>(visible_count);
+        items.resize(visible_count);
+    }
+
+    void SoftwareOcclusion::begin(const glm::mat4& view_projection) {
+        this->view_projection = view_projection;
+        this->triangles.clear();
+        this->occluder_triangle_count = 0;
+    }
+
+    void SoftwareOcclusion::add_occluder(const std::vector<glm::vec3>& vertices, const std::vector<u32>& indices, const glm::mat4& model_matrix) {
+        glm::mat4 model_view_projection = this->view_projection * model_matrix;
+
+        this->clip_vertices.resize(vertices.size());
+        for(usize i = 0; i < vertices.size(); i++) {
+            this->clip_vertices[i] = model_view_projection * glm::vec4(vertices[i], 1.0f);
+        }
+
+        for(usize i = 0; i + 2 < indices.size(); i += 3) {
+            ScreenTriangle triangle;
+            bool clipped = false;
+
+            for(u32 v = 0; v < 3; v++) {
+                const glm::vec4& clip = this->clip_vertices[indices[i + v]];
+                // dropping a triangle only ever makes the culler more conservative, so the near plane is not clipped
+                if(clip.w <= 0.0f || clip.z < 0.0f) {
+                    clipped = true;
+                    break;
+                }
+
+                glm::vec3 ndc = glm::vec3(clip) / clip.w;
+                triangle.vertices[v] = { (ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z };
+            }
+
+            if(clipped) {
+                continue;
+            }
+
+            triangle.min = glm::min(glm::vec2(triangle.vertices[0]), glm::min(glm::vec2(triangle.vertices[1]), glm::vec2(triangle.vertices[2])));
+            triangle.max = glm::max(glm::vec2(triangle.vertices[0]), glm::max(glm::vec2(triangle.vertices[1]), glm::vec2(triangle.vertices[2])));
+            if(triangle.max.x < 0.0f || triangle.max.y < 0.0f || triangle.min.x >= WIDTH || triangle.min.y >= HEIGHT) {
+                continue;
+            }
+
+            this->triangles.push_back(triangle);
+        }
+
+        this->occluder_triangle_count = static_cast<u32>(this->triangles.size());
+    }
+
+    void SoftwareOcclusion::rasterize() {
+        std::fill(this->depth.begin(), this->depth.end(), 1.0f);
+
+        this->parallel_for(TILES_Y, [&](u32 first_tile_row, u32 last_tile_row) {
+            f32 first_row = static_cast<f32>(first_tile_row * TILE_SIZE);
+            f32 last_row = static_cast<f32>(last_tile_row * TILE_SIZE);
+
+            for(auto& triangle : this->triangles) {
+                if(triangle.max.y >= first_row && triangle.min.y < last_row) {
+                    this->rasterize_triangle(triangle, first_tile_row * TILE_SIZE, last_tile_row * TILE_SIZE);
+                }
+            }
+
+            for(u32 tile = first_tile_row * TILES_X; tile < last_tile_row * TILES_X; tile++) {
+                const f32* tile_depth = &this->depth[tile * TILE_SIZE * TILE_SIZE];
+                this->tile_max_depth[tile] = *std::max_element(tile_depth, tile_depth + TILE_SIZE * TILE_SIZE);
+            }
+        });
+    }
+
+    void SoftwareOcclusion::rasterize_triangle(const ScreenTriangle& triangle, u32 first_row, u32 last_row) {
+        const auto& v = triangle.vertices;
+        f32 area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+        if(std::abs(area) < 1e-6f) {
+            return;
+        }
+
+        // occluders are rasterized from both sides, flipping the edges keeps the inside positive for either winding
+        f32 orientation = area > 0.0f ? 1.0f : -1.0f;
+        auto edge = [&](u32 a, u32 b) -> glm::vec3 {
+            return glm::vec3(v[a].y - v[b].y, v[b].x - v[a].x, v[a].x * v[b].y - v[b].x * v[a].y) * orientation;
+        };
+
+        // the edge opposite to a vertex evaluates to that vertex's barycentric weight times the area
+        glm::vec3 edges[3] = { edge(1, 2), edge(2, 0), edge(0, 1) };
+        f32 inverse_area = 1.0f / std::abs(area);
+        glm::vec3 depth_plane = (edges[0] * v[0].z + edges[1] * v[1].z + edges[2] * v[2].z) * inverse_area;
+
+        u32 x_begin = static_cast<u32>(std::max(std::floor(triangle.min.x), 0.0f));
+        u32 x_end = static_cast<u32>(std::min(std::ceil(triangle.max.x), static_cast<f32>(WIDTH)));
+        u32 y_begin = std::max(static_cast<u32>(std::max(std::floor(triangle.min.y), 0.0f)), first_row);
+        u32 y_end = std::min(static_cast<u32>(std::min(std::ceil(triangle.max.y), static_cast<f32>(HEIGHT))), last_row);
+        if(x_begin >= x_end || y_begin >= y_end) {
+            return;
+        }
+
+#if defined(__AVX2__)
+        __m256 lane_offsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+#endif
+
+        for(u32 y = y_begin; y < y_end; y++) {
+            f32 pixel_y = static_cast<f32>(y) + 0.5f;
+            f32 row_edges[3] = {
+                edges[0].y * pixel_y + edges[0].z,
+                edges[1].y * pixel_y + edges[1].z,
+                edges[2].y * pixel_y + edges[2].z,
+            };
+            f32 row_depth = depth_plane.y * pixel_y + depth_plane.z;
+
+            for(u32 tile_x = x_begin / TILE_SIZE; tile_x <= (x_end - 1) / TILE_SIZE; tile_x++) {
+                u32 base_x = tile_x * TILE_SIZE;
+                f32* row = &this->depth[pixel_index(base_x, y)];
+
+#if defined(__AVX2__)
+                __m256 pixel_x = _mm256_add_ps(_mm256_set1_ps(static_cast<f32>(base_x)), lane_offsets);
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for(u32 i = 0; i < 3; i++) {
+                    __m256 weight = _mm256_add_ps(_mm256_mul_ps(pixel_x, _mm256_set1_ps(edges[i].x)), _mm256_set1_ps(row_edges[i]));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(weight, _mm256_setzero_ps(), _CMP_GE_OQ));
+                }
+
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(pixel_x, _mm256_set1_ps(depth_plane.x)), _mm256_set1_ps(row_depth));
+                __m256 current = _mm256_loadu_ps(row);
+                _mm256_storeu_ps(row, _mm256_blendv_ps(current, _mm256_min_ps(current, z), inside));
+#else
+                for(u32 lane = 0; lane < TILE_SIZE; lane++) {
+                    f32 pixel_x = static_cast<f32>(base_x + lane) + 0.5f;
+                    bool inside = true;
+                    for(u32 i = 0; i < 3; i++) {
+                        inside = inside && (edges[i].x * pixel_x + row_edges[i] >= 0.0f);
+                    }
+
+                    if(inside) {
+                        row[lane] = std::min(row[lane], depth_plane.x * pixel_x + row_depth);
+                    }
+                }
+#endif
+            }
+        }
+    }
+
+    auto SoftwareOcclusion::is_visible(const glm::vec3& center, const glm::vec3& extent) const -> bool {
+        glm::vec2 screen_min = glm::vec2(std::numeric_limits<f32>::max());
+        glm::vec2 screen_max = glm::vec2(std::numeric_limits<f32>::lowest());
+        f32 nearest_depth = 1.0f;
+
+        for(u32 i = 0; i < 8; i++) {
+            glm::vec3 corner = center + extent * glm::vec3((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f);
+            glm::vec4 clip = this->view_projection * glm::vec4(corner, 1.0f);
+            // boxes crossing the near plane can not be projected, keep them
+            if(clip.w <= 0.0f || clip.z < 0.0f) {
+                return true;
+            }
+
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            glm::vec2 screen = { (ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT };
+            screen_min = glm::min(screen_min, screen);
+            screen_max = glm::max(screen_max, screen);
+            nearest_depth = std::min(nearest_depth, ndc.z);
+        }
+
+        u32 x_begin = static_cast<u32>(std::clamp(std::floor(screen_min.x), 0.0f, static_cast<f32>(WIDTH)));
+        u32 x_end = static_cast<u32>(std::clamp(std::ceil(screen_max.x), 0.0f, static_cast<f32>(WIDTH)));
+        u32 y_begin = static_cast<u32>(std::clamp(std::floor(screen_min.y), 0.0f, static_cast<f32>(HEIGHT)));
+        u32 y_end = static_cast<u32>(std::clamp(std::ceil(screen_max.y), 0.0f, static_cast<f32>(HEIGHT)));
+        // off screen is the frustum culler's call
+        if(x_begin >= x_end || y_begin >= y_end) {
+            return true;
+        }
+
+        for(u32 tile_y = y_begin / TILE_SIZE; tile_y <= (y_end - 1) / TILE_SIZE; tile_y++) {
+            for(u32 tile_x = x_begin / TILE_SIZE; tile_x <= (x_end - 1) / TILE_SIZE; tile_x++) {
+                // the whole tile is in front of the box
+                if(nearest_depth > this->tile_max_depth[tile_y * TILES_X + tile_x]) {
+                    continue;
+                }
+
+                u32 pixel_x_end = std::min(x_end, (tile_x + 1) * TILE_SIZE);
+                u32 pixel_y_end = std::min(y_end, (tile_y + 1) * TILE_SIZE);
+                for(u32 y = std::max(y_begin, tile_y * TILE_SIZE); y < pixel_y_end; y++) {
+                    for(u32 x = std::max(x_begin, tile_x * TILE_SIZE); x < pixel_x_end; x++) {
+                        if(nearest_depth <= this->depth[pixel_index(x, y)]) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void SoftwareOcclusion::parallel_for(u32 count, const std::function<void(u32, u32)>& function) const {
+        if(count == 0) {
+            return;
+        }
+
+        u32 available = this->thread_pool != nullptr ? this->thread_pool->thread_count() : 1;
+        u32 threads = this->thread_count != 0 ? std::min(this->thread_count, available) : available;
+        threads = std::min(threads, count);
+        if(threads == 1) {
+            function(0, count);
+            return;
+        }
+
+        u32 chunk = (count + threads - 1) / threads;
+        this->thread_pool->run((count + chunk - 1) / chunk, [&](u32 index) {
+            u32 begin = index * chunk;
+            function(begin, std::min(begin + chunk, count));
+        });
+    }
+}
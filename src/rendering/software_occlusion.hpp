@@ -0,0 +1,67 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+#include "../data/scene.hpp"
+#include "draw_list.hpp"
+#include "../utils/thread_pool.hpp"
+
+#include <array>
+#include <functional>
+
+namespace dare {
+    // rasterizes the designated occluders into a small depth buffer on the cpu and drops the draw items hidden behind
+    // them, for when there is no gpu driven culling to lean on
+    //
+    // the buffer is stored in 8x8 tiles so one tile row is one AVX2 register, every tile keeps its farthest depth as a
+    // coarse level for the tests, threads own whole tile rows so each pixel is written by exactly one thread and the
+    // result does not depend on the thread count
+    struct SoftwareOcclusion {
+        static constexpr u32 WIDTH = 256;
+        static constexpr u32 HEIGHT = 144;
+        static constexpr u32 TILE_SIZE = 8;
+        static constexpr u32 TILES_X = WIDTH / TILE_SIZE;
+        static constexpr u32 TILES_Y = HEIGHT / TILE_SIZE;
+
+        bool enabled = true;
+        // shared workers, without a pool everything runs on the calling thread
+        ThreadPool* thread_pool = nullptr;
+        // 0 uses every thread of the pool
+        u32 thread_count = 0;
+        u32 occluder_triangle_count = 0;
+
+        SoftwareOcclusion();
+
+        void cull(const std::shared_ptr<Scene>& scene, const glm::mat4& view_projection, DrawList& draw_list);
+
+        // the steps of cull, usable on their own without a scene or a device
+        void begin(const glm::mat4& view_projection);
+        void add_occluder(const std::vector<glm::vec3>& vertices, const std::vector<u32>& indices, const glm::mat4& model_matrix);
+        void rasterize();
+        auto is_visible(const glm::vec3& center, const glm::vec3& extent) const -> bool;
+
+        auto get_depth(u32 x, u32 y) const -> f32 { return this->depth[pixel_index(x, y)]; }
+
+    private:
+        struct ScreenTriangle {
+            std::array<glm::vec3, 3> vertices;
+            glm::vec2 min;
+            glm::vec2 max;
+        };
+
+        static auto pixel_index(u32 x, u32 y) -> u32 {
+            return ((y / TILE_SIZE) * TILES_X + x / TILE_SIZE) * TILE_SIZE * TILE_SIZE + (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE;
+        }
+
+        void rasterize_triangle(const ScreenTriangle& triangle, u32 first_row, u32 last_row);
+        void parallel_for(u32 count, const std::function<void(u32, u32)>& function) const;
+
+        glm::mat4 view_projection = glm::mat4(1.0f);
+        std::vector<ScreenTriangle> triangles;
+        std::vector<glm::vec4> clip_vertices;
+        std::vector<f32> depth;
+        std::vector<f32> tile_max_depth;
+        std::vector<u8> visible;
+    };
+}
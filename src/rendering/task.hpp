@@ -7,18 +7,23 @@ using namespace daxa::types;
 #include "../data/scene.hpp"
 #include "../data/entity.hpp"
 #include "../data/components.hpp"
+#include "draw_list.hpp"
+
+#include <vector>
 
 namespace dare {
     struct Task { 
         Task(RenderContext& context);
         virtual ~Task();
 
-        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, daxa::BufferDeviceAddress camera_buffer) = 0;
+        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) = 0;
         virtual void resize(u32 sx, u32 sy) = 0;
 
         virtual void render_settings_ui() = 0;
         virtual auto settings_to_string()-> std::string = 0;
         virtual void rebuild_pipeline() = 0;
+        // false while the task culls and submits its draws on the gpu, the frame then skips building the draw list
+        virtual auto uses_draw_list() -> bool { return true; }
         
         virtual auto get_color_image() -> daxa::ImageId = 0;
         virtual auto get_depth_image() -> daxa::ImageId = 0;
@@ -27,4 +32,32 @@ namespace dare {
         glm::vec2 size{800, 600};
         RenderContext& context;
     };
+
+    // texturing, shading model and normal mapping of a task's settings as the specialization constants of shared.inl,
+    // only the draw submission and pass layout are still compiled in through defines
+    template <typename Settings>
+    auto settings_to_specialization(const Settings& settings) -> std::vector<ShaderCache::SpecializationConstant> {
+        u32 texturing = TEXTURING_MODE_NONE;
+        if(settings.texturing.vertex_color) { texturing = TEXTURING_MODE_VERTEX_COLOR; }
+        if(settings.texturing.albedo) { texturing = TEXTURING_MODE_ALBEDO; }
+
+        u32 shading_model = SHADING_MODEL_NONE;
+        if(settings.shading_model.lambertian) { shading_model = SHADING_MODEL_LAMBERTIAN; }
+        if(settings.shading_model.phong) { shading_model = SHADING_MODEL_PHONG; }
+        if(settings.shading_model.blinn_phong) { shading_model = SHADING_MODEL_BLINN_PHONG; }
+        if(settings.shading_model.gaussian) { shading_model = SHADING_MODEL_GAUSSIAN; }
+
+        u32 normal_mapping = NORMAL_MAPPING_MODE_NONE;
+        if(settings.normal_mappings.using_tangents) { normal_mapping = NORMAL_MAPPING_MODE_USING_TANGENTS; }
+        if constexpr(requires { settings.normal_mappings.calculating_TBN_vectors; }) {
+            if(settings.normal_mappings.calculating_TBN_vectors) { normal_mapping = NORMAL_MAPPING_MODE_CALCULATING_TBN_VECTORS; }
+        }
+
+        return {
+            { .id = SPECIALIZATION_TEXTURING_MODE, .value = texturing },
+            { .id = SPECIALIZATION_SHADING_MODEL, .value = shading_model },
+            { .id = SPECIALIZATION_NORMAL_MAPPING_MODE, .value = normal_mapping },
+            { .id = SPECIALIZATION_REORTHOGONALIZE_TBN, .value = settings.normal_mappings.reorthogonalize_TBN_vectors ? 1u : 0u },
+        };
+    }
 }
\ No newline at end of file
@@ -0,0 +1,436 @@
+#include "visibility_buffer.hpp"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace dare {
+    VisibilityBuffer::VisibilityBuffer(RenderContext& context) : Task(context) {
+        create_images(static_cast<u32>(this->size.x), static_cast<u32>(this->size.y));
+
+        this->sampler = this->context.device.create_sampler({
+            .magnification_filter = daxa::Filter::LINEAR,
+            .minification_filter = daxa::Filter::LINEAR,
+            .mipmap_filter = daxa::Filter::LINEAR,
+            .address_mode_u = daxa::SamplerAddressMode::REPEAT,
+            .address_mode_v = daxa::SamplerAddressMode::REPEAT,
+            .address_mode_w = daxa::SamplerAddressMode::REPEAT,
+            .mip_lod_bias = 0.0f,
+            .enable_anisotropy = true,
+            .max_anisotropy = 16.0f,
+            .enable_compare = false,
+            .compare_op = daxa::CompareOp::ALWAYS,
+            .min_lod = 0.0f,
+            .max_lod = static_cast<f32>(1),
+            .enable_unnormalized_coordinates = false,
+        });
+
+        this->draw_info_buffer = std::make_unique<GrowableBuffer<VisibilityDrawInfo>>(this->context.device, 64, APPNAME_PREFIX("visibility_draw_info_buffer"));
+        this->light_clustering = std::make_unique<LightClustering>(context);
+        this->gpu_timer = std::make_unique<GPUTimer>(this->context.device, TIMER_COUNT);
+
+        rebuild_pipeline();
+    }
+
+    VisibilityBuffer::~VisibilityBuffer() {
+        destroy_images();
+        this->context.device.destroy_sampler(sampler);
+    }
+
+    void VisibilityBuffer::create_images(u32 sx, u32 sy) {
+        this->color_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::R16G16B16A16_SFLOAT,
+            .aspect = daxa::ImageAspectFlagBits::COLOR,
+            .size = { sx, sy, 1 },
+            .mip_level_count = 1,
+            .array_layer_count = 1,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::SHADER_READ_ONLY | daxa::ImageUsageFlagBits::SHADER_READ_WRITE,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
+        });
+
+        this->visibility_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::R32_UINT,
+            .aspect = daxa::ImageAspectFlagBits::COLOR,
+            .size = { sx, sy, 1 },
+            .mip_level_count = 1,
+            .array_layer_count = 1,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::COLOR_ATTACHMENT | daxa::ImageUsageFlagBits::SHADER_READ_ONLY,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
+        });
+
+        this->depth_image = this->context.device.create_image({
+            .dimensions = 2,
+            .format = daxa::Format::D24_UNORM_S8_UINT,
+            .aspect = daxa::ImageAspectFlagBits::DEPTH | daxa::ImageAspectFlagBits::STENCIL,
+            .size = { sx, sy, 1 },
+            .mip_level_count = 1,
+            .array_layer_count = 1,
+            .sample_count = 1,
+            .usage = daxa::ImageUsageFlagBits::DEPTH_STENCIL_ATTACHMENT,
+            .memory_flags = daxa::MemoryFlagBits::DEDICATED_MEMORY
+        });
+    }
+
+    void VisibilityBuffer::destroy_images() {
+        this->context.device.destroy_image(this->color_image);
+        this->context.device.destroy_image(this->visibility_image);
+        this->context.device.destroy_image(this->depth_image);
+    }
+
+    void VisibilityBuffer::render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) {
+        struct VisibilityDraw {
+            Model* model;
+            u32 first;
+            u32 count;
+            bool indexed;
+        };
+
+        std::vector<VisibilityDrawInfo> draw_infos;
+        std::vector<VisibilityDraw> draws;
+
+        // the triangle part of the id has VISIBILITY_TRIANGLE_BITS, larger primitives are drawn in chunks that
+        // each get a draw of their own and so count their triangles from zero again
+        constexpr u32 max_chunk_vertices = (1u << VISIBILITY_TRIANGLE_BITS) * 3;
+        for(auto& item : draw_list.items) {
+            bool indexed = item.primitive->index_count > 0;
+            u32 vertex_count = indexed ? item.primitive->index_count : item.primitive->vertex_count;
+            for(u32 offset = 0; offset < vertex_count; offset += max_chunk_vertices) {
+                draw_infos.push_back(VisibilityDrawInfo {
+                    .object_buffer = item.object_buffer,
+                    .vertex_buffer = item.model->vertex_buffer_address,
+                    .position_buffer = item.model->position_buffer_address,
+                    .index_buffer = item.model->index_buffer_address,
+                    .material_info_buffer = item.model->material_buffers[item.primitive->material_index]->buffer_address,
+                    .first_index = item.primitive->first_index + (indexed ? offset : 0),
+                    .first_vertex = item.primitive->first_vertex + (indexed ? 0 : offset),
+                    .indexed = indexed ? 1u : 0u,
+                });
+                draws.push_back({
+                    .model = item.model,
+                    .first = indexed ? item.primitive->first_index + offset : item.primitive->first_vertex + offset,
+                    .count = std::min(vertex_count - offset, max_chunk_vertices),
+                    .indexed = indexed,
+                });
+            }
+        }
+
+        // the draw part of the id only has room for VISIBILITY_MAX_DRAWS draws, more draws are split into batches,
+        // every batch keeps the depth of the previous ones and resolves the pixels it ended up covering
+        u32 draw_count = static_cast<u32>(draws.size());
+        this->batch_count = std::max((draw_count + VISIBILITY_MAX_DRAWS - 1) / VISIBILITY_MAX_DRAWS, 1u);
+
+        this->gpu_timer->reset(cmd_list);
+
+        this->draw_info_buffer->update(cmd_list, *this->context.staging_ring, draw_infos);
+        this->light_clustering->cull_lights(cmd_list, scene, camera_buffer, this->size);
+
+        cmd_list.pipeline_barrier_image_transition({
+            .waiting_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
+            .before_layout = daxa::ImageLayout::UNDEFINED,
+            .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+            .image_id = this->visibility_image,
+        });
+
+        cmd_list.pipeline_barrier_image_transition({
+            .waiting_pipeline_access = daxa::AccessConsts::TRANSFER_WRITE,
+            .before_layout = daxa::ImageLayout::UNDEFINED,
+            .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+            .image_slice = {.image_aspect = daxa::ImageAspectFlagBits::DEPTH | daxa::ImageAspectFlagBits::STENCIL},
+            .image_id = this->depth_image,
+        });
+
+        cmd_list.pipeline_barrier_image_transition({
+            .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+            .before_layout = daxa::ImageLayout::UNDEFINED,
+            .after_layout = daxa::ImageLayout::GENERAL,
+            .image_id = this->color_image,
+        });
+
+        // with more than one batch the visibility and resolve timers span each other's work
+        for(u32 batch = 0; batch < this->batch_count; batch++) {
+            u32 draw_base = batch * VISIBILITY_MAX_DRAWS;
+            u32 batch_end = std::min(draw_base + VISIBILITY_MAX_DRAWS, draw_count);
+
+            // visibility
+
+            if(batch == 0) {
+                this->gpu_timer->begin(cmd_list, VISIBILITY_TIMER);
+            } else {
+                cmd_list.pipeline_barrier_image_transition({
+                    .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+                    .waiting_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
+                    .before_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                    .after_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                    .image_id = this->visibility_image,
+                });
+
+                cmd_list.pipeline_barrier({
+                    .awaited_pipeline_access = daxa::AccessConsts::LATE_FRAGMENT_TESTS_WRITE,
+                    .waiting_pipeline_access = daxa::AccessConsts::EARLY_FRAGMENT_TESTS_READ_WRITE,
+                });
+            }
+
+            cmd_list.begin_renderpass({
+                .color_attachments = {{
+                    .image_view = this->visibility_image.default_view(),
+                    .load_op = daxa::AttachmentLoadOp::CLEAR,
+                    .clear_value = std::array<u32, 4>{VISIBILITY_EMPTY, 0, 0, 0},
+                }},
+                .depth_attachment = {{
+                    .image_view = this->depth_image.default_view(),
+                    .load_op = batch == 0 ? daxa::AttachmentLoadOp::CLEAR : daxa::AttachmentLoadOp::LOAD,
+                    .clear_value = daxa::DepthValue{1.0f, 0},
+                }},
+                .render_area = {.x = 0, .y = 0, .width = static_cast<u32>(size.x), .height = static_cast<u32>(size.y)},
+            });
+
+            cmd_list.set_pipeline(visibility_pipeline);
+
+            daxa::BufferDeviceAddress bound_index_buffer = 0;
+            for(u32 draw_index = draw_base; draw_index < batch_end; draw_index++) {
+                auto& draw = draws[draw_index];
+                if(draw.indexed && draw.model->index_buffer_address != bound_index_buffer) {
+                    draw.model->bind_index_buffer(cmd_list);
+                    bound_index_buffer = draw.model->index_buffer_address;
+                }
+
+                cmd_list.push_constant(VisibilityPush {
+                    .camera_buffer = camera_buffer,
+                    .draw_info_buffer = this->draw_info_buffer->buffer_address,
+                    .draw_index = draw_index,
+                    .draw_base = draw_base,
+                });
+
+                if (draw.indexed) {
+                    cmd_list.draw_indexed({
+                        .index_count = draw.count,
+                        .instance_count = 1,
+                        .first_index = draw.first,
+                        .vertex_offset = static_cast<i32>(draw_infos[draw_index].first_vertex),
+                        .first_instance = 0,
+                    });
+                } else {
+                    cmd_list.draw({
+                        .vertex_count = draw.count,
+                        .instance_count = 1,
+                        .first_vertex = draw.first,
+                        .first_instance = 0
+                    });
+                }
+            }
+
+            cmd_list.end_renderpass();
+
+            cmd_list.pipeline_barrier_image_transition({
+                .awaited_pipeline_access = daxa::AccessConsts::COLOR_ATTACHMENT_OUTPUT_WRITE,
+                .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ,
+                .before_layout = daxa::ImageLayout::ATTACHMENT_OPTIMAL,
+                .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+                .image_id = this->visibility_image,
+            });
+
+            if(batch + 1 == this->batch_count) {
+                this->gpu_timer->end(cmd_list, VISIBILITY_TIMER);
+            }
+
+            // material resolve, every pixel covered by this batch is shaded, later batches overwrite what they cover
+
+            if(batch == 0) {
+                this->gpu_timer->begin(cmd_list, RESOLVE_TIMER);
+            } else {
+                cmd_list.pipeline_barrier({
+                    .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+                    .waiting_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_READ_WRITE,
+                });
+            }
+
+            cmd_list.set_pipeline(resolve_pipeline);
+            cmd_list.push_constant(VisibilityResolvePush {
+                .visibility = { .image_view_id = visibility_image.default_view(), .sampler_id = sampler },
+                .output_image = color_image.default_view(),
+                .screen_size = { static_cast<u32>(size.x), static_cast<u32>(size.y) },
+                .camera_buffer = camera_buffer,
+                .draw_info_buffer = this->draw_info_buffer->buffer_address,
+                .lights_buffer = scene->lights_buffer->buffer_address,
+                .clusters_buffer = this->light_clustering->clusters_buffer_address,
+                .draw_base = draw_base,
+            });
+            cmd_list.dispatch(
+                (static_cast<u32>(size.x) + VISIBILITY_RESOLVE_GROUP_SIZE - 1) / VISIBILITY_RESOLVE_GROUP_SIZE,
+                (static_cast<u32>(size.y) + VISIBILITY_RESOLVE_GROUP_SIZE - 1) / VISIBILITY_RESOLVE_GROUP_SIZE,
+                1
+            );
+        }
+
+        this->gpu_timer->end(cmd_list, RESOLVE_TIMER);
+
+        cmd_list.pipeline_barrier_image_transition({
+            .awaited_pipeline_access = daxa::AccessConsts::COMPUTE_SHADER_WRITE,
+            .waiting_pipeline_access = daxa::AccessConsts::READ,
+            .before_layout = daxa::ImageLayout::GENERAL,
+            .after_layout = daxa::ImageLayout::READ_ONLY_OPTIMAL,
+            .image_id = this->color_image,
+        });
+    }
+
+    void VisibilityBuffer::resize(u32 sx, u32 sy) {
+        this->size = { static_cast<f32>(sx), static_cast<f32>(sy) };
+
+        destroy_images();
+        create_images(sx, sy);
+    }
+
+    void VisibilityBuffer::render_settings_ui() {
+        ImGui::Begin("Visibility Buffer Settings");
+        if(ImGui::TreeNodeEx("Texturing")) {
+            if(ImGui::Checkbox("None", &this->settings.texturing.none)) {
+                this->settings.texturing.vertex_color = false;
+                this->settings.texturing.albedo = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Vertex Color", &this->settings.texturing.vertex_color)) {
+                this->settings.texturing.none = false;
+                this->settings.texturing.albedo = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Albedo", &this->settings.texturing.albedo)) {
+                this->settings.texturing.none = false;
+                this->settings.texturing.vertex_color = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            ImGui::TreePop();
+        }
+
+        if(ImGui::TreeNodeEx("Shading Model")) {
+            if(ImGui::Checkbox("None", &this->settings.shading_model.none)) {
+                this->settings.shading_model.lambertian = false;
+                this->settings.shading_model.phong = false;
+                this->settings.shading_model.blinn_phong = false;
+                this->settings.shading_model.gaussian = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Lambertian", &this->settings.shading_model.lambertian)) {
+                this->settings.shading_model.none = false;
+                this->settings.shading_model.phong = false;
+                this->settings.shading_model.blinn_phong = false;
+                this->settings.shading_model.gaussian = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Phong", &this->settings.shading_model.phong)) {
+                this->settings.shading_model.none = false;
+                this->settings.shading_model.lambertian = false;
+                this->settings.shading_model.blinn_phong = false;
+                this->settings.shading_model.gaussian = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Blinn Phong", &this->settings.shading_model.blinn_phong)) {
+                this->settings.shading_model.none = false;
+                this->settings.shading_model.lambertian = false;
+                this->settings.shading_model.phong = false;
+                this->settings.shading_model.gaussian = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Gaussian", &this->settings.shading_model.gaussian)) {
+                this->settings.shading_model.none = false;
+                this->settings.shading_model.lambertian = false;
+                this->settings.shading_model.phong = false;
+                this->settings.shading_model.blinn_phong = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            ImGui::TreePop();
+        }
+
+        if(ImGui::TreeNodeEx("Normal mapping")) {
+            if(ImGui::Checkbox("None", &this->settings.normal_mappings.none)) {
+                this->settings.normal_mappings.using_tangents = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Using Tangents", &this->settings.normal_mappings.using_tangents)) {
+                this->settings.normal_mappings.none = false;
+
+                this->has_rebuild_pipeline = true;
+            }
+
+            if(ImGui::Checkbox("Re-orthogonalize TBN", &this->settings.normal_mappings.reorthogonalize_TBN_vectors)) {
+                this->has_rebuild_pipeline = true;
+            }
+
+            ImGui::TreePop();
+        }
+
+        ImGui::Separator();
+        ImGui::Text("Visibility: %.3f ms", this->gpu_timer->get_time_ms(VISIBILITY_TIMER));
+        ImGui::Text("Resolve: %.3f ms", this->gpu_timer->get_time_ms(RESOLVE_TIMER));
+        ImGui::Text("Batches: %u", this->batch_count);
+        ImGui::Text("Overflowing Light Clusters: %u", this->light_clustering->get_overflow_count());
+
+        ImGui::End();
+    }
+
+    auto VisibilityBuffer::settings_to_string()-> std::string {
+        // every setting of this task is a specialization constant
+        return {};
+    }
+
+    void VisibilityBuffer::rebuild_pipeline() {
+        if(this->has_rebuild_pipeline) {
+            std::string visibility_code = this->settings_to_string() + file_to_string("./shaders/visibility_buffer/visibility.glsl");
+            this->visibility_pipeline = this->context.shader_cache->create_raster_pipeline({
+                .vertex_shader_info = {
+                    .source = daxa::ShaderCode{ visibility_code },
+                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_VERT"} } }
+                },
+                .fragment_shader_info = {
+                    .source = daxa::ShaderCode{ visibility_code },
+                    .compile_options = { .defines = { daxa::ShaderDefine{"DRAW_FRAG"} } }
+                },
+                .color_attachments = {
+                    { .format = daxa::Format::R32_UINT },
+                },
+                .depth_test = {
+                    .depth_attachment_format = daxa::Format::D24_UNORM_S8_UINT,
+                    .enable_depth_test = true,
+                    .enable_depth_write = true,
+                },
+                .raster = {
+                    .polygon_mode = daxa::PolygonMode::FILL,
+                    .face_culling = daxa::FaceCullFlagBits::FRONT_BIT,
+                },
+                .push_constant_size = sizeof(VisibilityPush),
+                .debug_name = APPNAME_PREFIX("visibility_pipeline"),
+            }, settings_to_specialization(this->settings)).value();
+
+            std::string resolve_code = this->settings_to_string() + file_to_string("./shaders/visibility_buffer/resolve.glsl");
+            this->resolve_pipeline = this->context.shader_cache->create_compute_pipeline({
+                .shader_info = { .source = daxa::ShaderCode{ resolve_code } },
+                .push_constant_size = sizeof(VisibilityResolvePush),
+                .debug_name = APPNAME_PREFIX("visibility_resolve_pipeline"),
+            }, settings_to_specialization(this->settings)).value();
+
+            this->has_rebuild_pipeline = false;
+            std::cout << "pipeline reloaded" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "task.hpp"
+#include "light_clustering.hpp"
+#include "gpu_timer.hpp"
+
+namespace dare {
+    struct VisibilityBuffer : public Task {
+        struct Settings {
+            struct Texturing {
+                bool none = true;
+                bool vertex_color = false;
+                bool albedo = false;
+            } texturing;
+
+            struct ShadingModel {
+                bool none = true;
+                bool lambertian = false;
+                bool phong = false;
+                bool blinn_phong = false;
+                bool gaussian = false;
+            } shading_model;
+
+            struct NormalMapping {
+                bool none = true;
+                bool using_tangents = false;
+                bool reorthogonalize_TBN_vectors  = false;
+            } normal_mappings;
+        } settings;
+
+        VisibilityBuffer(RenderContext& context);
+        virtual ~VisibilityBuffer() override;
+
+        virtual void render(daxa::CommandList& cmd_list, const std::shared_ptr<Scene>& scene, const DrawList& draw_list, daxa::BufferDeviceAddress camera_buffer) override;
+        virtual void resize(u32 sx, u32 sy) override;
+
+        virtual void render_settings_ui() override;
+        virtual auto settings_to_string()-> std::string override;
+        virtual void rebuild_pipeline() override;
+
+        virtual auto get_color_image() -> daxa::ImageId override { return this->color_image; }
+        virtual auto get_depth_image() -> daxa::ImageId override { return this->depth_image; }
+
+        daxa::ImageId color_image;
+        daxa::ImageId visibility_image;
+        daxa::ImageId depth_image;
+
+        daxa::SamplerId sampler;
+
+        daxa::RasterPipeline visibility_pipeline;
+        daxa::ComputePipeline resolve_pipeline;
+
+        // one entry per recorded primitive chunk, rebuilt every frame, indexed by the batch's base plus the draw part of the visibility id
+        std::unique_ptr<GrowableBuffer<VisibilityDrawInfo>> draw_info_buffer;
+        // visibility and resolve passes recorded last frame, more than one once the draws overflow the id
+        u32 batch_count = 1;
+        std::unique_ptr<LightClustering> light_clustering;
+
+        enum Timers : u32 {
+            VISIBILITY_TIMER = 0,
+            RESOLVE_TIMER,
+            TIMER_COUNT
+        };
+        std::unique_ptr<GPUTimer> gpu_timer;
+
+        bool has_rebuild_pipeline = true;
+
+    private:
+        void create_images(u32 sx, u32 sy);
+        void destroy_images();
+    };
+}
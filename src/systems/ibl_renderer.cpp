@@ -10,8 +10,8 @@
 #include <daxa/daxa.hpp>
 
 namespace dare {
-    IBLRenderer::IBLRenderer(daxa::Device& device, daxa::PipelineCompiler& pipeline_compiler, daxa::Format swapchain_format) : device{device} {
-        skybox_pipeline = pipeline_compiler.create_raster_pipeline({
+    IBLRenderer::IBLRenderer(daxa::Device& device, ShaderCache& shader_cache, daxa::Format swapchain_format) : device{device} {
+        skybox_pipeline = shader_cache.create_raster_pipeline({
             .vertex_shader_info = {.source = daxa::ShaderFile{"skybox_draw.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_VERT"}}}},
             .fragment_shader_info = {.source = daxa::ShaderFile{"skybox_draw.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_FRAG"}}}},
             .color_attachments = {{.format = swapchain_format, .blend = {.blend_enable = true, .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA, .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA}}},
@@ -26,7 +26,8 @@ namespace dare {
             },
             .push_constant_size = sizeof(SkyboxDrawPush)
         }).value();
-        cube_model = std::make_unique<Model>(device, "assets/models/cube.gltf");
+        geometry_pool = std::make_shared<GeometryPool>(device, 1024, 4096);
+        cube_model = std::make_unique<Model>(device, geometry_pool, nullptr, "assets/models/cube.gltf");
 
         daxa::ImageId BRDFLUT_image = device.create_image({
             .dimensions = 2,
@@ -51,7 +52,7 @@ namespace dare {
         });
 
         {
-            daxa::RasterPipeline BRDFLUT_pipeline = pipeline_compiler.create_raster_pipeline({
+            daxa::RasterPipeline BRDFLUT_pipeline = shader_cache.create_raster_pipeline({
                 .vertex_shader_info = {.source = daxa::ShaderFile{"bdrflut.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_VERT"}}}},
                 .fragment_shader_info = {.source = daxa::ShaderFile{"bdrflut.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_FRAG"}}}},
                 .color_attachments = {{.format = daxa::Format::R16G16_SFLOAT, .blend = {.blend_enable = true, .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA, .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA}}},
@@ -255,7 +256,7 @@ namespace dare {
                 glm::mat4 mvp;
             };
 
-            daxa::RasterPipeline equirectangular_to_cubemap_pipeline = pipeline_compiler.create_raster_pipeline({
+            daxa::RasterPipeline equirectangular_to_cubemap_pipeline = shader_cache.create_raster_pipeline({
                 .vertex_shader_info = {.source = daxa::ShaderFile{"equirectangular_to_cubemap.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_VERT"}}}},
                 .fragment_shader_info = {.source = daxa::ShaderFile{"equirectangular_to_cubemap.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_FRAG"}}}},
                 .color_attachments = {{.format = daxa::Format::R32G32B32A32_SFLOAT, .blend = {.blend_enable = true, .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA, .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA}}},
@@ -480,7 +481,7 @@ namespace dare {
                 glm::mat4 mvp;
             };
 
-            daxa::RasterPipeline irradiance_cube_pipeline = pipeline_compiler.create_raster_pipeline({
+            daxa::RasterPipeline irradiance_cube_pipeline = shader_cache.create_raster_pipeline({
                 .vertex_shader_info = {.source = daxa::ShaderFile{"irradiance_cube.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_VERT"}}}},
                 .fragment_shader_info = {.source = daxa::ShaderFile{"irradiance_cube.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_FRAG"}}}},
                 .color_attachments = {{.format = daxa::Format::R32G32B32A32_SFLOAT, .blend = {.blend_enable = true, .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA, .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA}}},
@@ -706,7 +707,7 @@ namespace dare {
                 glm::mat4 mvp;
             };
 
-            daxa::RasterPipeline prefilter_env_pipeline = pipeline_compiler.create_raster_pipeline({
+            daxa::RasterPipeline prefilter_env_pipeline = shader_cache.create_raster_pipeline({
                 .vertex_shader_info = {.source = daxa::ShaderFile{"prefilter_env.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_VERT"}}}},
                 .fragment_shader_info = {.source = daxa::ShaderFile{"prefilter_env.glsl"}, .compile_options = {.defines = {daxa::ShaderDefine{"DRAW_FRAG"}}}},
                 .color_attachments = {{.format = daxa::Format::R32G32B32A32_SFLOAT, .blend = {.blend_enable = true, .src_color_blend_factor = daxa::BlendFactor::SRC_ALPHA, .dst_color_blend_factor = daxa::BlendFactor::ONE_MINUS_SRC_ALPHA}}},
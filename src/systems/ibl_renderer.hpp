@@ -7,6 +7,7 @@ using namespace daxa::types;
 #include "../../shaders/shared.inl"
 
 #include "../graphics/model.hpp"
+#include "../rendering/shader_cache.hpp"
 
 namespace dare {
     struct IBLRenderer {
@@ -18,10 +19,12 @@ namespace dare {
         daxa::ImageId prefiltered_cube_image;
         TextureId prefiltered_cube;
         daxa::RasterPipeline skybox_pipeline;
+        // the cube is not part of any scene, so it gets a pool just big enough for itself
+        std::shared_ptr<GeometryPool> geometry_pool;
         std::unique_ptr<Model> cube_model;
         daxa::Device& device;
 
-        IBLRenderer(daxa::Device& device, daxa::PipelineCompiler& pipeline_compiler, daxa::Format swapchain_format);
+        IBLRenderer(daxa::Device& device, ShaderCache& shader_cache, daxa::Format swapchain_format);
         ~IBLRenderer();
 
         void draw(daxa::CommandList& cmd_list, const glm::mat4& proj, const glm::mat4& view);
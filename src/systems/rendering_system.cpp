@@ -6,6 +6,11 @@
 #include "../rendering/task.hpp"
 #include "../rendering/basic_forward.hpp"
 #include "../rendering/basic_deffered.hpp"
+#include "../rendering/visibility_buffer.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <vector>
 
 namespace dare {
     RenderingSystem::RenderingSystem(std::unique_ptr<Window>& window) : window{window} {
@@ -22,23 +27,27 @@ namespace dare {
             .native_window = window->get_native_handle(),
             .present_mode = daxa::PresentMode::DO_NOT_WAIT_FOR_VBLANK,
             .image_usage = daxa::ImageUsageFlagBits::TRANSFER_DST,
+            .max_allowed_frames_in_flight = RenderContext::FRAMES_IN_FLIGHT,
             .debug_name = "swapchain",
         });
 
+        std::vector<std::filesystem::path> shader_root_paths = {
+            ".out/release/vcpkg_installed/x64-linux/include",
+            "build/vcpkg_installed/x64-linux/include",
+            "vcpkg_installed/x64-linux/include",
+            "shaders",
+            "../shaders",
+            "include",
+        };
+
         this->context.pipeline_compiler = this->context.device.create_pipeline_compiler({
             .shader_compile_options = {
-                .root_paths = {
-                    ".out/release/vcpkg_installed/x64-linux/include",
-                    "build/vcpkg_installed/x64-linux/include",
-                    "vcpkg_installed/x64-linux/include",
-                    "shaders",
-                    "../shaders",
-                    "include",
-                },
+                .root_paths = shader_root_paths,
                 .language = daxa::ShaderLanguage::GLSL,
             },
             .debug_name = "pipeline_compiler",
         });
+        this->context.shader_cache = std::make_unique<ShaderCache>(this->context.pipeline_compiler, shader_root_paths);
 
         // setup imgui
         ImGui::CreateContext();
@@ -50,7 +59,14 @@ namespace dare {
 
         ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
     
-        this->camera_buffer = std::make_unique<Buffer<CameraInfo>>(this->context.device);
+        this->context.staging_ring = std::make_unique<StagingRing>(this->context.device, RenderContext::FRAMES_IN_FLIGHT, 1024 * 1024, APPNAME_PREFIX("staging_ring"));
+        this->context.thread_pool = std::make_unique<ThreadPool>();
+        this->context.parallel_recorder = std::make_unique<ParallelRecorder>(this->context.device, *this->context.thread_pool);
+        this->software_occlusion.thread_pool = this->context.thread_pool.get();
+        this->buffer_pool = std::make_shared<BufferPool>(this->context.device, 4 * 1024, APPNAME_PREFIX("rendering_buffer_pool"));
+        this->camera_buffer = std::make_unique<Buffer<CameraInfo>>(this->buffer_pool);
+        this->cascaded_shadows = std::make_unique<CascadedShadows>(this->context, this->buffer_pool);
+        this->shadow_atlas = std::make_unique<ShadowAtlas>(this->context, this->buffer_pool);
         this->task = std::make_unique<BasicForward>(context);
     }
 
@@ -70,10 +86,20 @@ namespace dare {
         u32 size_x = this->context.swapchain.get_surface_extent().x;
         u32 size_y = this->context.swapchain.get_surface_extent().y;
 
+        // the slot this frame reuses was last recorded FRAMES_IN_FLIGHT frames ago, that is the only frame waited for
+        u64 frame = this->context.swapchain.get_cpu_timeline_value();
+        if(frame > RenderContext::FRAMES_IN_FLIGHT) {
+            this->context.swapchain.get_gpu_timeline_semaphore().wait_for_value(frame - RenderContext::FRAMES_IN_FLIGHT);
+        }
+
         auto cmd_list = this->context.device.create_command_list({
             .debug_name = APPNAME_PREFIX("cmd_list"),
         });
 
+        this->context.staging_ring->begin_frame(cmd_list, static_cast<usize>(frame % RenderContext::FRAMES_IN_FLIGHT));
+        this->context.parallel_recorder->begin_frame();
+        scene->update(cmd_list, *this->context.staging_ring);
+
         {
             glm::mat4 view = camera.camera.get_view();
 
@@ -87,10 +113,32 @@ namespace dare {
                 .inverse_view_matrix = *reinterpret_cast<const f32mat4x4*>(&temp_inverse_view_mat),
                 .position = *reinterpret_cast<const f32vec3*>(&camera.pos),
                 .near_plane = camera.camera.near_clip,
-                .far_plane = camera.camera.far_clip
+                .far_plane = camera.camera.far_clip,
+                .shadow_info = this->cascaded_shadows->shadow_buffer->buffer_address,
+                .shadow_atlas_info = this->shadow_atlas->shadow_atlas_buffer->buffer_address,
             };
 
-            camera_buffer->update(cmd_list, camera_info);
+            camera_buffer->update(cmd_list, *this->context.staging_ring, camera_info);
+
+            this->bvh_stats = scene->bvh.stats;
+            this->geometry_stats = scene->geometry_pool->get_stats();
+            this->buffer_pool_stats = scene->buffer_pool->get_stats();
+            scene->buffer_pool->background_defragment = this->background_defragment;
+            if(this->task->uses_draw_list()) {
+                this->frustum_culling.cull(scene, camera.camera.proj_mat * view, this->draw_list);
+                this->software_occlusion.cull(scene, camera.camera.proj_mat * view, this->draw_list);
+                // masked draws go last either way so opaque depth is laid down before any fragment is discarded
+                if(this->sort_draws) {
+                    this->draw_list.sort(view, camera.camera.far_clip);
+                } else {
+                    this->draw_list.partition_masked();
+                }
+            } else {
+                this->draw_list.clear();
+            }
+
+            this->cascaded_shadows->render(cmd_list, scene, camera.camera, view);
+            this->shadow_atlas->render(cmd_list, scene, camera.camera, view);
         }
 
         cmd_list.pipeline_barrier_image_transition({
@@ -100,7 +148,7 @@ namespace dare {
             .image_id = swapchain_image,
         });
 
-        this->task->render(cmd_list, scene, camera_buffer->buffer_address);
+        this->task->render(cmd_list, scene, this->draw_list, camera_buffer->buffer_address);
 
         imgui_renderer.record_commands(ImGui::GetDrawData(), cmd_list, swapchain_image, size_x, size_y);
 
@@ -113,8 +161,12 @@ namespace dare {
 
         cmd_list.complete();
 
+        // lists the draws were recorded into on worker threads go in front of the one the frame ends with
+        std::vector<daxa::CommandList> command_lists = this->context.parallel_recorder->take_command_lists();
+        command_lists.push_back(std::move(cmd_list));
+
         this->context.device.submit_commands({
-            .command_lists = {std::move(cmd_list)},
+            .command_lists = std::move(command_lists),
             .wait_binary_semaphores = {this->context.swapchain.get_acquire_semaphore()},
             .signal_binary_semaphores = {this->context.swapchain.get_present_semaphore()},
             .signal_timeline_semaphores = {{this->context.swapchain.get_gpu_timeline_semaphore(), this->context.swapchain.get_cpu_timeline_value()}},
@@ -136,15 +188,56 @@ namespace dare {
         ImGui::Begin("Rendering Technique");
         if(ImGui::Checkbox("Forward Rendering", &this->rendering_techniques.forward_rendering)){
             this->rendering_techniques.deffered_rendering = false;
+            this->rendering_techniques.visibility_buffer = false;
             this->task = std::make_unique<BasicForward>(context);
             this->task->resize(static_cast<i32>(this->size.x), static_cast<i32>(this->size.y));
         }
 
         if(ImGui::Checkbox("Deffered Rendering", &this->rendering_techniques.deffered_rendering)){
             this->rendering_techniques.forward_rendering = false;
+            this->rendering_techniques.visibility_buffer = false;
             this->task = std::make_unique<BasicDeffered>(context);
             this->task->resize(static_cast<i32>(this->size.x), static_cast<i32>(this->size.y));
         }
+
+        if(ImGui::Checkbox("Visibility Buffer", &this->rendering_techniques.visibility_buffer)){
+            this->rendering_techniques.forward_rendering = false;
+            this->rendering_techniques.deffered_rendering = false;
+            this->task = std::make_unique<VisibilityBuffer>(context);
+            this->task->resize(static_cast<i32>(this->size.x), static_cast<i32>(this->size.y));
+        }
+
+        ImGui::Separator();
+        ImGui::Checkbox("Frustum Culling", &this->frustum_culling.enabled);
+        ImGui::Text("Visible: %u", this->draw_list.visible_count);
+        ImGui::Text("Culled: %u", this->draw_list.culled_count);
+        ImGui::Text("BVH: %u nodes, cost %.2f (%.2f at build)", this->bvh_stats.node_count, this->bvh_stats.cost, this->bvh_stats.build_cost);
+        ImGui::Text("BVH: %u rebuilds, build %.3f ms, refit %.3f ms", this->bvh_stats.rebuild_count, this->bvh_stats.build_ms, this->bvh_stats.refit_ms);
+        ImGui::Text("Geometry Pool: %u / %u vertices, %u / %u indices", this->geometry_stats.vertices.used, this->geometry_stats.vertices.capacity, this->geometry_stats.indices.used, this->geometry_stats.indices.capacity);
+        ImGui::Text("Geometry Pool: %u free blocks, largest %u vertices, %u indices", this->geometry_stats.vertices.free_block_count + this->geometry_stats.indices.free_block_count, this->geometry_stats.vertices.largest_free_block, this->geometry_stats.indices.largest_free_block);
+        ImGui::Text("Buffer Pool: %u allocations in %u blocks, %.1f / %.1f KiB", this->buffer_pool_stats.allocation_count, this->buffer_pool_stats.block_count, static_cast<f32>(this->buffer_pool_stats.used_bytes) / 1024.0f, static_cast<f32>(this->buffer_pool_stats.reserved_bytes) / 1024.0f);
+        ImGui::Text("Buffer Pool: %u free ranges, fragmentation %.2f, %u moves", this->buffer_pool_stats.free_range_count, this->buffer_pool_stats.fragmentation, this->buffer_pool_stats.moves_last_defragment);
+        ImGui::Checkbox("Background Defragmentation", &this->background_defragment);
+        StagingRing::Stats staging_stats = this->context.staging_ring->get_stats();
+        ImGui::Text("Staging: %.1f / %.1f KiB per frame, %u overflows, %u frames in flight", static_cast<f32>(staging_stats.used_bytes) / 1024.0f, static_cast<f32>(staging_stats.slice_size) / 1024.0f, staging_stats.overflow_count, static_cast<u32>(RenderContext::FRAMES_IN_FLIGHT));
+        ShaderCache::Stats shader_cache_stats = this->context.shader_cache->get_stats();
+        ImGui::Text("Shader Cache: %u memory hits, %u disk hits, %u compiles in %.1f ms", shader_cache_stats.memory_hits, shader_cache_stats.disk_hits, shader_cache_stats.compiles, shader_cache_stats.compile_ms);
+        ImGui::Checkbox("Software Occlusion Culling", &this->software_occlusion.enabled);
+        ImGui::Text("Occluder Triangles: %u", this->software_occlusion.occluder_triangle_count);
+        ImGui::Text("Occluded: %u", this->draw_list.occluded_count);
+        ImGui::Checkbox("Sort Draws", &this->sort_draws);
+        ImGui::Text("Draws: %u", this->draw_list.stats.draws);
+        ImGui::Text("Pipeline Binds: %u", this->draw_list.stats.pipeline_binds);
+        ImGui::Text("Index Buffer Binds: %u", this->draw_list.stats.index_buffer_binds);
+        ParallelRecorder& parallel_recorder = *this->context.parallel_recorder;
+        i32 record_threads = static_cast<i32>(parallel_recorder.thread_count);
+        if(ImGui::SliderInt("Recording Threads (0 = all)", &record_threads, 0, static_cast<i32>(this->context.thread_pool->thread_count()))) {
+            parallel_recorder.thread_count = static_cast<u32>(record_threads);
+        }
+        ImGui::Text("Draw Recording: %.3f ms, %u passes, %u threads, %u command lists", parallel_recorder.stats.record_ms, parallel_recorder.stats.passes, parallel_recorder.stats.threads, parallel_recorder.stats.command_lists);
+        ImGui::Separator();
+        this->cascaded_shadows->render_settings_ui();
+        this->shadow_atlas->render_settings_ui();
         ImGui::End();
 
         task->render_settings_ui();
@@ -9,12 +9,18 @@
 #include "../graphics/camera.hpp"
 #include "../graphics/buffer.hpp"
 #include "../rendering/task.hpp"
+#include "../rendering/draw_list.hpp"
+#include "../rendering/frustum_culling.hpp"
+#include "../rendering/software_occlusion.hpp"
+#include "../rendering/cascaded_shadows.hpp"
+#include "../rendering/shadow_atlas.hpp"
 
 namespace dare {
     struct RenderingSystem {
         struct RenderingTechniques {
             bool forward_rendering = true;
             bool deffered_rendering = false;
+            bool visibility_buffer = false;
         } rendering_techniques;
 
         RenderContext context;
@@ -22,8 +28,21 @@ namespace dare {
         daxa::ImGuiRenderer imgui_renderer;
 
         std::unique_ptr<Task> task;
+        std::shared_ptr<BufferPool> buffer_pool;
         std::unique_ptr<Buffer<CameraInfo>> camera_buffer;
 
+        FrustumCulling frustum_culling;
+        SoftwareOcclusion software_occlusion;
+        std::unique_ptr<CascadedShadows> cascaded_shadows;
+        std::unique_ptr<ShadowAtlas> shadow_atlas;
+        DrawList draw_list;
+        bool sort_draws = true;
+        BVH::Stats bvh_stats;
+        GeometryPool::Stats geometry_stats;
+        BufferPool::Stats buffer_pool_stats;
+        // forwarded to the buffer pool of the scene being drawn
+        bool background_defragment = false;
+
         glm::vec2 size = { 400.0f, 300.0f };
 
         RenderingSystem(std::unique_ptr<Window>& window);
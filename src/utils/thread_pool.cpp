@@ -0,0 +1,86 @@
+#include "thread_pool.hpp"
+
+namespace dare {
+    ThreadPool::ThreadPool(u32 worker_count) {
+        this->workers.reserve(worker_count);
+        for(u32 i = 0; i < worker_count; i++) {
+            this->workers.emplace_back([this]() { this->work(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            this->stopping = true;
+        }
+        this->wake_condition.notify_all();
+
+        for(auto& worker : this->workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::run(u32 task_count, const std::function<void(u32)>& task) {
+        if(task_count == 0) {
+            return;
+        }
+
+        if(task_count == 1 || this->workers.empty()) {
+            for(u32 index = 0; index < task_count; index++) {
+                task(index);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> run_lock{this->run_mutex};
+        {
+            std::lock_guard<std::mutex> lock{this->mutex};
+            this->task = &task;
+            this->task_count = task_count;
+            this->next_task = 0;
+            this->generation++;
+        }
+        this->wake_condition.notify_all();
+
+        this->execute(task, task_count);
+
+        // every index is handed out, what is left are the tasks workers are still running
+        std::unique_lock<std::mutex> lock{this->mutex};
+        this->done_condition.wait(lock, [&]() { return this->active_workers == 0; });
+        this->task = nullptr;
+    }
+
+    void ThreadPool::work() {
+        u64 seen_generation = 0;
+        std::unique_lock<std::mutex> lock{this->mutex};
+        while(true) {
+            this->wake_condition.wait(lock, [&]() { return this->stopping || this->generation != seen_generation; });
+            if(this->stopping) {
+                return;
+            }
+
+            // woken too late, the call already finished without this worker
+            seen_generation = this->generation;
+            if(this->task == nullptr) {
+                continue;
+            }
+
+            const std::function<void(u32)>& task = *this->task;
+            u32 task_count = this->task_count;
+            this->active_workers++;
+            lock.unlock();
+
+            this->execute(task, task_count);
+
+            lock.lock();
+            this->active_workers--;
+            this->done_condition.notify_all();
+        }
+    }
+
+    void ThreadPool::execute(const std::function<void(u32)>& task, u32 task_count) {
+        for(u32 index = this->next_task.fetch_add(1); index < task_count; index = this->next_task.fetch_add(1)) {
+            task(index);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <daxa/daxa.hpp>
+using namespace daxa::types;
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dare {
+    // worker threads created once and fed per call, run hands out task indices to the workers and the calling
+    // thread and returns once every task is done, so the tasks may reference the caller's stack
+    //
+    // calls from different threads are serialized, a task must not call run itself
+    struct ThreadPool {
+        // 0 workers runs everything on the calling thread
+        ThreadPool(u32 worker_count = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // threads a call can spread over, the workers and the caller
+        auto thread_count() const -> u32 { return static_cast<u32>(this->workers.size()) + 1; }
+        // task is called once for every index in [0, task_count)
+        void run(u32 task_count, const std::function<void(u32)>& task);
+
+    private:
+        void work();
+        void execute(const std::function<void(u32)>& task, u32 task_count);
+
+        std::vector<std::thread> workers;
+        std::mutex run_mutex;
+        std::mutex mutex;
+        std::condition_variable wake_condition;
+        std::condition_variable done_condition;
+        // what the current call hands out, only changed while no worker is inside execute
+        const std::function<void(u32)>* task = nullptr;
+        u32 task_count = 0;
+        std::atomic<u32> next_task = 0;
+        u64 generation = 0;
+        u32 active_workers = 0;
+        bool stopping = false;
+    };
+}